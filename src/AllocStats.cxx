@@ -0,0 +1,210 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// System
+
+// Library
+#include <SDL.h>
+
+// Local
+#include "AllocStats.hxx"
+
+//
+// Implementation
+//
+
+#ifdef P2_ALLOC_STATS
+
+namespace
+{
+	std::atomic<uint64_t> news(0);
+	std::atomic<uint64_t> deletes(0);
+	std::atomic<uint64_t> surfaces(0);
+	std::atomic<uint64_t> frees(0);
+
+	void *allocate(std::size_t size)
+	{
+		news.fetch_add(1, std::memory_order_relaxed);
+		void *p = malloc(size ? size : 1);
+		if (!p)
+			throw std::bad_alloc();
+		return p;
+	}
+
+	void release(void *p)
+	{
+		if (!p)
+			return;
+		deletes.fetch_add(1, std::memory_order_relaxed);
+		free(p);
+	}
+}
+
+void *operator new(std::size_t size)
+{
+	return allocate(size);
+}
+
+void *operator new[](std::size_t size)
+{
+	return allocate(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+	news.fetch_add(1, std::memory_order_relaxed);
+	return malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+	news.fetch_add(1, std::memory_order_relaxed);
+	return malloc(size ? size : 1);
+}
+
+void operator delete(void *p) noexcept
+{
+	release(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	release(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+	release(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept
+{
+	release(p);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void *p, std::size_t) noexcept
+{
+	release(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+	release(p);
+}
+#endif
+
+// The linker sends calls to these SDL functions here, given
+// --wrap=SDL_... for each (see configure.ac), and the originals
+// become __real_SDL_...
+extern "C"
+{
+	SDL_Surface *__real_SDL_CreateRGBSurface(Uint32 flags, int width,
+		int height, int depth, Uint32 rmask, Uint32 gmask, Uint32 bmask,
+		Uint32 amask);
+	SDL_Surface *__real_SDL_CreateRGBSurfaceFrom(void *pixels, int width,
+		int height, int depth, int pitch, Uint32 rmask, Uint32 gmask,
+		Uint32 bmask, Uint32 amask);
+	SDL_Surface *__real_SDL_DisplayFormat(SDL_Surface *surface);
+	SDL_Surface *__real_SDL_ConvertSurface(SDL_Surface *src,
+		SDL_PixelFormat *fmt, Uint32 flags);
+	void __real_SDL_FreeSurface(SDL_Surface *surface);
+
+	SDL_Surface *__wrap_SDL_CreateRGBSurface(Uint32 flags, int width,
+		int height, int depth, Uint32 rmask, Uint32 gmask, Uint32 bmask,
+		Uint32 amask)
+	{
+		surfaces.fetch_add(1, std::memory_order_relaxed);
+		return __real_SDL_CreateRGBSurface(flags, width, height, depth,
+			rmask, gmask, bmask, amask);
+	}
+
+	SDL_Surface *__wrap_SDL_CreateRGBSurfaceFrom(void *pixels, int width,
+		int height, int depth, int pitch, Uint32 rmask, Uint32 gmask,
+		Uint32 bmask, Uint32 amask)
+	{
+		surfaces.fetch_add(1, std::memory_order_relaxed);
+		return __real_SDL_CreateRGBSurfaceFrom(pixels, width, height, depth,
+			pitch, rmask, gmask, bmask, amask);
+	}
+
+	SDL_Surface *__wrap_SDL_DisplayFormat(SDL_Surface *surface)
+	{
+		surfaces.fetch_add(1, std::memory_order_relaxed);
+		return __real_SDL_DisplayFormat(surface);
+	}
+
+	SDL_Surface *__wrap_SDL_ConvertSurface(SDL_Surface *src,
+		SDL_PixelFormat *fmt, Uint32 flags)
+	{
+		surfaces.fetch_add(1, std::memory_order_relaxed);
+		return __real_SDL_ConvertSurface(src, fmt, flags);
+	}
+
+	void __wrap_SDL_FreeSurface(SDL_Surface *surface)
+	{
+		if (surface)
+			frees.fetch_add(1, std::memory_order_relaxed);
+		__real_SDL_FreeSurface(surface);
+	}
+}
+
+bool AllocStats::enabled()
+{
+	return true;
+}
+
+AllocCounts AllocStats::totals()
+{
+	AllocCounts c = {
+		news.load(std::memory_order_relaxed),
+		deletes.load(std::memory_order_relaxed),
+		surfaces.load(std::memory_order_relaxed),
+		frees.load(std::memory_order_relaxed)
+	};
+	return c;
+}
+
+#else
+
+bool AllocStats::enabled()
+{
+	return false;
+}
+
+AllocCounts AllocStats::totals()
+{
+	AllocCounts c = { 0, 0, 0, 0 };
+	return c;
+}
+
+#endif
@@ -0,0 +1,62 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HXX_ALLOCSTATS
+#define HXX_ALLOCSTATS
+
+#include <cstdint>
+
+// Numbers of heap allocations and SDL surfaces made and released
+struct AllocCounts
+{
+	// Calls to operator new and delete, all forms
+	uint64_t news;
+	uint64_t deletes;
+
+	// Calls to SDL_CreateRGBSurface(From), SDL_DisplayFormat and
+	// SDL_ConvertSurface, and to SDL_FreeSurface (which may only have
+	// dropped a reference)
+	uint64_t surfaces;
+	uint64_t frees;
+
+	AllocCounts operator-(const AllocCounts &o) const
+	{
+		AllocCounts d = { news - o.news, deletes - o.deletes,
+			surfaces - o.surfaces, frees - o.frees };
+		return d;
+	};
+};
+
+// Accounting of allocations, for catching them where they shouldn't
+// happen, such as in the middle of gameplay.  Only built in when
+// configured with --enable-alloc-stats (defining P2_ALLOC_STATS), which
+// replaces the global operator new and delete, and has the linker wrap
+// the SDL surface functions; otherwise every count stays at zero.
+// Counts are for all threads together.  Built into the programs that
+// report counts rather than into libpushy2core, so that nothing else
+// linking the library gets the replacements or needs the wrapping.
+namespace AllocStats
+{
+	// Are allocations being counted?
+	bool enabled();
+
+	// Everything counted since the program started
+	AllocCounts totals();
+}
+
+#endif
@@ -121,6 +121,31 @@ Alphabet::Alphabet(const char *filename)
 	}
 }
 
+int Alphabet::glyphIndex(char c)
+{
+	// Figure out glyph index for ASCII character
+	if (c >= 'A' && c <= 'Z')
+		return c - 'A';
+	else if (c >= 'a' && c <= 'z')
+		return (c - 'a') + 26;
+	else if (c >= '0' && c <= '9')
+		return (c - '0') + 52;
+	else if (c == ':')
+		return 62;
+	else if (c == ' ')
+		// Space - special case
+		return -1;
+	else
+		// Render any other unrecognised character as a hyphen
+		return 63;
+}
+
+int Alphabet::advance(char c) const
+{
+	int index = glyphIndex(c);
+	return (index < 0) ? 24 : m_glyphs[index].x_offset;
+}
+
 SDL_Surface * Alphabet::renderWord(const std::string &word,
 	unsigned char r, unsigned char g, unsigned char b) const
 {
@@ -132,22 +157,7 @@ SDL_Surface * Alphabet::renderWord(const std::string &word,
 	float fb = (float)(b) / 255.0f;
 	for (size_t i = 0; i < word.length(); ++i)
 	{
-		// Figure out glyph index for ASCII character
-		if (word[i] >= 'A' && word[i] <= 'Z')
-			indices[i] = word[i] - 'A';
-		else if (word[i] >= 'a' && word[i] <= 'z')
-			indices[i] = (word[i] - 'a') + 26;
-		else if (word[i] >= '0' && word[i] <= '9')
-			indices[i] = (word[i] - '0') + 52;
-		else if (word[i] == ':')
-			indices[i] = 62;
-		else if (word[i] == ' ')
-			// Space - special case
-			indices[i] = -1;
-		else
-			// Render any other unrecognised character as a hyphen
-			indices[i] = 63;
-
+		indices[i] = glyphIndex(word[i]);
 		if (indices[i] >= 0)
 		{
 			// Store the tallest character to work out the height
@@ -260,5 +270,17 @@ SDL_Surface * Alphabet::renderWord(const std::string &word,
 		glyph_horz_start += g.x_offset;
 	}
 
+	// Hand back the word in the screen's pixel format, if there is a
+	// screen yet, so that drawing it needs no conversion
+	if (SDL_GetVideoSurface())
+	{
+		SDL_Surface *converted = SDL_DisplayFormat(surf);
+		if (converted)
+		{
+			SDL_FreeSurface(surf);
+			surf = converted;
+		}
+	}
+
 	return surf;
 }
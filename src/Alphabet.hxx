@@ -31,7 +31,8 @@ class Alphabet
 	public:
 		Alphabet(const char *filename);
 
-		// Render a word onto a surface.  ASCII values without a corresponding
+		// Render a word onto a surface, in the display format once the
+		// video mode has been set.  ASCII values without a corresponding
 		// glyph will be rendered as a hyphen.
 		//
 		// XXX NB: The returned surface is dynamically allocated, and must
@@ -39,7 +40,23 @@ class Alphabet
 		SDL_Surface *renderWord(const std::string &word,
 			unsigned char r = 255, unsigned char g = 255, unsigned char b = 255) const;
 
+		// Distance from the start of a character to the start of the
+		// next, as laid out by renderWord.  Text which changes often
+		// can be drawn a character at a time from surfaces rendered
+		// up front, rather than rendering a new word each time.
+		int advance(char c) const;
+
+		// Exchange glyphs with another alphabet, such as a fresh copy
+		// of this one loaded after its file was edited
+		void swap(Alphabet &other)
+		{
+			m_glyphs.swap(other.m_glyphs);
+		};
+
 	private:
+		// Index into m_glyphs for an ASCII character, or -1 for space
+		static int glyphIndex(char c);
+
 		struct Glyph
 		{
 			uint16_t width;
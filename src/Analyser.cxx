@@ -0,0 +1,394 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+
+// System
+
+// Library
+
+// Local
+#include "Analyser.hxx"
+#include "Board.hxx"
+#include "Search.hxx"
+#include "Solver.hxx"
+#include "Simulation.hxx"
+#include "ThreadPool.hxx"
+
+//
+// Implementation
+//
+
+// Positions searched per level, at most
+#define ANALYSER_MAX_STATES 250000
+
+// Time the hint solver is given to find any solution at all,
+// for levels too big to search exhaustively
+#define ANALYSER_SOLVER_MS 1000
+
+namespace
+{
+	const Direction opposite[4] = { Right, Left, Down, Up };
+
+	// The push between two positions, and where the object ended up
+	void pushBetween(const Board &b, const Board::State &before,
+		const Board::State &after, Solver::Push &p, int &to)
+	{
+		const uint16_t *end_before = before.objects + b.numObjects();
+		const uint16_t *end_after = after.objects + b.numObjects();
+		for (int i = 0; i < b.numObjects(); ++i)
+		{
+			if (std::find(after.objects, end_after, before.objects[i])
+				== end_after)
+				p.square = before.objects[i];
+			if (std::find(before.objects, end_before, after.objects[i])
+				== end_before)
+				to = after.objects[i];
+		}
+		if (to / b.width() == p.square / b.width())
+			p.dir = (to < p.square) ? Left : Right;
+		else
+			p.dir = (to < p.square) ? Up : Down;
+	}
+
+	// Fraction of the positions searched from which no solved
+	// position can be reached.  Positions with pushes left out of
+	// the search might lead to one, so are given the benefit
+	// of the doubt.
+	double deadlockDensity(const Board &b, const Search &s)
+	{
+		const std::vector<Search::Node> &nodes = s.nodes();
+		uint32_t count = nodes.size();
+		if (!count)
+			return 0.0;
+
+		// Turn the pushes round, so they can be followed backwards
+		std::vector<uint32_t> start(count + 1, 0);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			for (const uint32_t *e = s.edgesBegin(i); e != s.edgesEnd(i); ++e)
+				++start[*e + 1];
+		}
+		for (uint32_t i = 0; i < count; ++i)
+			start[i + 1] += start[i];
+		std::vector<uint32_t> from(start[count]);
+		std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			for (const uint32_t *e = s.edgesBegin(i); e != s.edgesEnd(i); ++e)
+				from[fill[*e]++] = i;
+		}
+
+		std::vector<uint8_t> live(count, 0);
+		std::vector<uint32_t> queue;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (b.solved(nodes[i].state) || s.open(i))
+			{
+				live[i] = 1;
+				queue.push_back(i);
+			}
+		}
+		for (size_t head = 0; head < queue.size(); ++head)
+		{
+			uint32_t n = queue[head];
+			for (uint32_t j = start[n]; j < start[n + 1]; ++j)
+			{
+				if (!live[from[j]])
+				{
+					live[from[j]] = 1;
+					queue.push_back(from[j]);
+				}
+			}
+		}
+		return (double)(count - queue.size()) / count;
+	}
+
+	// Characters which can't appear as they are in JSON strings
+	// or quoted CSV fields
+	std::string escape(const std::string &s, bool json)
+	{
+		std::string e;
+		for (auto i = s.begin(); i != s.end(); ++i)
+		{
+			unsigned char c = *i;
+			if (!json)
+			{
+				if (c == '"')
+					e += '"';
+				e += c;
+			}
+			else if (c == '"' || c == '\\')
+			{
+				e += '\\';
+				e += c;
+			}
+			else if (c < 0x20)
+			{
+				char u[8];
+				snprintf(u, sizeof(u), "\\u%04x", c);
+				e += u;
+			}
+			else
+				e += c;
+		}
+		return e;
+	}
+}
+
+Analyser::Result Analyser::analyse(const LevelSet &l, int level,
+	std::vector<Direction> *solution)
+{
+	Result r = { false, false, false, 0, 0, 0, 0, 0.0, false, 0, 0 };
+	Board b(l[level], l.firstFloorTile(), l.firstCrossTile());
+	Search s(ANALYSER_MAX_STATES);
+	s.reset(b, false, true);
+	s.start(b.initialState());
+	s.run();
+
+	const std::vector<Search::Node> &nodes = s.nodes();
+	r.exhaustive = s.exhausted();
+	r.states = nodes.size();
+	r.deadlock_density = deadlockDensity(b, s);
+
+	// Walk the player round to each push the shortest way, noting
+	// where everything should be after every step
+	std::vector<Direction> steps;
+	std::vector<Board::State> after;
+	Board::State state = b.initialState();
+	auto apply = [&](const Solver::Push &p) {
+		size_t first = steps.size();
+		if (!s.walk(state, state.player, b.neighbour(p.square,
+			opposite[p.dir]), steps))
+			return false;
+		steps.push_back(p.dir);
+		for (int i = 0; i < b.numObjects(); ++i)
+		{
+			if (state.objects[i] == p.square
+				&& b.pieceAt(i) == Board::BallPiece)
+				++r.ball_slides;
+		}
+		for (size_t i = first; i < steps.size(); ++i)
+		{
+			b.move(state, steps[i]);
+			b.normalise(state);
+			after.push_back(state);
+		}
+		++r.pushes;
+		return true;
+	};
+
+	// Positions are found in order of pushes, so the first
+	// solved one is as few pushes away as possible
+	uint32_t goal = 0;
+	while (goal < nodes.size() && !b.solved(nodes[goal].state))
+		++goal;
+	if (goal < nodes.size())
+	{
+		std::vector<uint32_t> path;
+		for (uint32_t i = goal; nodes[i].depth > 0; i = nodes[i].parent)
+			path.push_back(i);
+		path.push_back(0);
+		for (size_t i = path.size() - 1; i > 0; --i)
+		{
+			Solver::Push p;
+			int to;
+			pushBetween(b, nodes[path[i]].state, nodes[path[i - 1]].state,
+				p, to);
+			if (!apply(p))
+				return r;
+		}
+		r.optimal = true;
+	}
+	else if (!r.exhaustive)
+	{
+		// Too far away to find the fewest pushes, so settle for
+		// whatever the hint solver can find
+		Solver solver(b);
+		if (solver.search(Solver::Clock::now()
+			+ std::chrono::milliseconds(ANALYSER_SOLVER_MS)) != Solver::Solved)
+			return r;
+		Solver::Push p;
+		while (!b.solved(state) && solver.firstPush(p))
+		{
+			if (!apply(p))
+				return r;
+			solver.setRoot(state);
+		}
+		if (!b.solved(state))
+			return r;
+	}
+	else
+		return r;
+	r.solved = true;
+	r.moves = steps.size();
+	if (solution)
+		*solution = steps;
+
+	// Play it through, holding down the key for each step until the
+	// player takes it, then waiting for any ball set rolling to stop
+	Simulation sim(l, level);
+	const uint32_t limit = (steps.size() + 10) * P2_TICK_RATE;
+	size_t step = 0;
+	while (!sim.complete() && sim.ticks() < limit)
+	{
+		Board::State now = sim.snapshot(b);
+		while (step < steps.size() && now == after[step])
+			++step;
+		int key = -1;
+		if (step < steps.size() && now.player != after[step].player)
+			key = steps[step];
+		sim.tick(key);
+	}
+	if (sim.complete())
+	{
+		r.played = true;
+		r.ticks = sim.ticks();
+		r.bonus_left = sim.bonus();
+	}
+	return r;
+}
+
+int Analyser::analyseAll(const LevelSet &l, const std::string &filename,
+	std::ostream &out)
+{
+	std::ofstream f(filename.c_str());
+	if (!f.is_open())
+	{
+		out << "Could not open \"" << filename << "\" for writing" << std::endl;
+		return -1;
+	}
+
+	// Levels vary a lot in how long they take, so hand them out
+	// one at a time
+	std::vector<Result> results(l.size());
+	ThreadPool pool;
+	pool.parallelFor(l.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+			results[i] = analyse(l, i);
+	});
+
+	bool json = (filename.size() >= 5
+		&& filename.compare(filename.size() - 5, 5, ".json") == 0);
+	const char *fields[] = {
+		"level", "name", "width", "height", "boxes", "balls", "solved",
+		"optimal", "exhaustive", "pushes", "moves", "ball_slides", "states",
+		"deadlock_density", "bonus", "seconds", "bonus_left",
+		"bonus_achievable"
+	};
+	const int num_fields = sizeof(fields) / sizeof(fields[0]);
+	if (json)
+		f << '[' << std::endl;
+	else
+	{
+		for (int i = 0; i < num_fields; ++i)
+			f << (i ? "," : "") << fields[i];
+		f << std::endl;
+	}
+
+	int failures = 0;
+	int solved = 0;
+	int achievable = 0;
+	for (size_t i = 0; i < l.size(); ++i)
+	{
+		const Level &level = l[i];
+		const Result &r = results[i];
+		int boxes = 0;
+		for (uint8_t j = 0; j < level.num_sprites; ++j)
+		{
+			if (level.spriteinfo[j].index == Board::BoxPiece)
+				++boxes;
+		}
+		bool bonus = (r.played && r.bonus_left > 0);
+		if (r.solved)
+			++solved;
+		if (bonus)
+			++achievable;
+		if (!r.solved)
+			out << "Level " << i << ": no solution found" << std::endl;
+		else if (!r.played)
+		{
+			out << "Level " << i << ": solution could not be played through"
+				<< std::endl;
+			++failures;
+		}
+
+		auto flag = [&](bool b) { return json ? (b ? "true" : "false")
+			: (b ? "1" : "0"); };
+		const std::string name = '"' + escape(level.name, json) + '"';
+		std::ostringstream values[num_fields];
+		values[0] << i;
+		values[1] << name;
+		values[2] << level.width;
+		values[3] << level.height;
+		values[4] << boxes;
+		values[5] << ((level.num_sprites - 1) - boxes);
+		values[6] << flag(r.solved);
+		values[7] << flag(r.optimal);
+		values[8] << flag(r.exhaustive);
+		values[9] << r.pushes;
+		values[10] << r.moves;
+		values[11] << r.ball_slides;
+		values[12] << r.states;
+		values[13] << r.deadlock_density;
+		values[14] << level.bonus;
+		values[15] << ((double)(r.ticks) / P2_TICK_RATE);
+		values[16] << r.bonus_left;
+		values[17] << flag(bonus);
+
+		if (json)
+			f << "  {";
+		for (int j = 0; j < num_fields; ++j)
+		{
+			if (j)
+				f << (json ? ", " : ",");
+			if (json)
+				f << '"' << fields[j] << "\": ";
+			f << values[j].str();
+		}
+		if (json)
+			f << ((i + 1 < l.size()) ? "}," : "}");
+		f << std::endl;
+	}
+	if (json)
+		f << ']' << std::endl;
+
+	f.close();
+	if (!f)
+	{
+		out << "Could not write \"" << filename << "\"" << std::endl;
+		return -1;
+	}
+	out << "Analysed " << l.size() << " levels: " << solved
+		<< " solved, bonus achievable in " << achievable << std::endl;
+	return failures;
+}
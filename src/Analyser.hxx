@@ -0,0 +1,86 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HXX_ANALYSER
+#define HXX_ANALYSER
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "LevelSet.hxx"
+#include "Board.hxx"
+
+// Measures of how hard levels are, for putting level sets in order and
+// tuning the bonus counter.  Every position reachable from a level's
+// start is searched (see Search), up to a limit; past that, the counts
+// given are bounds rather than exact, and the hint solver is asked for
+// a solution instead.  Positions with something pushed into a corner
+// are counted, but not searched on from.
+namespace Analyser
+{
+	struct Result
+	{
+		// Whether a solution was found; whether it has the fewest
+		// pushes possible, or is only the hint solver's best effort;
+		// and whether every reachable position was searched
+		bool solved;
+		bool optimal;
+		bool exhaustive;
+
+		// Pushes in the solution; player steps taken in it (an upper
+		// bound on the fewest); and how many pushes set a ball rolling
+		uint32_t pushes;
+		uint32_t moves;
+		uint32_t ball_slides;
+
+		// Positions reachable, and the fraction of them from which the
+		// level can no longer be solved.  If the search wasn't
+		// exhaustive, the count is a lower bound, and the fraction only
+		// an estimate from the positions searched, counting any with
+		// pushes left unsearched as still solvable.
+		uint32_t states;
+		double deadlock_density;
+
+		// Playing the solution through in the game, a step at a time:
+		// whether it finished the level, the ticks it took, and the
+		// bonus counter left at the end.  The level's bonus is
+		// achievable if there is any left.
+		bool played;
+		uint32_t ticks;
+		int bonus_left;
+	};
+
+	// If solution is given, the steps taken in the solution found,
+	// if any, are left there
+	Result analyse(const LevelSet &l, int level,
+		std::vector<Direction> *solution = NULL);
+
+	// Analyse every level in the set, spread across all cores, and write
+	// the results to the given file: JSON if its name ends in ".json",
+	// otherwise CSV.  Writes a line per level which couldn't be solved,
+	// then a summary.  Returns the number of solutions which didn't
+	// finish their levels when played through in the game, which would
+	// mean Board and the game disagree, or -1 if the file couldn't be
+	// written.
+	int analyseAll(const LevelSet &l, const std::string &filename,
+		std::ostream &out);
+}
+
+#endif
@@ -0,0 +1,161 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <sstream>
+#include <tuple>
+#include <cstdlib>
+
+// System
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// Library
+#include <SDL.h>
+
+// Local
+#include "AssetRegistry.hxx"
+
+//
+// Implementation
+//
+
+std::map<AssetRegistry::Key, AssetRegistry::Entry> AssetRegistry::m_sets;
+std::mutex AssetRegistry::m_mutex;
+
+namespace
+{
+	// String identifying the file with the given name, for as long as
+	// it isn't edited.  Files which can't be found are left to
+	// TileSet's constructor to complain about.
+	std::string fileIdentity(const char *filename)
+	{
+		struct stat st;
+		if (stat(filename, &st) < 0)
+			return std::string(filename);
+
+		std::ostringstream id;
+#ifdef WIN32
+		// No inode numbers here; go by full path instead
+		char path[_MAX_PATH];
+		id << (_fullpath(path, filename, _MAX_PATH) ? path : filename);
+#else
+		id << st.st_dev << ':' << st.st_ino;
+#endif
+		id << ':' << st.st_size << ':' << st.st_mtime;
+		return id.str();
+	}
+}
+
+bool AssetRegistry::Key::operator<(const Key &other) const
+{
+	return (std::tie(file, width, height, colorkey, bpp, rmask, gmask, bmask)
+		< std::tie(other.file, other.width, other.height, other.colorkey,
+			other.bpp, other.rmask, other.gmask, other.bmask));
+}
+
+std::shared_ptr<TileSet> AssetRegistry::tiles(const char *filename,
+	int width, int height, bool colorkey, bool display)
+{
+	Key key;
+	key.file = fileIdentity(filename);
+	key.width = width;
+	key.height = height;
+	key.colorkey = colorkey;
+	key.bpp = 0;
+	key.rmask = 0;
+	key.gmask = 0;
+	key.bmask = 0;
+	if (display)
+	{
+		const SDL_PixelFormat *f = SDL_GetVideoSurface()->format;
+		key.bpp = f->BytesPerPixel;
+		key.rmask = f->Rmask;
+		key.gmask = f->Gmask;
+		key.bmask = f->Bmask;
+	}
+
+	// Use the set if it's there, wait for it if somebody else is
+	// loading it, or else say that we are
+	std::promise<std::shared_ptr<TileSet>> loaded;
+	std::shared_future<std::shared_ptr<TileSet>> loading;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		Entry &e = m_sets[key];
+		std::shared_ptr<TileSet> t(e.set.lock());
+		if (t)
+			return t;
+		loading = e.loading;
+		if (!loading.valid())
+			e.loading = loaded.get_future().share();
+	}
+	if (loading.valid())
+		return loading.get();
+
+	std::shared_ptr<TileSet> t;
+	try
+	{
+		if (display)
+		{
+			std::shared_ptr<TileSet> as_loaded(tiles(filename, width,
+				height, colorkey, false));
+			t.reset(TileSet::displayCopy(*as_loaded));
+		}
+		else
+			t.reset(new TileSet(filename, width, height, colorkey));
+	}
+	catch (...)
+	{
+		// Let anybody waiting see the failure, and the next caller
+		// try again
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_sets[key].loading = std::shared_future<
+				std::shared_ptr<TileSet>>();
+		}
+		loaded.set_exception(std::current_exception());
+		throw;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		Entry &e = m_sets[key];
+		e.set = t;
+		e.loading = std::shared_future<std::shared_ptr<TileSet>>();
+
+		// Forget sets which are no longer in use
+		for (auto i = m_sets.begin(); i != m_sets.end(); )
+		{
+			if (i->second.set.expired() && !i->second.loading.valid())
+				m_sets.erase(i++);
+			else
+				++i;
+		}
+	}
+	loaded.set_value(t);
+	return t;
+}
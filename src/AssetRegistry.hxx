@@ -0,0 +1,89 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HXX_ASSETREGISTRY
+#define HXX_ASSETREGISTRY
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <string>
+#include <cstdint>
+
+#include "TileSet.hxx"
+
+// Process-wide cache of loaded tile sets, so that level sets naming the
+// same files - the original sets all use the same sprites, for instance -
+// share one copy of each, however many of them are loaded.
+//
+// Sets are told apart by the identity of the file they come from (device
+// and inode, or full path where there are no inode numbers, plus size and
+// modification time, so that edited files are loaded afresh), how they
+// are cut into tiles, and the pixel format they are in.  Only weak
+// references are kept: a set is freed as soon as the last level set using
+// it is, so memory use follows the number of distinct sets in use.
+class AssetRegistry
+{
+	public:
+		// The tile set in the given file, loaded as by TileSet's
+		// constructor, and converted to the screen's pixel format if
+		// display is true.  Shares a copy already in use if there is
+		// one; otherwise loads it, throwing as TileSet does on failure.
+		// Converted sets are copied from the set as loaded, loading
+		// that first if need be.
+		//
+		// Files are loaded without holding up callers wanting other
+		// sets, and callers wanting one already being loaded wait for
+		// it rather than loading it again.  Safe to call from any
+		// thread with display false; converting uses SDL's video
+		// functions, so only the thread which set the video mode may
+		// ask for that.
+		static std::shared_ptr<TileSet> tiles(const char *filename,
+			int width, int height, bool colorkey = false,
+			bool display = false);
+
+	private:
+		struct Key
+		{
+			std::string file;
+			int width;
+			int height;
+			bool colorkey;
+
+			// Pixel format converted to, or all 0 for as loaded
+			int bpp;
+			uint32_t rmask;
+			uint32_t gmask;
+			uint32_t bmask;
+
+			bool operator<(const Key &other) const;
+		};
+
+		// A set in use, or being loaded by the first caller to ask
+		struct Entry
+		{
+			std::weak_ptr<TileSet> set;
+			std::shared_future<std::shared_ptr<TileSet>> loading;
+		};
+
+		static std::map<Key, Entry> m_sets;
+		static std::mutex m_mutex;
+};
+
+#endif
@@ -0,0 +1,319 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <iostream>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+
+// System
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+// Library
+#include <SDL.h>
+
+// Local
+#include "AssetWatcher.hxx"
+
+//
+// Implementation
+//
+
+// Once a file has changed, wait this long for any more changes before
+// loading it, as editors often save in more than one step
+#define WATCH_SETTLE_MS 20
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+AssetWatcher::AssetWatcher(const LevelSet &l, const std::string &levels_file,
+	const std::string &alphabet_file)
+	: m_inotify(-1), m_ready(false)
+{
+	m_files[Tiles] = l.getTilesFile();
+	m_files[Sprites] = l.getSpritesFile();
+	m_files[PlayerSprites] = l.getPlayerSpritesFile();
+	m_files[Glyphs] = alphabet_file;
+	m_files[Levels] = levels_file;
+
+	// Watch the directories rather than the files, so that files saved
+	// by writing a new copy and renaming it over the old are noticed.
+	// Adding a watch on a directory already watched gives back the same
+	// descriptor, so files sharing a directory share its watch.
+	m_inotify = inotify_init();
+	if (m_inotify < 0)
+		throw std::runtime_error(std::string("inotify: ") + strerror(errno));
+	for (int i = 0; i < NumFiles; ++i)
+	{
+		size_t slash = m_files[i].rfind('/');
+		std::string dir(".");
+		if (slash == 0)
+			dir = "/";
+		else if (slash != std::string::npos)
+			dir = m_files[i].substr(0, slash);
+		int wd = inotify_add_watch(m_inotify, dir.c_str(),
+			IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (wd < 0)
+		{
+			std::string e(strerror(errno));
+			close(m_inotify);
+			throw std::runtime_error("inotify: \"" + dir + "\": " + e);
+		}
+		std::string name(slash == std::string::npos ? m_files[i]
+			: m_files[i].substr(slash + 1));
+		m_watched[std::make_pair(wd, name)] |= (1 << i);
+	}
+	if (pipe(m_quit_pipe) < 0)
+	{
+		std::string e(strerror(errno));
+		close(m_inotify);
+		throw std::runtime_error(std::string("inotify: ") + e);
+	}
+
+	m_thread = std::thread(&AssetWatcher::run, this);
+}
+
+AssetWatcher::~AssetWatcher()
+{
+	char c = 0;
+	while (write(m_quit_pipe[1], &c, 1) < 0 && errno == EINTR)
+		;
+	m_thread.join();
+	close(m_quit_pipe[0]);
+	close(m_quit_pipe[1]);
+	close(m_inotify);
+}
+
+bool AssetWatcher::supported()
+{
+	return true;
+}
+
+void AssetWatcher::run()
+{
+	pollfd fds[2] = {
+		{ m_inotify, POLLIN, 0 },
+		{ m_quit_pipe[0], POLLIN, 0 }
+	};
+	unsigned changed = 0;
+	char buffer[4096]
+		__attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+	for (;;)
+	{
+		int r = poll(fds, 2, changed ? WATCH_SETTLE_MS : -1);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r < 0 || (fds[1].revents & POLLIN))
+			break;
+
+		// Nothing more has changed for a while - load what did
+		if (r == 0)
+		{
+			load(changed);
+			changed = 0;
+			continue;
+		}
+
+		ssize_t len = read(m_inotify, buffer, sizeof(buffer));
+		for (char *p = buffer; len > 0 && p < buffer + len; )
+		{
+			const inotify_event *e = (const inotify_event*)p;
+			if (e->len)
+			{
+				auto w = m_watched.find(std::make_pair(e->wd,
+					std::string(e->name)));
+				if (w != m_watched.end())
+					changed |= w->second;
+			}
+			p += sizeof(inotify_event) + e->len;
+		}
+	}
+}
+
+#else
+
+AssetWatcher::AssetWatcher(const LevelSet &l, const std::string &levels_file,
+	const std::string &alphabet_file)
+	: m_inotify(-1), m_ready(false)
+{
+	throw std::runtime_error("watching files is not supported on this system");
+}
+
+AssetWatcher::~AssetWatcher()
+{
+}
+
+bool AssetWatcher::supported()
+{
+	return false;
+}
+
+void AssetWatcher::run()
+{
+}
+
+#endif
+
+void AssetWatcher::load(unsigned files)
+{
+	// Load everything before taking the mutex, so that the main
+	// thread never waits for a file to be read
+	std::unique_ptr<TileSet> tilesets[3];
+	std::unique_ptr<Alphabet> alphabet;
+	std::unique_ptr<LevelSet> levels;
+	for (int i = 0; i < NumFiles; ++i)
+	{
+		if (!(files & (1 << i)))
+			continue;
+		try
+		{
+			if (i == Glyphs)
+				alphabet.reset(new Alphabet(m_files[i].c_str()));
+			else if (i == Levels)
+				levels.reset(new LevelSet(m_files[i].c_str(), false));
+			else
+			{
+				tilesets[i].reset(new TileSet(m_files[i].c_str(),
+					P2_TILE_WIDTH, P2_TILE_HEIGHT, i != Tiles));
+			}
+		}
+		catch (std::exception &e)
+		{
+			std::cerr << "Could not reload \"" << m_files[i] << "\": "
+				<< e.what() << std::endl;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	bool loaded = false;
+	for (int i = 0; i < 3; ++i)
+	{
+		if (tilesets[i])
+		{
+			m_tilesets[i] = std::move(tilesets[i]);
+			loaded = true;
+		}
+	}
+	if (alphabet)
+	{
+		m_alphabet = std::move(alphabet);
+		loaded = true;
+	}
+	if (levels)
+	{
+		m_levels = std::move(levels);
+		loaded = true;
+	}
+	if (!loaded)
+		return;
+	m_ready.store(true, std::memory_order_release);
+
+	// Wake the main loop, in case it is sleeping on a static screen
+	SDL_Event e;
+	e.type = SDL_USEREVENT;
+	e.user.code = 0;
+	e.user.data1 = NULL;
+	e.user.data2 = NULL;
+	SDL_PushEvent(&e);
+}
+
+unsigned AssetWatcher::apply(LevelSet &l, Alphabet &a)
+{
+	if (!ready())
+		return 0;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_ready.store(false, std::memory_order_release);
+	unsigned changed = 0;
+
+	const TileSet *live[3] = {
+		&(l.getTiles()), &(l.getSprites()), &(l.getPlayerSprites())
+	};
+	for (int i = 0; i < 3; ++i)
+	{
+		if (!m_tilesets[i])
+			continue;
+		std::unique_ptr<TileSet> t(std::move(m_tilesets[i]));
+		if (t->size() < live[i]->size())
+		{
+			std::cerr << "\"" << m_files[i] << "\" has fewer tiles than"
+				" before; not reloaded" << std::endl;
+			continue;
+		}
+		try
+		{
+			t->convertToDisplayFormat();
+		}
+		catch (std::exception &e)
+		{
+			std::cerr << "Could not reload \"" << m_files[i] << "\": "
+				<< e.what() << std::endl;
+			continue;
+		}
+
+		// The old set ends up in t, and is freed with it
+		if (i == Tiles)
+		{
+			l.swapTiles(*t);
+			changed |= P2_ASSET_TILES;
+		}
+		else
+		{
+			if (i == Sprites)
+				l.swapSprites(*t);
+			else
+				l.swapPlayerSprites(*t);
+			changed |= P2_ASSET_SPRITES;
+		}
+	}
+
+	if (m_alphabet)
+	{
+		a.swap(*m_alphabet);
+		m_alphabet.reset();
+		changed |= P2_ASSET_GLYPHS;
+	}
+
+	if (m_levels)
+	{
+		if (l.replaceLevels(*m_levels))
+			changed |= P2_ASSET_LEVELS;
+		else
+		{
+			std::cerr << "\"" << m_files[Levels] << "\" has a different"
+				" number of levels; not reloaded" << std::endl;
+		}
+		m_levels.reset();
+	}
+
+	return changed;
+}
@@ -0,0 +1,109 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HXX_ASSETWATCHER
+#define HXX_ASSETWATCHER
+
+#include <string>
+#include <map>
+#include <utility>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+#include "LevelSet.hxx"
+#include "Alphabet.hxx"
+
+// Reloads the game's data files while it runs, as they are edited, so
+// that changes to levels, tiles, sprites and glyphs show up without
+// starting the game again.
+//
+// A thread of its own waits for the files to change (using inotify, so
+// only where that is available), and loads each changed file afresh.
+// Nothing live is touched until the main thread calls apply() between
+// frames, which swaps the new data into the live LevelSet and Alphabet
+// in place, so that references to them stay valid.  It is then up to
+// the caller to rebuild whatever was made from the old data; see
+// GameLoop::reload and LevelView::reloaded.
+class AssetWatcher
+{
+	public:
+		// Watch the level set loaded from levels_file, the tiles and
+		// sprites it names, and the glyphs in alphabet_file.  Names
+		// without a directory are taken to be in the current one.
+		// Throws std::runtime_error if they can't be watched.
+		AssetWatcher(const LevelSet &l, const std::string &levels_file,
+			const std::string &alphabet_file);
+		~AssetWatcher();
+
+		// False if files can't be watched on this system at all
+		static bool supported();
+
+		// True if anything has been reloaded since the last apply()
+		bool ready() const
+		{
+			return m_ready.load(std::memory_order_acquire);
+		};
+
+		// Swap anything reloaded since the last call into the live
+		// data, and return P2_ASSET_* flags saying what changed.  Call
+		// from the main thread, when nothing is being drawn.  Files
+		// which no longer fit the rest of the data - fewer tiles than
+		// before, or a different number of levels - are left out.
+		unsigned apply(LevelSet &l, Alphabet &a);
+
+	private:
+		// Files watched, in the order of m_files
+		enum File
+		{
+			Tiles,
+			Sprites,
+			PlayerSprites,
+			Glyphs,
+			Levels,
+			NumFiles
+		};
+
+		void run();
+
+		// Load the files with the given (1 << File) bits set
+		void load(unsigned files);
+
+		std::string m_files[NumFiles];
+
+		// inotify descriptor, and a pipe written to to stop the thread
+		int m_inotify;
+		int m_quit_pipe[2];
+
+		// (1 << File) bits for each file, by the watch on its directory
+		// and its name within it
+		std::map<std::pair<int, std::string>, unsigned> m_watched;
+
+		// Files loaded but not yet applied.  The main thread only
+		// takes the mutex when m_ready says there is something there.
+		std::mutex m_mutex;
+		std::unique_ptr<TileSet> m_tilesets[3];
+		std::unique_ptr<Alphabet> m_alphabet;
+		std::unique_ptr<LevelSet> m_levels;
+		std::atomic<bool> m_ready;
+
+		std::thread m_thread;
+};
+
+#endif
@@ -0,0 +1,311 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <algorithm>
+#include <cstring>
+
+// System
+
+// Library
+
+// Local
+#include "BandCompositor.hxx"
+#include "RleSprite.hxx"
+#include "Pixels.hxx"
+
+//
+// Implementation
+//
+
+// Blend one 8-bit channel of a source pixel over a destination pixel
+static inline Uint8 blendChannel(Uint8 s, Uint8 d, int alpha)
+{
+	return (Uint8)(d + (((s - d) * alpha) / 255));
+}
+
+// Draws commands onto one band of the (already locked) target,
+// clipped to the band and the target's clip rectangle
+class BandCompositor::Band: public RenderBackend
+{
+	public:
+		Band(SDL_Surface *target, int top, int bottom)
+			: m_pixels((uint8_t*)(target->pixels)), m_pitch(target->pitch),
+			  m_format(target->format)
+		{
+			const SDL_Rect &clip = target->clip_rect;
+			m_left = clip.x;
+			m_right = clip.x + clip.w;
+			m_top = std::max(top, (int)clip.y);
+			m_bottom = std::min(bottom, clip.y + clip.h);
+		};
+
+		void blit(SDL_Surface *source, const SDL_Rect &src_rect,
+			int x, int y, uint8_t alpha);
+		void sprite(const RleSprite &sprite, int x, int y);
+		void fill(const SDL_Rect &rect, uint8_t r, uint8_t g, uint8_t b);
+
+	private:
+		uint8_t *m_pixels;
+		int m_pitch;
+		const SDL_PixelFormat *m_format;
+		int m_left;
+		int m_top;
+		int m_right;
+		int m_bottom;
+};
+
+void BandCompositor::Band::blit(SDL_Surface *source,
+	const SDL_Rect &src_rect, int x, int y, uint8_t alpha)
+{
+	// Sources which couldn't be locked can't be read
+	if (SDL_MUSTLOCK(source) && !source->locked)
+		return;
+
+	// Clip to the source surface, then to the band
+	int sx = src_rect.x;
+	int sy = src_rect.y;
+	int w = src_rect.w;
+	int h = src_rect.h;
+	if (sx < 0)
+	{
+		w += sx;
+		x -= sx;
+		sx = 0;
+	}
+	if (sy < 0)
+	{
+		h += sy;
+		y -= sy;
+		sy = 0;
+	}
+	w = std::min(w, source->w - sx);
+	h = std::min(h, source->h - sy);
+	if (x < m_left)
+	{
+		w -= m_left - x;
+		sx += m_left - x;
+		x = m_left;
+	}
+	if (y < m_top)
+	{
+		h -= m_top - y;
+		sy += m_top - y;
+		y = m_top;
+	}
+	w = std::min(w, m_right - x);
+	h = std::min(h, m_bottom - y);
+	if (w <= 0 || h <= 0)
+		return;
+
+	// The same opacity as SurfaceBackend would end up drawing at
+	int a = alpha;
+	if (a == 255 && (source->flags & SDL_SRCALPHA))
+		a = source->format->alpha;
+	if (a == 0)
+		return;
+	const SDL_PixelFormat *f = source->format;
+	const SDL_PixelFormat *df = m_format;
+	int bpp = f->BytesPerPixel;
+	int dbpp = df->BytesPerPixel;
+	bool keyed = ((source->flags & SDL_SRCCOLORKEY) != 0);
+	bool same = (bpp == dbpp && f->Rmask == df->Rmask
+		&& f->Gmask == df->Gmask && f->Bmask == df->Bmask);
+
+	for (int r = 0; r < h; ++r)
+	{
+		const uint8_t *src = (const uint8_t*)(source->pixels)
+			+ ((sy + r) * source->pitch) + (sx * bpp);
+		uint8_t *dest = m_pixels + ((y + r) * m_pitch) + (x * dbpp);
+
+		// Straight copies for the common case
+		if (same && !keyed && a == 255)
+		{
+			memcpy(dest, src, w * bpp);
+			continue;
+		}
+
+		for (int i = 0; i < w; ++i)
+		{
+			uint32_t v = loadPixel(src + (i * bpp), bpp);
+			if (keyed && v == f->colorkey)
+				continue;
+			if (a != 255)
+			{
+				Uint8 sr, sg, sb, dr, dg, db;
+				SDL_GetRGB(v, (SDL_PixelFormat*)f, &sr, &sg, &sb);
+				SDL_GetRGB(loadPixel(dest + (i * dbpp), dbpp),
+					(SDL_PixelFormat*)df, &dr, &dg, &db);
+				v = SDL_MapRGB((SDL_PixelFormat*)df, blendChannel(sr, dr, a),
+					blendChannel(sg, dg, a), blendChannel(sb, db, a));
+			}
+			else if (!same)
+			{
+				Uint8 red, green, blue;
+				SDL_GetRGB(v, (SDL_PixelFormat*)f, &red, &green, &blue);
+				v = SDL_MapRGB((SDL_PixelFormat*)df, red, green, blue);
+			}
+			storePixel(dest + (i * dbpp), v, dbpp);
+		}
+	}
+}
+
+void BandCompositor::Band::sprite(const RleSprite &sprite, int x, int y)
+{
+	if (m_top >= m_bottom)
+		return;
+	SDL_Rect clip = {
+		(Sint16)m_left, (Sint16)m_top,
+		(Uint16)(m_right - m_left), (Uint16)(m_bottom - m_top)
+	};
+	sprite.blit(m_pixels, m_pitch, m_format, clip, x, y);
+}
+
+void BandCompositor::Band::fill(const SDL_Rect &rect, uint8_t r, uint8_t g,
+	uint8_t b)
+{
+	int left = std::max((int)rect.x, m_left);
+	int top = std::max((int)rect.y, m_top);
+	int right = std::min(rect.x + rect.w, m_right);
+	int bottom = std::min(rect.y + rect.h, m_bottom);
+	if (left >= right)
+		return;
+	int bpp = m_format->BytesPerPixel;
+	uint32_t colour = SDL_MapRGB((SDL_PixelFormat*)m_format, r, g, b);
+	for (int y = top; y < bottom; ++y)
+	{
+		uint8_t *row = m_pixels + (y * m_pitch);
+		if (bpp == 4)
+		{
+			std::fill((uint32_t*)row + left, (uint32_t*)row + right, colour);
+			continue;
+		}
+		for (int x = left; x < right; ++x)
+			storePixel(row + (x * bpp), colour, bpp);
+	}
+}
+
+// Gets everything in a queue ready to be drawn from several threads at
+// once: sources are locked, and sprites encoded for the target
+class BandCompositor::Preparer: public RenderBackend
+{
+	public:
+		Preparer(const SDL_PixelFormat *format,
+			std::vector<SDL_Surface*> &locked)
+			: m_format(format), m_locked(locked)
+		{};
+
+		void blit(SDL_Surface *source, const SDL_Rect &src_rect,
+			int x, int y, uint8_t alpha)
+		{
+			if (SDL_MUSTLOCK(source) && SDL_LockSurface(source) == 0)
+				m_locked.push_back(source);
+		};
+
+		void sprite(const RleSprite &sprite, int x, int y)
+		{
+			sprite.prepare(m_format);
+		};
+
+		void fill(const SDL_Rect &rect, uint8_t r, uint8_t g, uint8_t b)
+		{
+		};
+
+	private:
+		const SDL_PixelFormat *m_format;
+		std::vector<SDL_Surface*> &m_locked;
+};
+
+BandCompositor::BandCompositor(SDL_Surface *target, ThreadPool &pool,
+	int band_height)
+	: m_target(target), m_pool(pool), m_band_height(band_height)
+{
+	if (m_band_height <= 0)
+	{
+		int bands = m_pool.size() * 2;
+		m_band_height = std::max(1, (target->h + bands - 1) / bands);
+	}
+}
+
+bool BandCompositor::lockTarget()
+{
+	return (!SDL_MUSTLOCK(m_target) || SDL_LockSurface(m_target) == 0);
+}
+
+void BandCompositor::unlockTarget()
+{
+	if (SDL_MUSTLOCK(m_target))
+		SDL_UnlockSurface(m_target);
+}
+
+void BandCompositor::drawQueue(const RenderQueue &queue)
+{
+	if (!lockTarget())
+		return;
+
+	Preparer p(m_target->format, m_locked);
+	queue.drawBand(p, 0, m_target->h);
+
+	m_pool.parallelFor(m_target->h, m_band_height,
+		[this, &queue](size_t top, size_t bottom) {
+			Band b(m_target, top, bottom);
+			queue.drawBand(b, top, bottom);
+		});
+
+	for (auto i = m_locked.cbegin(); i != m_locked.cend(); ++i)
+		SDL_UnlockSurface(*i);
+	m_locked.clear();
+	unlockTarget();
+}
+
+void BandCompositor::blit(SDL_Surface *source, const SDL_Rect &src_rect,
+	int x, int y, uint8_t alpha)
+{
+	if (!lockTarget())
+		return;
+	if (!SDL_MUSTLOCK(source) || SDL_LockSurface(source) == 0)
+	{
+		Band(m_target, 0, m_target->h).blit(source, src_rect, x, y, alpha);
+		if (SDL_MUSTLOCK(source))
+			SDL_UnlockSurface(source);
+	}
+	unlockTarget();
+}
+
+void BandCompositor::sprite(const RleSprite &sprite, int x, int y)
+{
+	sprite.blit(m_target, x, y);
+}
+
+void BandCompositor::fill(const SDL_Rect &rect, uint8_t r, uint8_t g,
+	uint8_t b)
+{
+	if (!lockTarget())
+		return;
+	Band(m_target, 0, m_target->h).fill(rect, r, g, b);
+	unlockTarget();
+}
@@ -0,0 +1,73 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HXX_BANDCOMPOSITOR
+#define HXX_BANDCOMPOSITOR
+
+#include <vector>
+#include <cstdint>
+
+#include <SDL.h>
+
+#include "RenderQueue.hxx"
+#include "ThreadPool.hxx"
+
+// Backend drawing onto an SDL surface in horizontal bands, spread across
+// the threads of a ThreadPool, for when composing whole frames on one
+// core can't keep up.  Every band is drawn from the same queue, each
+// thread drawing only the commands which touch its own band.
+//
+// SDL's blitters keep state in the source surface, so they can't be run
+// from several threads at once; this has blitters of its own instead.
+// Opaque and colour-keyed drawing gives the same pixels as SDL does;
+// translucent drawing blends as MemoryBackend does, which may differ by
+// one in places.  Per-pixel alpha is ignored.
+class BandCompositor: public RenderBackend
+{
+	public:
+		// Bands are band_height rows tall; 0 means enough for two
+		// bands per thread, so that no thread is left idle for long
+		// if some bands take longer than others
+		BandCompositor(SDL_Surface *target, ThreadPool &pool,
+			int band_height = 0);
+
+		void drawQueue(const RenderQueue &queue);
+
+		// Single commands, outside of a queue, are drawn in one go
+		// on the calling thread
+		void blit(SDL_Surface *source, const SDL_Rect &src_rect,
+			int x, int y, uint8_t alpha);
+		void sprite(const RleSprite &sprite, int x, int y);
+		void fill(const SDL_Rect &rect, uint8_t r, uint8_t g, uint8_t b);
+
+	private:
+		class Band;
+		class Preparer;
+
+		bool lockTarget();
+		void unlockTarget();
+
+		SDL_Surface *m_target;
+		ThreadPool &m_pool;
+		int m_band_height;
+
+		// Sources locked for the duration of drawQueue()
+		std::vector<SDL_Surface*> m_locked;
+};
+
+#endif
@@ -0,0 +1,172 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+// System
+
+// Library
+
+// Local
+#include "BatchEnv.hxx"
+#include "LevelSet.hxx"
+
+//
+// Implementation
+//
+
+// Games per chunk handed to each thread
+#define STEP_CHUNK 1024
+
+BatchEnv::BatchEnv(const LevelSet &l, size_t count, uint8_t *observations,
+	ThreadPool &pool)
+	: m_envs(count), m_observations(observations),
+	  m_plane_size(observationSize(l) / 2), m_pool(pool)
+{
+	if (l.size() == 0)
+		throw std::runtime_error("Level set contains no levels");
+
+	m_boards.reserve(l.size());
+	for (size_t i = 0; i < l.size(); ++i)
+		m_boards.push_back(Board(l[i], l.firstFloorTile(), l.firstCrossTile()));
+
+	for (size_t i = 0; i < count; ++i)
+		resetOne(i, i % m_boards.size());
+}
+
+size_t BatchEnv::observationSize(const LevelSet &l)
+{
+	size_t plane = 0;
+	for (size_t i = 0; i < l.size(); ++i)
+		plane = std::max(plane, (size_t)(l[i].width * l[i].height));
+	return plane * 2;
+}
+
+void BatchEnv::reset(const uint32_t *ids, size_t count,
+	const uint32_t *levels)
+{
+	m_pool.parallelFor(count, STEP_CHUNK, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+		{
+			uint32_t level = levels ? levels[i] : m_envs[ids[i]].level;
+			if (level >= m_boards.size())
+				level %= m_boards.size();
+			resetOne(ids[i], level);
+		}
+	});
+}
+
+void BatchEnv::step(const int8_t *actions, int8_t *rewards, uint8_t *done)
+{
+	m_pool.parallelFor(m_envs.size(), STEP_CHUNK, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+			stepOne(i, actions[i], rewards[i], done[i]);
+	});
+}
+
+void BatchEnv::resetOne(size_t id, uint32_t level)
+{
+	const Board &b = m_boards[level];
+	Env &e = m_envs[id];
+	e.state = b.initialState();
+	e.level = level;
+	e.on_cross = 0;
+
+	uint8_t *tiles = m_observations + (id * observationSize());
+	uint8_t *objects = tiles + m_plane_size;
+	int squares = b.numSquares();
+	for (int i = 0; i < squares; ++i)
+	{
+		if (b.isCross(i))
+			tiles[i] = CrossTile;
+		else if (b.isFloor(i))
+			tiles[i] = FloorTile;
+		else
+			tiles[i] = WallTile;
+	}
+
+	memset(tiles + squares, WallTile, m_plane_size - squares);
+	memset(objects, NoObject, m_plane_size);
+	objects[e.state.player] = PlayerObject;
+	for (int i = 0; i < b.numObjects(); ++i)
+	{
+		objects[e.state.objects[i]] = b.pieceAt(i);
+		if (b.isCross(e.state.objects[i]))
+			++e.on_cross;
+	}
+	e.done = (e.on_cross == b.numObjects());
+}
+
+void BatchEnv::stepOne(size_t id, int8_t action, int8_t &reward,
+	uint8_t &done)
+{
+	Env &e = m_envs[id];
+	reward = 0;
+	done = e.done;
+	if (e.done || action < 0 || action > Down)
+		return;
+
+	// As Board::move, but using the object plane as the occupancy grid,
+	// which saves building one.  The player's own square is marked too,
+	// but nothing is ever pushed into it.
+	const Board &b = m_boards[e.level];
+	uint8_t *objects = m_observations + (id * observationSize())
+		+ m_plane_size;
+	Direction d = (Direction)action;
+
+	int dest = b.neighbour(e.state.player, d);
+	if (dest < 0 || !b.isFloor(dest))
+		return;
+
+	if (objects[dest] != NoObject)
+	{
+		Board::Piece p = (Board::Piece)objects[dest];
+		int to = b.pushDestination(objects, dest, p, d);
+		if (to < 0)
+			return;
+
+		for (int i = 0; i < b.numObjects(); ++i)
+		{
+			if (e.state.objects[i] == dest)
+			{
+				e.state.objects[i] = to;
+				break;
+			}
+		}
+		objects[to] = p;
+		reward = (int8_t)(b.isCross(to) - b.isCross(dest));
+		e.on_cross += reward;
+		e.done = (e.on_cross == b.numObjects());
+		done = e.done;
+	}
+
+	objects[e.state.player] = NoObject;
+	objects[dest] = PlayerObject;
+	e.state.player = dest;
+}
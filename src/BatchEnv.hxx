@@ -0,0 +1,118 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HXX_BATCHENV
+#define HXX_BATCHENV
+
+#include <cstdint>
+#include <vector>
+
+#include "Board.hxx"
+#include "ThreadPool.hxx"
+
+class LevelSet;
+
+// Many independent games, stepped together, for bots and automated
+// level testing.  Each game steps a square at a time under the rules
+// of Board - there is no animation, and nothing touches SDL.
+//
+// Observations live in a single buffer owned by the caller, holding
+// observationSize() bytes per game: a plane of Tile values, then a plane
+// of Object values.  Each plane has room for the biggest level in the
+// set, and holds one byte per square of the game's current level, row by
+// row, followed by zeroes.  The tile plane is only written on reset;
+// steps just patch the squares which changed in the object plane.
+class BatchEnv
+{
+	public:
+		enum Tile
+		{
+			WallTile = 0,
+			FloorTile = 1,
+			CrossTile = 2
+		};
+
+		// Boxes and balls use their Board::Piece values
+		enum Object
+		{
+			NoObject = Board::NoPiece,
+			BoxObject = Board::BoxPiece,
+			BallObject = Board::BallPiece,
+			PlayerObject = 3
+		};
+
+		// Game i starts on level (i % number of levels).  Observations
+		// must hold count * observationSize(l) bytes, and outlive us.
+		BatchEnv(const LevelSet &l, size_t count, uint8_t *observations,
+			ThreadPool &pool);
+
+		// Bytes of observation per game for the given level set
+		static size_t observationSize(const LevelSet &l);
+
+		size_t observationSize() const
+		{
+			return m_plane_size * 2;
+		};
+
+		size_t size() const
+		{
+			return m_envs.size();
+		};
+
+		// Restart the given games.  If levels is not NULL, it gives the
+		// level to start each one on; otherwise they restart the level
+		// they were on.
+		void reset(const uint32_t *ids, size_t count,
+			const uint32_t *levels = NULL);
+
+		// Take one step in every game.  Actions are Direction values,
+		// or -1 to stand still.  Rewards are the change in the number
+		// of objects on crosses; done is set once a level is solved,
+		// after which a game ignores its actions until reset.
+		void step(const int8_t *actions, int8_t *rewards, uint8_t *done);
+
+		uint32_t level(size_t id) const
+		{
+			return m_envs[id].level;
+		};
+
+		const Board::State &state(size_t id) const
+		{
+			return m_envs[id].state;
+		};
+
+	private:
+		struct Env
+		{
+			Board::State state;
+			uint32_t level;
+			uint8_t on_cross;
+			uint8_t done;
+		};
+
+		void resetOne(size_t id, uint32_t level);
+		void stepOne(size_t id, int8_t action, int8_t &reward,
+			uint8_t &done);
+
+		std::vector<Board> m_boards;
+		std::vector<Env> m_envs;
+		uint8_t *m_observations;
+		size_t m_plane_size;
+		ThreadPool &m_pool;
+};
+
+#endif
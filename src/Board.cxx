@@ -0,0 +1,244 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <algorithm>
+#include <cstring>
+
+// System
+
+// Library
+
+// Local
+#include "Board.hxx"
+#include "LevelSet.hxx"
+
+//
+// Implementation
+//
+
+bool Board::State::operator==(const State &o) const
+{
+	return (memcmp(this, &o, sizeof(State)) == 0);
+}
+
+size_t Board::StateHash::operator()(const State &s) const
+{
+	// FNV-1a over the raw bytes of the state
+	const unsigned char *p = (const unsigned char*)(&s);
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < sizeof(State); ++i)
+	{
+		h ^= p[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+Board::Board(const Level &l, uint8_t first_floor_tile,
+	uint8_t first_cross_tile)
+	: m_width(l.width), m_height(l.height),
+	  m_flags(l.width * l.height), m_neighbours(l.width * l.height * 4),
+	  m_num_boxes(0), m_num_balls(0)
+{
+	// Floor and cross tiles can be moved into
+	for (int i = 0; i < numSquares(); ++i)
+	{
+		// Look up neighbouring squares ahead of time, as searches
+		// ask for them a great deal
+		int x = i % m_width;
+		int y = i / m_width;
+		int32_t *n = &(m_neighbours[i * 4]);
+		n[Up] = (y > 0) ? i - m_width : -1;
+		n[Down] = (y < m_height - 1) ? i + m_width : -1;
+		n[Left] = (x > 0) ? i - 1 : -1;
+		n[Right] = (x < m_width - 1) ? i + 1 : -1;
+
+		m_flags[i] = 0;
+		if (l.tilemap[i] >= first_floor_tile)
+		{
+			m_flags[i] |= FloorFlag;
+			if (l.tilemap[i] < first_cross_tile)
+				m_flags[i] |= CrossFlag;
+		}
+	}
+
+	// Mark corners as dead squares.  Whatever is pushed into one can
+	// never be pushed out again, because the player would have to
+	// stand inside one of the two walls to do it.
+	for (int i = 0; i < numSquares(); ++i)
+	{
+		if (!isFloor(i) || isCross(i))
+			continue;
+
+		int u = neighbour(i, Up);
+		int d = neighbour(i, Down);
+		int le = neighbour(i, Left);
+		int r = neighbour(i, Right);
+		bool vert = (u < 0 || !isFloor(u)) || (d < 0 || !isFloor(d));
+		bool horz = (le < 0 || !isFloor(le)) || (r < 0 || !isFloor(r));
+		if (vert && horz)
+			m_flags[i] |= DeadFlag;
+	}
+
+	// Build the initial state from the level's sprite info
+	uint8_t kinds[P2_MAX_SPRITES_PER_LEVEL];
+	uint16_t squares[P2_MAX_SPRITES_PER_LEVEL];
+	for (uint8_t i = 0; i < l.num_sprites; ++i)
+	{
+		kinds[i] = l.spriteinfo[i].index;
+		squares[i] = (l.spriteinfo[i].y * m_width) + l.spriteinfo[i].x;
+		if (kinds[i] == BoxPiece)
+			++m_num_boxes;
+		else if (kinds[i] == BallPiece)
+			++m_num_balls;
+	}
+	m_initial = makeState(l.num_sprites, kinds, squares);
+}
+
+void Board::occupancy(const State &s, uint8_t *grid) const
+{
+	memset(grid, NoPiece, numSquares());
+	for (int i = 0; i < numObjects(); ++i)
+		grid[s.objects[i]] = pieceAt(i);
+}
+
+int Board::pushDestination(const uint8_t *grid, int square, Piece p,
+	Direction d) const
+{
+	// As PushableObject::canMove - the next square must be free
+	int next = neighbour(square, d);
+	if (next < 0 || !isFloor(next) || grid[next] != NoPiece)
+		return -1;
+
+	if (p == BoxPiece)
+		return next;
+
+	// Balls roll until they hit a wall or another object
+	int dest = next;
+	for (;;)
+	{
+		next = neighbour(dest, d);
+		if (next < 0 || !isFloor(next) || grid[next] != NoPiece)
+			break;
+		dest = next;
+	}
+	return dest;
+}
+
+Board::MoveResult Board::move(State &s, Direction d) const
+{
+	int dest = neighbour(s.player, d);
+	if (dest < 0 || !isFloor(dest))
+		return Blocked;
+
+	// Is there a pushable object there?  Levels can be large, so
+	// check the few other objects directly rather than building an
+	// occupancy grid as pushDestination wants.
+	for (int i = 0; i < numObjects(); ++i)
+	{
+		if (s.objects[i] != dest)
+			continue;
+
+		int next = neighbour(dest, d);
+		if (next < 0 || !isFloor(next) || occupied(s, next))
+			return Blocked;
+
+		// Balls roll until they hit a wall or another object
+		int to = next;
+		if (pieceAt(i) == BallPiece)
+		{
+			for (;;)
+			{
+				next = neighbour(to, d);
+				if (next < 0 || !isFloor(next) || occupied(s, next))
+					break;
+				to = next;
+			}
+		}
+
+		s.objects[i] = to;
+		s.player = dest;
+		return Pushed;
+	}
+
+	s.player = dest;
+	return Walked;
+}
+
+bool Board::occupied(const State &s, int square) const
+{
+	for (int i = 0; i < numObjects(); ++i)
+	{
+		if (s.objects[i] == square)
+			return true;
+	}
+	return false;
+}
+
+bool Board::solved(const State &s) const
+{
+	for (int i = 0; i < numObjects(); ++i)
+	{
+		if (!isCross(s.objects[i]))
+			return false;
+	}
+	return true;
+}
+
+void Board::normalise(State &s) const
+{
+	std::sort(s.objects, s.objects + m_num_boxes);
+	std::sort(s.objects + m_num_boxes, s.objects + numObjects());
+}
+
+Board::State Board::makeState(int count, const uint8_t *kinds,
+	const uint16_t *squares) const
+{
+	State s;
+	memset(&s, 0, sizeof(s));
+
+	int box = 0;
+	int ball = m_num_boxes;
+	for (int i = 0; i < count; ++i)
+	{
+		switch (kinds[i])
+		{
+			case NoPiece:
+				// Sprite index 0 is the player
+				s.player = squares[i];
+				break;
+			case BoxPiece:
+				s.objects[box++] = squares[i];
+				break;
+			case BallPiece:
+				s.objects[ball++] = squares[i];
+		}
+	}
+
+	normalise(s);
+	return s;
+}
@@ -0,0 +1,188 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HXX_BOARD
+#define HXX_BOARD
+
+#include <cstdint>
+#include <vector>
+
+#include "Constants.hxx"
+
+struct Level;
+
+enum Direction
+{
+	Left,
+	Right,
+	Up,
+	Down
+};
+
+// Logical model of the rules of a single level, with no animation and
+// no dependency on SDL.  Pushes complete instantly, but otherwise this
+// mirrors the behaviour of Player, Box and Ball in GameObjects.cxx.
+// Used wherever moves need to be explored or checked quickly, such as
+// by the hint search.
+class Board
+{
+	public:
+		// Types of object which can occupy a square.
+		// Values match SpriteInfo::index in the level files.
+		enum Piece
+		{
+			NoPiece = 0,
+			BoxPiece = 1,
+			BallPiece = 2
+		};
+
+		// Outcome of a single player step
+		enum MoveResult
+		{
+			Blocked,
+			Walked,
+			Pushed
+		};
+
+		// Dynamic state of a level: the player's square, followed by
+		// the squares of all boxes, then all balls.  Squares are indexes
+		// into the level's tile map (y * width + x).  Unused entries are kept zeroed so
+		// that states can be compared and hashed as plain memory.
+		struct State
+		{
+			uint16_t player;
+			uint16_t objects[P2_MAX_SPRITES_PER_LEVEL - 1];
+
+			bool operator==(const State &o) const;
+			bool operator!=(const State &o) const
+			{
+				return !(*this == o);
+			};
+		};
+
+		struct StateHash
+		{
+			size_t operator()(const State &s) const;
+		};
+
+		Board(const Level &l, uint8_t first_floor_tile,
+			uint8_t first_cross_tile);
+
+		const State &initialState() const
+		{
+			return m_initial;
+		};
+
+		int width() const
+		{
+			return m_width;
+		};
+
+		int height() const
+		{
+			return m_height;
+		};
+
+		int numSquares() const
+		{
+			return m_width * m_height;
+		};
+
+		int numObjects() const
+		{
+			return m_num_boxes + m_num_balls;
+		};
+
+		int numBoxes() const
+		{
+			return m_num_boxes;
+		};
+
+		Piece pieceAt(int object) const
+		{
+			return (object < m_num_boxes) ? BoxPiece : BallPiece;
+		};
+
+		bool isFloor(int square) const
+		{
+			return (m_flags[square] & FloorFlag);
+		};
+
+		bool isCross(int square) const
+		{
+			return (m_flags[square] & CrossFlag);
+		};
+
+		// True for floor squares which are not crosses, but from which
+		// an object can never be pushed (corners)
+		bool isDead(int square) const
+		{
+			return (m_flags[square] & DeadFlag);
+		};
+
+		// Index of the square next to the given one, or -1 if that
+		// would be off the edge of the level
+		int neighbour(int square, Direction d) const
+		{
+			return m_neighbours[(square * 4) + d];
+		};
+
+		// Build an occupancy grid (one Piece per square) for the given
+		// state.  Grid must hold numSquares() bytes.
+		void occupancy(const State &s, uint8_t *grid) const;
+
+		// Square at which an object of the given type comes to rest when
+		// pushed from the given square, or -1 if it cannot move at all
+		int pushDestination(const uint8_t *grid, int square, Piece p,
+			Direction d) const;
+
+		// Take one step as Player::move would, updating the state
+		MoveResult move(State &s, Direction d) const;
+
+		// Have all objects been pushed onto crosses?
+		bool solved(const State &s) const;
+
+		// Sort boxes and balls by square, so that states which differ
+		// only by the order of identical objects compare equal
+		void normalise(State &s) const;
+
+		// Build a state from live object positions.  Kinds and squares
+		// are given in matching order, using SpriteInfo index values.
+		State makeState(int count, const uint8_t *kinds,
+			const uint16_t *squares) const;
+
+	private:
+		enum
+		{
+			FloorFlag = 1,
+			CrossFlag = 2,
+			DeadFlag = 4
+		};
+
+		// Whether any box or ball is on the given square
+		bool occupied(const State &s, int square) const;
+
+		int m_width;
+		int m_height;
+		std::vector<uint8_t> m_flags;
+		std::vector<int32_t> m_neighbours;
+		State m_initial;
+		int m_num_boxes;
+		int m_num_balls;
+};
+
+#endif
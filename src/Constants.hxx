@@ -19,9 +19,37 @@
 #define HXX_CONSTANTS
 
 #define P2_MAX_SPRITES_PER_LEVEL 20
-#define P2_LEVEL_WIDTH 20
-#define P2_LEVEL_HEIGHT 12
 #define P2_TILE_WIDTH 32
 #define P2_TILE_HEIGHT 32
 
+// Size of the original levels, and of the screen, in tiles.
+// Levels may be any size up to the maximum; those bigger than
+// the screen scroll to follow the player.
+#define P2_LEVEL_WIDTH 20
+#define P2_LEVEL_HEIGHT 12
+#define P2_MAX_LEVEL_WIDTH 256
+#define P2_MAX_LEVEL_HEIGHT 256
+
+// Flags for each square of a padded level - see Level::cells
+#define P2_CELL_FLOOR 1
+#define P2_CELL_CROSS 2
+
+// Kinds of data which can be reloaded while the game runs, when their
+// files are edited - see AssetWatcher and GameLoop::reload.  Sprites
+// covers the player's sprites too.
+#define P2_ASSET_TILES 1
+#define P2_ASSET_SPRITES 2
+#define P2_ASSET_GLYPHS 4
+#define P2_ASSET_LEVELS 8
+
+// Game objects are simulated in fixed ticks, at this many per second,
+// and positioned in fixed-point pixels with this many fractional bits
+#ifndef P2_TICK_RATE
+#	define P2_TICK_RATE 120
+#endif
+#if P2_TICK_RATE < 2 || P2_TICK_RATE > 256
+#	error P2_TICK_RATE must be from 2 to 256
+#endif
+#define P2_SUBPIXEL_SHIFT 16
+
 #endif
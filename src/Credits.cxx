@@ -33,6 +33,7 @@
 
 // Local
 #include "Credits.hxx"
+#include "Display.hxx"
 #include "MainMenu.hxx"
 
 
@@ -41,11 +42,27 @@
 //
 
 Credits::Credits(const Alphabet &a, const LevelSet &l)
-	: GameLoop(a, l), m_background_surf(NULL), m_old_kbdstate(NULL)
+	: GameLoop(a, l), m_background_surf(NULL), m_drawn(false),
+	  m_changed(true), m_old_kbdstate(NULL)
 {
+	renderBackground();
+
+	// Store current keyboard state, and size of keyboard state array.
+	// This is so that later we can process keypresses separate from
+	// keys which were already held down when entering the menu.
+	const Uint8 *kbdstate = SDL_GetKeyState(&m_kbdstate_size);
+	m_old_kbdstate = new Uint8[m_kbdstate_size];
+	memcpy(m_old_kbdstate, kbdstate, m_kbdstate_size);
+}
+
+void Credits::renderBackground()
+{
+	if (m_background_surf)
+		SDL_FreeSurface(m_background_surf);
+
 	// Render main menu background
 	const uint8_t *tilemap = m_levelset.getTitleScreen();
-	m_background_surf = SDL_DisplayFormat(SDL_GetVideoSurface());
+	m_background_surf = Display::createFrameSurface();
 	for (int y = 0; y < P2_LEVEL_HEIGHT; ++y)
 	{
 		for (int x = 0; x < P2_LEVEL_WIDTH; ++x)
@@ -61,14 +78,14 @@ Credits::Credits(const Alphabet &a, const LevelSet &l)
 	}
 
 	// Render credits text
-	SDL_Surface *title = a.renderWord("Pushy II", 192, 192, 192);
-	SDL_Surface *from_fish = a.renderWord("from FISH", 0, 255, 255);
-	SDL_Surface *net = a.renderWord("net", 0, 255, 255);
-	SDL_Surface *graphics = a.renderWord("Graphics", 192, 128, 0);
-	SDL_Surface *and_levels = a.renderWord("and Levels by:", 128, 0, 192);
-	SDL_Surface *rfredw = a.renderWord("R-Fred-W", 192, 192, 0);
-	SDL_Surface *code_by = a.renderWord("Code by:", 192, 128, 0);
-	SDL_Surface *phil = a.renderWord("Philip Allison", 192, 192, 0);
+	SDL_Surface *title = m_alphabet.renderWord("Pushy II", 192, 192, 192);
+	SDL_Surface *from_fish = m_alphabet.renderWord("from FISH", 0, 255, 255);
+	SDL_Surface *net = m_alphabet.renderWord("net", 0, 255, 255);
+	SDL_Surface *graphics = m_alphabet.renderWord("Graphics", 192, 128, 0);
+	SDL_Surface *and_levels = m_alphabet.renderWord("and Levels by:", 128, 0, 192);
+	SDL_Surface *rfredw = m_alphabet.renderWord("R-Fred-W", 192, 192, 0);
+	SDL_Surface *code_by = m_alphabet.renderWord("Code by:", 192, 128, 0);
+	SDL_Surface *phil = m_alphabet.renderWord("Philip Allison", 192, 192, 0);
 		
 	SDL_Rect rect;
 	rect.x = (Sint16)(320 - (title->w / 2));
@@ -109,13 +126,6 @@ Credits::Credits(const Alphabet &a, const LevelSet &l)
 	SDL_FreeSurface(rfredw);
 	SDL_FreeSurface(code_by);
 	SDL_FreeSurface(phil);
-
-	// Store current keyboard state, and size of keyboard state array.
-	// This is so that later we can process keypresses separate from
-	// keys which were already held down when entering the menu.
-	const Uint8 *kbdstate = SDL_GetKeyState(&m_kbdstate_size);
-	m_old_kbdstate = new Uint8[m_kbdstate_size];
-	memcpy(m_old_kbdstate, kbdstate, m_kbdstate_size);
 }
 
 Credits::~Credits()
@@ -124,9 +134,11 @@ Credits::~Credits()
 	delete[] m_old_kbdstate;
 }
 
-bool Credits::update(float elapsed, const Uint8 *kbdstate, SDL_Surface *screen)
+bool Credits::update(float elapsed, const Uint8 *kbdstate, RenderQueue &queue)
 {
-	SDL_BlitSurface(m_background_surf, NULL, screen, NULL);
+	m_changed = !m_drawn;
+	m_drawn = true;
+	queue.blit(RenderQueue::Background, m_background_surf, NULL, 0, 0);
 
 	if ((kbdstate[SDLK_ESCAPE]
 		 || kbdstate[SDLK_SPACE]
@@ -144,6 +156,16 @@ bool Credits::update(float elapsed, const Uint8 *kbdstate, SDL_Surface *screen)
 	return true;
 }
 
+std::shared_ptr<GameLoop> Credits::reload(unsigned assets)
+{
+	if (assets & (P2_ASSET_TILES | P2_ASSET_GLYPHS | P2_ASSET_LEVELS))
+	{
+		renderBackground();
+		m_drawn = false;
+	}
+	return shared_from_this();
+}
+
 std::unique_ptr<GameLoopFactory> Credits::nextLoop()
 {
 	GameLoopFactory *f = new MainMenuFactory();
@@ -28,12 +28,25 @@ class Credits: public GameLoop
 		~Credits();
 
 		bool update(float elapsed, const Uint8 *kbdstate,
-			SDL_Surface *screen);
+			RenderQueue &queue);
 
 		std::unique_ptr<GameLoopFactory> nextLoop();
 
+		// Nothing moves after the first frame
+		Uint32 idle() const
+		{
+			return (m_changed ? 0 : P2_IDLE_FOREVER);
+		};
+
+		std::shared_ptr<GameLoop> reload(unsigned assets);
+
 	private:
+		// Draw the title screen and text onto m_background_surf
+		void renderBackground();
+
 		SDL_Surface *m_background_surf;
+		bool m_drawn;
+		bool m_changed;
 
 		int m_kbdstate_size;
 		Uint8 *m_old_kbdstate;
@@ -0,0 +1,101 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+
+// System
+
+// Library
+
+// Local
+#include "Display.hxx"
+
+//
+// Implementation
+//
+
+SDL_Surface *Display::m_screen = NULL;
+SDL_Surface *Display::m_frame = NULL;
+std::unique_ptr<Scaler> Display::m_scaler;
+
+void Display::freeFrame()
+{
+	if (m_frame && m_frame != m_screen)
+		SDL_FreeSurface(m_frame);
+	m_frame = NULL;
+	m_scaler.reset();
+}
+
+SDL_Surface *Display::setVideoMode(LevelSet &l, int width, int height,
+	int bpp, Uint32 flags, int scale, Scaler::Filter filter, ThreadPool *pool)
+{
+	freeFrame();
+
+	m_screen = SDL_SetVideoMode(width * scale, height * scale, bpp, flags);
+	if (!m_screen)
+		return NULL;
+	l.convertToDisplayFormat();
+
+	if (scale == 1)
+		m_frame = m_screen;
+	else
+	{
+		const SDL_PixelFormat *f = m_screen->format;
+		m_frame = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height,
+			f->BitsPerPixel, f->Rmask, f->Gmask, f->Bmask, f->Amask);
+		if (!m_frame)
+			return NULL;
+		m_scaler.reset(new Scaler(scale, filter, pool));
+	}
+	return m_frame;
+}
+
+SDL_Surface *Display::setHeadless(int width, int height)
+{
+	freeFrame();
+	m_screen = NULL;
+	m_frame = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, 32,
+		0x00ff0000, 0x0000ff00, 0x000000ff, 0);
+	return m_frame;
+}
+
+SDL_Surface *Display::createFrameSurface()
+{
+	// Only the frame's format is looked at, never its pixels, as
+	// the render thread may be drawing to it
+	const SDL_PixelFormat *f = m_frame->format;
+	return SDL_CreateRGBSurface(SDL_SWSURFACE, m_frame->w, m_frame->h,
+		f->BitsPerPixel, f->Rmask, f->Gmask, f->Bmask, f->Amask);
+}
+
+void Display::present()
+{
+	if (!m_screen)
+		return;
+	if (m_scaler)
+		m_scaler->scale(m_frame, m_screen);
+	SDL_Flip(m_screen);
+}
@@ -0,0 +1,82 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HXX_DISPLAY
+#define HXX_DISPLAY
+
+#include <memory>
+
+#include <SDL.h>
+
+#include "LevelSet.hxx"
+#include "Scaler.hxx"
+
+// Keeps long-lived surfaces in the exact pixel format of the screen, so
+// that blitting them each frame never has to convert pixels on the way.
+// Tiles and sprites are loaded in a fixed format before there is a screen,
+// so they are converted whenever the video mode is set.  Everything else
+// (rendered words, pre-rendered backgrounds) is created in the display
+// format to begin with.
+//
+// Frames are always drawn at the game's native size.  When running
+// scaled up, they are drawn off screen and enlarged by present().
+class Display
+{
+	public:
+		// Use in place of SDL_SetVideoMode.  Width and height are the
+		// native frame size; the window is scale times bigger.  Returns
+		// the surface to draw frames on, or NULL on failure.  Frames
+		// are scaled up on the given pool's threads, if there is one.
+		static SDL_Surface *setVideoMode(LevelSet &l, int width, int height,
+			int bpp, Uint32 flags, int scale = 1,
+			Scaler::Filter filter = Scaler::Nearest, ThreadPool *pool = NULL);
+
+		// Surface to draw frames on, as returned by setVideoMode.
+		// Use this rather than SDL_GetVideoSurface() for its size.
+		static SDL_Surface *frame()
+		{
+			return m_frame;
+		};
+
+		// The real screen, or NULL if headless
+		static SDL_Surface *screen()
+		{
+			return m_screen;
+		};
+
+		// Draw frames with no screen at all, for rendering without a
+		// display.  The frame is in the same format as MemoryBackend,
+		// and present() does nothing.
+		static SDL_Surface *setHeadless(int width, int height);
+
+		// New surface the size and pixel format of the frame, for
+		// pre-rendering backgrounds.  Free with SDL_FreeSurface.
+		// Safe to call while frames are drawn on another thread.
+		static SDL_Surface *createFrameSurface();
+
+		// Put the frame on the screen, scaling it up if need be
+		static void present();
+
+	private:
+		static void freeFrame();
+
+		static SDL_Surface *m_screen;
+		static SDL_Surface *m_frame;
+		static std::unique_ptr<Scaler> m_scaler;
+};
+
+#endif
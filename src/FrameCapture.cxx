@@ -0,0 +1,319 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+// System
+
+// Library
+
+// Local
+#include "FrameCapture.hxx"
+#include "Pixels.hxx"
+
+//
+// Implementation
+//
+
+// Frames are presented at the display's refresh rate, which is usually
+// this, so YUV4MPEG2 output claims it rather than leaving it out
+#define CAPTURE_Y4M_FPS 60
+
+// Widest frame number a file name may ask for
+#define CAPTURE_MAX_NAME_WIDTH 32
+
+namespace
+{
+	bool endsWith(const std::string &s, const char *suffix)
+	{
+		size_t n = strlen(suffix);
+		return (s.size() >= n && s.compare(s.size() - n, n, suffix) == 0);
+	}
+
+	// Widen a colour component of 8 - loss bits to 8 bits
+	inline uint8_t component(uint32_t v, uint32_t mask, uint8_t shift,
+		uint8_t loss)
+	{
+		uint32_t c = ((v & mask) >> shift) << loss;
+		return (uint8_t)(c | (c >> (8 - loss)));
+	}
+}
+
+FrameCapture::FrameCapture(const std::string &filename,
+	const SDL_Surface *frame, int buffers)
+	: m_filename(filename), m_format(PpmStream),
+	  m_name_width(0), m_name_pad(' '),
+	  m_width(frame->w), m_height(frame->h),
+	  m_bpp(frame->format->BytesPerPixel), m_pixel_format(*(frame->format)),
+	  m_buffers(buffers), m_next_write(0), m_count(0),
+	  m_rgb(frame->w * frame->h * 3), m_captured(0), m_written(0),
+	  m_dropped(0), m_quit(false)
+{
+	if (endsWith(filename, ".y4m"))
+		m_format = Y4m;
+	else if (filename.find('%') != std::string::npos)
+		m_format = PpmFiles;
+
+	if (m_format == PpmFiles)
+	{
+		// Split the name around its number, rather than handing it to
+		// printf as a format, so nothing in it can be misread
+		bool number = false;
+		std::string *part = &m_name_prefix;
+		for (size_t i = 0; i < filename.size(); ++i)
+		{
+			if (filename[i] != '%')
+			{
+				part->push_back(filename[i]);
+				continue;
+			}
+			if (++i < filename.size() && filename[i] == '%')
+			{
+				part->push_back('%');
+				continue;
+			}
+			if (number)
+				throw std::runtime_error("name holds more than one number");
+			number = true;
+			part = &m_name_suffix;
+			if (i < filename.size() && filename[i] == '0')
+			{
+				m_name_pad = '0';
+				++i;
+			}
+			for (; i < filename.size() && isdigit(filename[i]); ++i)
+			{
+				m_name_width = (m_name_width * 10) + (filename[i] - '0');
+				if (m_name_width > CAPTURE_MAX_NAME_WIDTH)
+					throw std::runtime_error("number in name is too wide");
+			}
+			if (i == filename.size() || filename[i] != 'd')
+				throw std::runtime_error("name holds something other than %d");
+		}
+		if (!number)
+			throw std::runtime_error("name holds no %d");
+	}
+	else
+	{
+		m_out.open(filename.c_str(), std::ios_base::binary);
+		if (!m_out.is_open())
+			throw std::runtime_error("cannot open file");
+	}
+	if (m_format == Y4m)
+	{
+		m_planes.resize(m_width * m_height * 3);
+		m_out << "YUV4MPEG2 W" << m_width << " H" << m_height
+			<< " F" << CAPTURE_Y4M_FPS << ":1 Ip A1:1 C444\n";
+		if (!m_out)
+			throw std::runtime_error("cannot write to file");
+	}
+
+	for (auto i = m_buffers.begin(); i != m_buffers.end(); ++i)
+		i->resize(m_width * m_height * m_bpp);
+
+	m_thread = std::thread(&FrameCapture::run, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+	finish();
+}
+
+bool FrameCapture::finish()
+{
+	if (m_thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+		}
+		m_wake.notify_one();
+		m_thread.join();
+
+		// Buffered output only shows a failure when it's flushed
+		if (m_out.is_open())
+		{
+			m_out.close();
+			if (m_out.fail() && m_error.empty())
+				m_error = "cannot write to \"" + m_filename + '"';
+		}
+	}
+	return m_error.empty();
+}
+
+void FrameCapture::add(SDL_Surface *frame)
+{
+	// Claim the buffer after those already waiting.  The writer never
+	// looks at it until it is counted, so it can be filled unlocked.
+	int slot;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_count == (int)m_buffers.size() || !m_error.empty())
+		{
+			++m_dropped;
+			return;
+		}
+		slot = (m_next_write + m_count) % m_buffers.size();
+	}
+
+	if (SDL_MUSTLOCK(frame) && SDL_LockSurface(frame) < 0)
+		return;
+	uint8_t *dest = &(m_buffers[slot][0]);
+	int row_bytes = m_width * m_bpp;
+	for (int y = 0; y < m_height; ++y)
+	{
+		memcpy(dest + (y * row_bytes),
+			(const uint8_t*)(frame->pixels) + (y * frame->pitch), row_bytes);
+	}
+	if (SDL_MUSTLOCK(frame))
+		SDL_UnlockSurface(frame);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_count;
+		++m_captured;
+	}
+	m_wake.notify_one();
+}
+
+uint32_t FrameCapture::captured() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_captured;
+}
+
+uint32_t FrameCapture::dropped() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_dropped;
+}
+
+std::string FrameCapture::error() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_error;
+}
+
+void FrameCapture::run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		// Write out everything captured before quitting
+		m_wake.wait(lock, [this] { return m_quit || m_count; });
+		if (!m_count)
+			break;
+		const uint8_t *pixels = &(m_buffers[m_next_write][0]);
+		bool failed = !m_error.empty();
+		lock.unlock();
+
+		// After a failure, drain what's waiting without trying again
+		bool ok = false;
+		if (!failed)
+		{
+			toRgb(pixels);
+			ok = write();
+		}
+
+		lock.lock();
+		m_next_write = (m_next_write + 1) % m_buffers.size();
+		--m_count;
+		if (ok)
+			++m_written;
+		else if (!failed)
+		{
+			m_error = "cannot write to \""
+				+ (m_format == PpmFiles ? frameName(m_written) : m_filename)
+				+ '"';
+		}
+	}
+}
+
+void FrameCapture::toRgb(const uint8_t *pixels)
+{
+	const SDL_PixelFormat &f = m_pixel_format;
+	uint8_t *rgb = &(m_rgb[0]);
+	int n = m_width * m_height;
+	for (int i = 0; i < n; ++i)
+	{
+		uint32_t v = loadPixel(pixels + (i * m_bpp), m_bpp);
+		*rgb++ = component(v, f.Rmask, f.Rshift, f.Rloss);
+		*rgb++ = component(v, f.Gmask, f.Gshift, f.Gloss);
+		*rgb++ = component(v, f.Bmask, f.Bshift, f.Bloss);
+	}
+}
+
+std::string FrameCapture::frameName(uint32_t n) const
+{
+	std::string number = std::to_string(n);
+	if (number.size() < m_name_width)
+		number.insert(0, m_name_width - number.size(), m_name_pad);
+	return m_name_prefix + number + m_name_suffix;
+}
+
+bool FrameCapture::write()
+{
+	int n = m_width * m_height;
+	switch (m_format)
+	{
+		case Y4m:
+		{
+			// Full resolution Y'CbCr, in studio range as per BT.601
+			const uint8_t *rgb = &(m_rgb[0]);
+			uint8_t *y = &(m_planes[0]);
+			uint8_t *cb = y + n;
+			uint8_t *cr = cb + n;
+			for (int i = 0; i < n; ++i, rgb += 3)
+			{
+				int r = rgb[0], g = rgb[1], b = rgb[2];
+				y[i] = 16 + (((66 * r) + (129 * g) + (25 * b) + 128) >> 8);
+				cb[i] = 128 + (((-38 * r) - (74 * g) + (112 * b) + 128) >> 8);
+				cr[i] = 128 + (((112 * r) - (94 * g) - (18 * b) + 128) >> 8);
+			}
+			m_out << "FRAME\n";
+			m_out.write((const char*)&(m_planes[0]), m_planes.size());
+			return !m_out.fail();
+		}
+		case PpmStream:
+			m_out << "P6\n" << m_width << ' ' << m_height << "\n255\n";
+			m_out.write((const char*)&(m_rgb[0]), m_rgb.size());
+			return !m_out.fail();
+		case PpmFiles:
+		{
+			std::ofstream out(frameName(m_written).c_str(),
+				std::ios_base::binary);
+			out << "P6\n" << m_width << ' ' << m_height << "\n255\n";
+			out.write((const char*)&(m_rgb[0]), m_rgb.size());
+			out.close();
+			return !out.fail();
+		}
+	}
+	return false;
+}
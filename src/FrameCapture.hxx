@@ -0,0 +1,128 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HXX_FRAMECAPTURE
+#define HXX_FRAMECAPTURE
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+#include <SDL.h>
+
+// Frames which may be waiting to be written before more are dropped
+#define P2_CAPTURE_FRAMES 8
+
+// Records the frames drawn to a surface, for reviewing later.
+//
+// add() copies the frame's pixels, as they are, into one of a fixed set
+// of buffers allocated up front; a writer thread of its own converts
+// them to RGB and writes them out.  If the writer falls behind and all
+// the buffers are full, frames are dropped and counted, so capturing
+// never holds up drawing for longer than the copy takes.
+//
+// The file name decides the format: ".y4m" for YUV4MPEG2 video,
+// otherwise binary PPM - a separate file per frame if the name holds a
+// printf-style number (e.g. "frame%05d.ppm"), else all in one stream.
+// Such a name may hold one %d, with an optional 0 flag and width, and
+// %% for a literal percent sign; nothing else.
+class FrameCapture
+{
+	public:
+		// Throws std::runtime_error if the output can't be opened, or
+		// if the file name holds anything but a single number
+		FrameCapture(const std::string &filename, const SDL_Surface *frame,
+			int buffers = P2_CAPTURE_FRAMES);
+
+		// Writes out any frames still waiting
+		~FrameCapture();
+
+		// Write out any frames still waiting and stop capturing.
+		// Returns false if anything could not be written; see error().
+		bool finish();
+
+		// Capture the current contents of the frame given to the
+		// constructor.  Call from whichever thread draws it, after
+		// drawing and before it changes again.
+		void add(SDL_Surface *frame);
+
+		// Frames captured so far, including any not yet written,
+		// and frames dropped because the writer was behind
+		uint32_t captured() const;
+		uint32_t dropped() const;
+
+		// Why writing failed, or empty if it hasn't.  Once a write
+		// fails, frames still waiting are discarded and later ones
+		// are dropped.
+		std::string error() const;
+
+	private:
+		enum Format
+		{
+			Y4m,
+			PpmStream,
+			PpmFiles
+		};
+
+		void run();
+		void toRgb(const uint8_t *pixels);
+		bool write();
+		std::string frameName(uint32_t n) const;
+
+		std::string m_filename;
+		Format m_format;
+		std::ofstream m_out;
+
+		// For PpmFiles, the parts of m_filename either side of its %d,
+		// with %% already unescaped, and the width and padding to give
+		// the frame number
+		std::string m_name_prefix;
+		std::string m_name_suffix;
+		size_t m_name_width;
+		char m_name_pad;
+
+		int m_width;
+		int m_height;
+		int m_bpp;
+		SDL_PixelFormat m_pixel_format;
+
+		// Raw frames, used strictly in turn: m_count of them, starting
+		// at m_next_write, are waiting to be written.  The writer's
+		// RGB and Y'CbCr conversions go in m_rgb and m_planes.
+		std::vector<std::vector<uint8_t>> m_buffers;
+		int m_next_write;
+		int m_count;
+		std::vector<uint8_t> m_rgb;
+		std::vector<uint8_t> m_planes;
+
+		uint32_t m_captured;
+		uint32_t m_written;
+		uint32_t m_dropped;
+		std::string m_error;
+		bool m_quit;
+
+		std::thread m_thread;
+		mutable std::mutex m_mutex;
+		std::condition_variable m_wake;
+};
+
+#endif
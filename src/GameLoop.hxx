@@ -20,9 +20,14 @@
 
 #include "Alphabet.hxx"
 #include "LevelSet.hxx"
+#include "RenderQueue.hxx"
 
 class GameLoop;
 
+// GameLoop::idle() value for a frame which won't change until a key is
+// pressed or released
+#define P2_IDLE_FOREVER 0xFFFFFFFF
+
 // Base struct for GameLoop-derived class factories
 struct GameLoopFactory
 {
@@ -41,13 +46,13 @@ class GameLoop: public std::enable_shared_from_this<GameLoop>
 
 		virtual ~GameLoop();
 
-		// Update game state and render current frame.
+		// Update game state and queue up the current frame.
 		// Return false to indicate that a new loop
 		// should be swapped in.  If the state of the
 		// current loop is to be preserved, have the new loop
 		// take a shared_ptr to the current one as an argument.
 		virtual bool update(float elapsed, const Uint8 *kbdstate,
-			SDL_Surface *screen) = 0;
+			RenderQueue &queue) = 0;
 
 		// Return a shared_ptr to the next game loop factory.
 		// This will be called after update() has returned false.
@@ -56,6 +61,27 @@ class GameLoop: public std::enable_shared_from_this<GameLoop>
 		// calling operator() on the factory for the next loop.
 		virtual std::unique_ptr<GameLoopFactory> nextLoop() = 0;
 
+		// After update(), 0 if the frame it queued differs from the
+		// one before, or might differ next time; otherwise, how many
+		// milliseconds it will stay the same for if no key is pressed
+		// or released, or P2_IDLE_FOREVER.  The main loop then skips
+		// drawing the frame, and sleeps until something happens.
+		// Loops which animate continuously can leave this as it is.
+		virtual Uint32 idle() const
+		{
+			return 0;
+		};
+
+		// Called between frames when the game's data has been reloaded
+		// in place (P2_ASSET_* flags), so that anything made from it can
+		// be made again.  Return the loop to carry on with: this one, or
+		// a fresh one if this one can't be patched up.  Loops which
+		// draw everything afresh each frame can leave this as it is.
+		virtual std::shared_ptr<GameLoop> reload(unsigned assets)
+		{
+			return shared_from_this();
+		};
+
 	protected:
 		const Alphabet &m_alphabet;
 		const LevelSet &m_levelset;
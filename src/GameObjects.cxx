@@ -25,7 +25,7 @@
 #endif
 
 // Language
-#include <cmath>
+#include <cstring>
 
 // System
 
@@ -39,156 +39,311 @@
 // Implementation
 //
 
-#define PLAYER_SPEED 120.0f
-#define PUSH_SPEED 50.0f
-#define ROLL_SPEED 180.0f
-#define ROLL_ACCEL 80.0f
+// Speeds are given in pixels per second, converted to
+// fixed-point pixels per tick; acceleration in pixels per second
+// per second, converted to fixed-point pixels per tick per tick
+#define PER_TICK(x) (((x) << P2_SUBPIXEL_SHIFT) / P2_TICK_RATE)
+#define PLAYER_SPEED PER_TICK(120)
+#define PUSH_SPEED PER_TICK(50)
+#define ROLL_SPEED PER_TICK(180)
+#define ROLL_ACCEL (PER_TICK(80) / P2_TICK_RATE)
+#define ANIM_FPS 15
+
+GameObject::GameObject(const TileSet *sprites, const Level &level,
+	uint8_t x, uint8_t y, GameObject **objects, int &objects_left)
+	: m_sprites(sprites), m_x(x), m_y(y), m_square(level.paddedIndex(x, y)),
+	  m_start_square(m_square), m_objects(objects),
+	  m_objects_left(objects_left), m_level(level), m_cells(&(level.cells[0]))
+{
+}
 
-GameObject::GameObject(const TileSet *sprites, const uint8_t *tilemap,
-	uint8_t x, uint8_t y, GameObject **objects,
-	uint8_t first_floor_tile, uint8_t first_cross_tile, int &objects_left)
-	: m_sprites(sprites), m_x(x), m_y(y), m_objects(objects),
-	  m_objects_left(objects_left),
-	  m_tilemap(tilemap), m_first_floor_tile(first_floor_tile),
-	  m_first_cross_tile(first_cross_tile)
+void GameObject::moveTo(int square)
 {
+	m_objects[m_square] = NULL;
+	m_objects[square] = this;
+	m_square = square;
+	m_x = (square % m_level.paddedWidth()) - 1;
+	m_y = (square / m_level.paddedWidth()) - 1;
 }
 
-bool GameObject::tileIsEmpty(uint8_t x, uint8_t y) const
+void GameObject::reset()
 {
-	// Floor and cross tiles can be moved into
-	return (m_tilemap[(y * P2_LEVEL_WIDTH) + x] >= m_first_floor_tile);
+	m_square = m_start_square;
+	m_x = (m_square % m_level.paddedWidth()) - 1;
+	m_y = (m_square / m_level.paddedWidth()) - 1;
+	m_objects[m_square] = this;
 }
 
-bool GameObject::tileIsCross(uint8_t x, uint8_t y) const
+void GameObject::save(ObjectState &s) const
 {
-	return (m_tilemap[(y * P2_LEVEL_WIDTH) + x] < m_first_cross_tile);
+	memset(&s, 0, sizeof(s));
+	s.x = m_x;
+	s.y = m_y;
 }
 
-bool PushableObject::canMove(Direction d) const
+void GameObject::restore(const ObjectState &s)
 {
-	uint8_t cx = m_x;
-	uint8_t cy = m_y;
-	switch (d)
+	m_x = s.x;
+	m_y = s.y;
+	m_square = m_level.paddedIndex(m_x, m_y);
+	m_objects[m_square] = this;
+}
+
+uint32_t GameObject::fold(uint32_t h, uint32_t v)
+{
+	for (int i = 0; i < 4; ++i)
 	{
-		case Up:
-			if (cy == 0)
-				return false;
-			--cy;
-			break;
-		case Down:
-			if (cy == P2_LEVEL_HEIGHT)
-				return false;
-			++cy;
-			break;
-		case Left:
-			if (cx == 0)
-				return false;
-			--cx;
-			break;
-		case Right:
-			if (cx == P2_LEVEL_WIDTH)
-				return false;
-			++cx;
+		h ^= (v >> (i * 8)) & 0xff;
+		h *= 16777619u;
 	}
-	return (tileIsEmpty(cx, cy) && !m_objects[(cy * P2_LEVEL_WIDTH) + cx]);
+	return h;
+}
+
+uint32_t GameObject::digest(uint32_t h) const
+{
+	h = fold(h, m_x);
+	return fold(h, m_y);
 }
 
-PushableObject::PushableObject(const TileSet *sprites, const uint8_t *tilemap,
-	uint8_t x, uint8_t y, GameObject **objects,
-	uint8_t first_floor_tile, uint8_t first_cross_tile,
-	int &objects_left)
-	: GameObject(sprites, tilemap, x, y, objects,
-		first_floor_tile, first_cross_tile, objects_left),
+bool PushableObject::canMove(Direction d) const
+{
+	int next = m_square + stride(d);
+	return (cellIsFloor(next) && !m_objects[next]);
+}
+
+PushableObject::PushableObject(const TileSet *sprites, const Level &level,
+	uint8_t x, uint8_t y, GameObject **objects, int &objects_left)
+	: GameObject(sprites, level, x, y, objects, objects_left),
 	  AnimableObject(x, y), m_defused(false)
 {}
 
 AnimableObject::AnimableObject(uint8_t ax, uint8_t ay)
-	: m_anim_x(ax * P2_TILE_WIDTH), m_anim_y(ay * P2_TILE_HEIGHT),
-	  m_anim_fps(15), m_anim_index(0), m_anim_state(0), m_anim_frames_elapsed(0.0f)
+	: m_pos_x((ax * P2_TILE_WIDTH) << P2_SUBPIXEL_SHIFT),
+	  m_pos_y((ay * P2_TILE_HEIGHT) << P2_SUBPIXEL_SHIFT),
+	  m_prev_x(m_pos_x), m_prev_y(m_pos_y),
+	  m_anim_fps(ANIM_FPS), m_anim_index(0), m_anim_state(0),
+	  m_anim_frames_elapsed(0)
 {}
 
-Ball::Ball(const TileSet *sprites, const uint8_t *tilemap,
-	uint8_t x, uint8_t y, GameObject **objects,
-	uint8_t first_floor_tile, uint8_t first_cross_tile,
-	int &objects_left)
-	: PushableObject(sprites, tilemap, x, y, objects,
-		first_floor_tile, first_cross_tile, objects_left),
+void AnimableObject::resetAnim(uint8_t ax, uint8_t ay)
+{
+	m_pos_x = (ax * P2_TILE_WIDTH) << P2_SUBPIXEL_SHIFT;
+	m_pos_y = (ay * P2_TILE_HEIGHT) << P2_SUBPIXEL_SHIFT;
+	m_prev_x = m_pos_x;
+	m_prev_y = m_pos_y;
+	m_anim_fps = ANIM_FPS;
+	m_anim_index = 0;
+	m_anim_state = 0;
+	m_anim_frames_elapsed = 0;
+}
+
+void AnimableObject::saveAnim(ObjectState &s) const
+{
+	s.pos_x = m_pos_x;
+	s.pos_y = m_pos_y;
+	s.prev_x = m_prev_x;
+	s.prev_y = m_prev_y;
+	s.anim_index = m_anim_index;
+	s.anim_state = m_anim_state;
+	s.anim_frames = m_anim_frames_elapsed;
+}
+
+void AnimableObject::restoreAnim(const ObjectState &s)
+{
+	m_pos_x = s.pos_x;
+	m_pos_y = s.pos_y;
+	m_prev_x = s.prev_x;
+	m_prev_y = s.prev_y;
+	m_anim_index = s.anim_index;
+	m_anim_state = s.anim_state;
+	m_anim_frames_elapsed = s.anim_frames;
+}
+
+void PushableObject::reset()
+{
+	GameObject::reset();
+	resetAnim(m_x, m_y);
+	m_defused = false;
+}
+
+void PushableObject::save(ObjectState &s) const
+{
+	GameObject::save(s);
+	saveAnim(s);
+	if (m_defused)
+		s.flags |= P2_OBJECT_DEFUSED;
+}
+
+void PushableObject::restore(const ObjectState &s)
+{
+	GameObject::restore(s);
+	restoreAnim(s);
+	m_defused = (s.flags & P2_OBJECT_DEFUSED);
+}
+
+Ball::Ball(const TileSet *sprites, const Level &level,
+	uint8_t x, uint8_t y, GameObject **objects, int &objects_left)
+	: PushableObject(sprites, level, x, y, objects, objects_left),
 	  m_rolling(false), m_speed(PUSH_SPEED)
 {}
 
-Box::Box(const TileSet *sprites, const uint8_t *tilemap,
-	uint8_t x, uint8_t y, GameObject **objects,
-	uint8_t first_floor_tile, uint8_t first_cross_tile,
-	int &objects_left)
-	: PushableObject(sprites, tilemap, x, y, objects,
-		first_floor_tile, first_cross_tile, objects_left)
+Box::Box(const TileSet *sprites, const Level &level,
+	uint8_t x, uint8_t y, GameObject **objects, int &objects_left)
+	: PushableObject(sprites, level, x, y, objects, objects_left)
 {}
 
-Player::Player(const TileSet *sprites, const uint8_t *tilemap,
-	uint8_t x, uint8_t y, GameObject **objects,
-	uint8_t first_floor_tile, uint8_t first_cross_tile,
-	int &objects_left)
-	: GameObject(sprites, tilemap, x, y, objects,
-		first_floor_tile, first_cross_tile, objects_left),
+Player::Player(const TileSet *sprites, const Level &level,
+	uint8_t x, uint8_t y, GameObject **objects, int &objects_left)
+	: GameObject(sprites, level, x, y, objects, objects_left),
 	  AnimableObject(x, y), m_speed(PLAYER_SPEED), m_busy(false), m_straining(false)
 {}
 
-int AnimableObject::advanceAnim(float elapsed)
+void Ball::reset()
+{
+	PushableObject::reset();
+	m_rolling = false;
+	m_speed = PUSH_SPEED;
+}
+
+void Ball::save(ObjectState &s) const
 {
-	m_anim_frames_elapsed += m_anim_fps * elapsed;
+	PushableObject::save(s);
+	if (m_rolling)
+		s.flags |= P2_OBJECT_ROLLING;
+	s.speed = m_speed;
+}
 
-	int whole_frames_elapsed = floorf(m_anim_frames_elapsed);
-	m_anim_frames_elapsed -= (float)whole_frames_elapsed;
+void Ball::restore(const ObjectState &s)
+{
+	PushableObject::restore(s);
+	m_rolling = (s.flags & P2_OBJECT_ROLLING);
+	m_speed = s.speed;
+}
+
+void Player::reset()
+{
+	GameObject::reset();
+	resetAnim(m_x, m_y);
+	m_speed = PLAYER_SPEED;
+	m_busy = false;
+	m_straining = false;
+}
+
+void Player::save(ObjectState &s) const
+{
+	GameObject::save(s);
+	saveAnim(s);
+	if (m_busy)
+		s.flags |= P2_OBJECT_BUSY;
+	if (m_straining)
+		s.flags |= P2_OBJECT_STRAINING;
+	s.speed = m_speed;
+}
+
+void Player::restore(const ObjectState &s)
+{
+	GameObject::restore(s);
+	restoreAnim(s);
+	m_busy = (s.flags & P2_OBJECT_BUSY);
+	m_straining = (s.flags & P2_OBJECT_STRAINING);
+	m_speed = s.speed;
+}
+
+int AnimableObject::advanceAnim()
+{
+	m_anim_frames_elapsed += m_anim_fps;
+
+	int whole_frames_elapsed = m_anim_frames_elapsed / P2_TICK_RATE;
+	m_anim_frames_elapsed -= whole_frames_elapsed * P2_TICK_RATE;
 
 	return whole_frames_elapsed;
 }
 
-bool AnimableObject::slideTo(uint8_t x, uint8_t y, float speed, float elapsed)
+uint32_t AnimableObject::digestAnim(uint32_t h) const
+{
+	h = GameObject::fold(h, m_pos_x);
+	h = GameObject::fold(h, m_pos_y);
+	h = GameObject::fold(h, m_prev_x);
+	h = GameObject::fold(h, m_prev_y);
+	h = GameObject::fold(h, m_anim_fps);
+	h = GameObject::fold(h, m_anim_index);
+	h = GameObject::fold(h, m_anim_state);
+	return GameObject::fold(h, m_anim_frames_elapsed);
+}
+
+void AnimableObject::animPosition(int32_t alpha, int &x, int &y) const
 {
-	float amount = speed * elapsed;
-	if (m_anim_x > (float)x * (float)P2_TILE_WIDTH)
+	int32_t fx = m_prev_x + (int32_t)(((int64_t)(m_pos_x - m_prev_x) * alpha)
+		>> P2_SUBPIXEL_SHIFT);
+	int32_t fy = m_prev_y + (int32_t)(((int64_t)(m_pos_y - m_prev_y) * alpha)
+		>> P2_SUBPIXEL_SHIFT);
+	x = fx >> P2_SUBPIXEL_SHIFT;
+	y = fy >> P2_SUBPIXEL_SHIFT;
+}
+
+bool AnimableObject::animRect(int32_t alpha, int origin_x, int origin_y,
+	const RenderQueue &queue, SDL_Rect &rect) const
+{
+	int x, y;
+	animPosition(alpha, x, y);
+	x -= origin_x;
+	y -= origin_y;
+	if (x <= -P2_TILE_WIDTH || y <= -P2_TILE_HEIGHT
+		|| x >= queue.width() || y >= queue.height())
+		return false;
+	rect.x = x;
+	rect.y = y;
+	rect.w = 0;
+	rect.h = 0;
+	return true;
+}
+
+bool AnimableObject::slideTo(uint8_t x, uint8_t y, int32_t step)
+{
+	int32_t dest_x = (x * P2_TILE_WIDTH) << P2_SUBPIXEL_SHIFT;
+	int32_t dest_y = (y * P2_TILE_HEIGHT) << P2_SUBPIXEL_SHIFT;
+	if (m_pos_x > dest_x)
 	{
-		m_anim_x -= amount;
-		if (m_anim_x <= (float)x * (float)P2_TILE_WIDTH)
+		m_pos_x -= step;
+		if (m_pos_x <= dest_x)
 		{
-			m_anim_x = x * P2_TILE_WIDTH;
+			m_pos_x = dest_x;
 			return true;
 		}
 		else
 			return false;
 	}
 
-	if (m_anim_x < (float)x * (float)P2_TILE_WIDTH)
+	if (m_pos_x < dest_x)
 	{
-		m_anim_x += amount;
-		if (m_anim_x >= (float)x * (float)P2_TILE_WIDTH)
+		m_pos_x += step;
+		if (m_pos_x >= dest_x)
 		{
-			m_anim_x = x * P2_TILE_WIDTH;
+			m_pos_x = dest_x;
 			return true;
 		}
 		else
 			return false;
 	}
 
-	if (m_anim_y > (float)y * (float)P2_TILE_HEIGHT)
+	if (m_pos_y > dest_y)
 	{
-		m_anim_y -= amount;
-		if (m_anim_y <= (float)y * (float)P2_TILE_HEIGHT)
+		m_pos_y -= step;
+		if (m_pos_y <= dest_y)
 		{
-			m_anim_y = y * P2_TILE_HEIGHT;
+			m_pos_y = dest_y;
 			return true;
 		}
 		else
 			return false;
 	}
 
-	if (m_anim_y < (float)y * (float)P2_TILE_HEIGHT)
+	if (m_pos_y < dest_y)
 	{
-		m_anim_y += amount;
-		if (m_anim_y >= (float)y * (float)P2_TILE_HEIGHT)
+		m_pos_y += step;
+		if (m_pos_y >= dest_y)
 		{
-			m_anim_y = y * P2_TILE_HEIGHT;
+			m_pos_y = dest_y;
 			return true;
 		}
 		else
@@ -202,57 +357,14 @@ bool AnimableObject::slideTo(uint8_t x, uint8_t y, float speed, float elapsed)
 
 void Ball::push(Direction d)
 {
-	// Immediately move to the furthest empty square in the given direction
-	// Move until we hit a wall or filled square, then back up one
-	// Be careful not to go off the edges
-	int cx = m_x;
-	int cy = m_y;
-	switch (d)
-	{
-		case Up:
-			for (cy = m_y - 1; cy >= 0; --cy)
-			{
-				if (!tileIsEmpty(m_x, cy) || m_objects[(cy * P2_LEVEL_WIDTH) + m_x])
-				{
-					++cy;
-					break;
-				}
-			}
-			break;
-		case Down:
-			for (cy = m_y + 1; cy < P2_LEVEL_HEIGHT; ++cy)
-			{
-				if (!tileIsEmpty(m_x, cy) || m_objects[(cy * P2_LEVEL_WIDTH) + m_x])
-				{
-					--cy;
-					break;
-				}
-			}
-			break;
-		case Left:
-			for (cx = m_x - 1; cx >= 0; --cx)
-			{
-				if (!tileIsEmpty(cx, m_y) || m_objects[(m_y * P2_LEVEL_WIDTH) + cx])
-				{
-					++cx;
-					break;
-				}
-			}
-			break;
-		case Right:
-			for (cx = m_x + 1; cx < P2_LEVEL_WIDTH; ++cx)
-			{
-				if (!tileIsEmpty(cx, m_y) || m_objects[(m_y * P2_LEVEL_WIDTH) + cx])
-				{
-					--cx;
-					break;
-				}
-			}
-	}
-	m_objects[(m_y * P2_LEVEL_WIDTH) + m_x] = NULL;
-	m_objects[(cy * P2_LEVEL_WIDTH) + cx] = this;
-	m_x = cx;
-	m_y = cy;
+	// Immediately move to the furthest empty square in the given
+	// direction.  The border of wall round the level stops us going
+	// off the edge.
+	int step = stride(d);
+	int dest = m_square;
+	while (cellIsFloor(dest + step) && !m_objects[dest + step])
+		dest += step;
+	moveTo(dest);
 	m_rolling = true;
 	m_speed = PUSH_SPEED;
 }
@@ -260,58 +372,41 @@ void Ball::push(Direction d)
 void Box::push(Direction d)
 {
 	// Move one square in given direction
-	int cx = m_x;
-	int cy = m_y;
-	switch (d)
-	{
-		case Up:
-			--cy;
-			break;
-		case Down:
-			++cy;
-			break;
-		case Left:
-			--cx;
-			break;
-		case Right:
-			++cx;
-	}
-	m_objects[(m_y * P2_LEVEL_WIDTH) + m_x] = NULL;
-	m_objects[(cy * P2_LEVEL_WIDTH) + cx] = this;
-	m_x = cx;
-	m_y = cy;
+	moveTo(m_square + stride(d));
 }
 
-void Ball::render(SDL_Surface *screen, float elapsed)
+void Ball::tick()
 {
+	beginTick();
+
 	if (m_rolling)
 	{
-		if (slideTo(m_x, m_y, m_speed, elapsed))
+		if (slideTo(m_x, m_y, m_speed))
 			m_rolling = false;
 
 		// Balls start at pushing speed, and accelerate
 		// to rolling speed as they are pushed
 		if (m_speed < ROLL_SPEED)
 		{
-			m_speed += ROLL_ACCEL * elapsed;
+			m_speed += ROLL_ACCEL;
 			if (m_speed > ROLL_SPEED)
 				m_speed = ROLL_SPEED;
 		}
 	}
 	// Check (when arrived) whether destination is a cross, and defuse
-	if (!m_rolling && !m_defused && tileIsCross(m_x, m_y))
+	if (!m_rolling && !m_defused && cellIsCross(m_square))
 	{
 		--m_objects_left;
 		m_defused = true;
 	}
-	if (m_defused && !tileIsCross(m_x, m_y))
+	if (m_defused && !cellIsCross(m_square))
 	{
 		// We've been pushed off a cross, arrived or otherwise
 		++m_objects_left;
 		m_defused = false;
 	}
 
-	int count = advanceAnim(elapsed);
+	int count = advanceAnim();
 
 	while (count--)
 	{
@@ -351,39 +446,47 @@ void Ball::render(SDL_Surface *screen, float elapsed)
 				}
 		}
 	}
+}
 
-	SDL_Rect rect = {
-		(Sint16)m_anim_x, (Sint16)m_anim_y,
-		0, 0
-	};
+void Ball::render(RenderQueue &queue, int32_t alpha,
+	int origin_x, int origin_y) const
+{
+	SDL_Rect rect;
+	if (!animRect(alpha, origin_x, origin_y, queue, rect))
+		return;
+
+	queue.sprite(RenderQueue::Objects, m_sprites->sprite(m_anim_index + 8),
+		rect.x, rect.y);
+}
 
-	SDL_Surface *sprite = (*m_sprites)[m_anim_index + 8];
-	SDL_BlitSurface(sprite, NULL, screen, &rect);
+uint32_t Ball::digest(uint32_t h) const
+{
+	h = digestAnim(GameObject::digest(h));
+	h = fold(h, m_defused);
+	h = fold(h, m_rolling);
+	return fold(h, m_speed);
 }
 
-void Box::render(SDL_Surface *screen, float elapsed)
+void Box::tick()
 {
-	bool arrived = slideTo(m_x, m_y, PUSH_SPEED, elapsed);
-	if (!m_defused && tileIsCross(m_x, m_y) && arrived)
+	beginTick();
+
+	bool arrived = slideTo(m_x, m_y, PUSH_SPEED);
+	if (!m_defused && cellIsCross(m_square) && arrived)
 	{
 		// We've arived on a cross
 		--m_objects_left;
 		m_defused = true;
 	}
 
-	if (m_defused && !tileIsCross(m_x, m_y))
+	if (m_defused && !cellIsCross(m_square))
 	{
 		// We've been pushed off a cross, arrived or otherwise
 		++m_objects_left;
 		m_defused = false;
 	}
 
-	SDL_Rect rect = {
-		(Sint16)m_anim_x, (Sint16)m_anim_y,
-		0, 0
-	};
-
-	int count = advanceAnim(elapsed);
+	int count = advanceAnim();
 
 	while (count--)
 	{
@@ -417,16 +520,32 @@ void Box::render(SDL_Surface *screen, float elapsed)
 				}
 		}
 	}
+}
+
+void Box::render(RenderQueue &queue, int32_t alpha,
+	int origin_x, int origin_y) const
+{
+	SDL_Rect rect;
+	if (!animRect(alpha, origin_x, origin_y, queue, rect))
+		return;
+
+	queue.sprite(RenderQueue::Objects, m_sprites->sprite(m_anim_index),
+		rect.x, rect.y);
+}
 
-	SDL_Surface *sprite = (*m_sprites)[m_anim_index];
-	SDL_BlitSurface(sprite, NULL, screen, &rect);
+uint32_t Box::digest(uint32_t h) const
+{
+	h = digestAnim(GameObject::digest(h));
+	return fold(h, m_defused);
 }
 
-void Player::render(SDL_Surface *screen, float elapsed)
+void Player::tick()
 {
+	beginTick();
+
 	if (m_busy)
 	{
-		if (slideTo(m_x, m_y, m_speed, elapsed))
+		if (slideTo(m_x, m_y, m_speed))
 		{
 			// We've arrived - we have finished pushing for now
 			m_speed = PLAYER_SPEED;
@@ -436,21 +555,15 @@ void Player::render(SDL_Surface *screen, float elapsed)
 
 	// Animate up/down/left/right loops
 	// All are 6 frames long
-	int count = advanceAnim(elapsed);
+	int count = advanceAnim();
 	while (count--)
 	{
 		if (++m_anim_index == 6)
 			m_anim_index = 0;
 	}
 
-	SDL_Rect rect = {
-		(Sint16)m_anim_x, (Sint16)m_anim_y,
-		0, 0
-	};
-	SDL_Surface *sprite = (*m_sprites)[m_anim_index + m_anim_state + (m_straining ? 24 : 0)];
-	SDL_BlitSurface(sprite, NULL, screen, &rect);
 	// If player pushed against a wall, only stay in the left/right/up/down
-	// animation for one frame, unless they keep the key held down
+	// animation for one tick, unless they keep the key held down
 	if (!m_busy)
 	{
 		m_anim_state = 0;
@@ -458,73 +571,67 @@ void Player::render(SDL_Surface *screen, float elapsed)
 	}
 }
 
+void Player::render(RenderQueue &queue, int32_t alpha,
+	int origin_x, int origin_y) const
+{
+	SDL_Rect rect;
+	if (!animRect(alpha, origin_x, origin_y, queue, rect))
+		return;
+	queue.sprite(RenderQueue::Objects,
+		m_sprites->sprite(m_anim_index + m_anim_state + (m_straining ? 24 : 0)),
+		rect.x, rect.y);
+}
+
+void Player::position(int32_t alpha, int &x, int &y) const
+{
+	animPosition(alpha, x, y);
+}
+
+uint32_t Player::digest(uint32_t h) const
+{
+	h = digestAnim(GameObject::digest(h));
+	h = fold(h, m_speed);
+	h = fold(h, m_busy);
+	return fold(h, m_straining);
+}
+
 void Player::move(Direction d)
 {
 	// Can't change direction whilst moving
 	if (m_busy)
 		return;
 
-	int cx = m_x;
-	int cy = m_y;
-	switch (d)
+	// First frame of left/right/up/down animation
+	static const uint8_t anim_states[4] = {18, 24, 6, 12};
+	m_anim_state = anim_states[d];
+
+	// Is the space blocked by a wall?
+	int next = m_square + stride(d);
+	if (!cellIsFloor(next))
 	{
-		case Up:
-			if (cy > 0)
-				--cy;
-			// First frame of up animation
-			m_anim_state = 6;
-			break;
-		case Down:
-			if (cy < P2_LEVEL_HEIGHT)
-				++cy;
-			// First frame of down animation
-			m_anim_state = 12;
-			break;
-		case Left:
-			if (cx > 0)
-				--cx;
-			// First frame of left animation
-			m_anim_state = 18;
-			break;
-		case Right:
-			if (cx < P2_LEVEL_WIDTH)
-				++cx;
-			// First frame of right animation
-			m_anim_state = 24;
+		// Use strain animations up against walls
+		m_straining = true;
+		return;
 	}
-	// Are we away from the edges?
-	if (cx != m_x || cy != m_y)
+
+	// Is there a pushable object there?
+	GameObject *o = m_objects[next];
+	if (o)
 	{
-		// Is the space blocked by a wall?
-		if (tileIsEmpty(cx, cy))
+		// Use strain animations up against objects,
+		// movable or otherwise
+		m_straining = true;
+		if (((PushableObject*)o)->canMove(d))
 		{
-			// Is there a pushable object there?
-			GameObject *o = m_objects[(cy * P2_LEVEL_WIDTH) + cx];
-			if (o)
-			{
-				// Use strain animations up against objects,
-				// movable or otherwise
-				m_straining = true;
-				if (((PushableObject*)o)->canMove(d))
-				{
-					((PushableObject*)o)->push(d);
-					// We're straining - reduce movement speed
-					m_speed = PUSH_SPEED;
-				}
-				else
-					return;
-			}
-			// We can move
-			m_objects[(m_y * P2_LEVEL_WIDTH) + m_x] = NULL;
-			m_objects[(cy * P2_LEVEL_WIDTH) + cx] = this;
-			m_x = cx;
-			m_y = cy;
-			m_busy = true;
+			((PushableObject*)o)->push(d);
+			// We're straining - reduce movement speed
+			m_speed = PUSH_SPEED;
 		}
 		else
-		{
-			// Use strain animations up against walls
-			m_straining = true;
-		}
+			return;
 	}
+
+	// We can move
+	moveTo(next);
+	m_busy = true;
 }
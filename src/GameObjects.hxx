@@ -20,40 +20,128 @@
 
 #include <cstdint>
 
+#include <SDL.h>
+
 #include "TileSet.hxx"
+#include "LevelSet.hxx"
+#include "Board.hxx"
+#include "RenderQueue.hxx"
+
+// Flags in ObjectState
+#define P2_OBJECT_DEFUSED 1
+#define P2_OBJECT_ROLLING 2
+#define P2_OBJECT_BUSY 4
+#define P2_OBJECT_STRAINING 8
+
+// Everything about an object which changes as the game is played, for
+// saving and restoring by Rewind.  Fields an object doesn't have are 0.
+struct ObjectState
+{
+	uint8_t x;
+	uint8_t y;
+	uint8_t flags;
+	uint8_t anim_index;
+	uint8_t anim_state;
+	uint16_t anim_frames;
+	int32_t pos_x;
+	int32_t pos_y;
+	int32_t prev_x;
+	int32_t prev_y;
+	int32_t speed;
 
+	// Same position and flags, ignoring animation?
+	bool sameAs(const ObjectState &o) const
+	{
+		return (x == o.x && y == o.y && flags == o.flags
+			&& pos_x == o.pos_x && pos_y == o.pos_y
+			&& prev_x == o.prev_x && prev_y == o.prev_y
+			&& speed == o.speed);
+	};
+};
+
+// Objects on a padded level (see Level::cells).  Each one refers to the
+// level's cell flags and has a pointer to an array of object pointers
+// with one entry per padded square, which they keep up to date as they
+// move about.
 class GameObject
 {
 	public:
-		GameObject(const TileSet *sprites, const uint8_t *tilemap,
-			uint8_t x, uint8_t y, GameObject **objects,
-			uint8_t first_floor_tile, uint8_t first_cross_tile,
-			int &objects_left);
-		virtual void render(SDL_Surface *screen, float elapsed) = 0;
+		GameObject(const TileSet *sprites, const Level &level,
+			uint8_t x, uint8_t y, GameObject **objects, int &objects_left);
 		virtual ~GameObject() {};
 
+		// Advance the object by one simulation tick
+		virtual void tick() = 0;
+
+		// Go back to the square and state the object started in,
+		// taking that square in the object array.  The caller must
+		// first clear every object's current square in the array.
+		virtual void reset();
+
+		// Save or restore everything that changes during play.
+		// Restoring takes the saved square in the object array, so
+		// as for reset(), the caller must clear the current one first.
+		virtual void save(ObjectState &s) const;
+		virtual void restore(const ObjectState &s);
+
+		// Draw the object at the given fraction of the way from its
+		// position as of the previous tick to its current position,
+		// where 1 << P2_SUBPIXEL_SHIFT is the whole way, with the level
+		// pixel at (origin_x, origin_y) in the frame's top left corner.
+		// Objects entirely off the frame aren't drawn.  Changes nothing,
+		// so may be called any number of times between ticks.
+		virtual void render(RenderQueue &queue, int32_t alpha,
+			int origin_x, int origin_y) const = 0;
+
+		// Fold all simulation state into the given hash, so that runs
+		// can be checked for bit-identical results
+		virtual uint32_t digest(uint32_t h) const;
+
+		// FNV-1a step over the bytes of a value
+		static uint32_t fold(uint32_t h, uint32_t v);
+
+		uint8_t getX() const
+		{
+			return m_x;
+		};
+
+		uint8_t getY() const
+		{
+			return m_y;
+		};
+
 	protected:
-		bool tileIsEmpty(uint8_t x, uint8_t y) const;
-		bool tileIsCross(uint8_t x, uint8_t y) const;
+		// Floor and cross tiles can be moved into
+		bool cellIsFloor(int square) const
+		{
+			return (m_cells[square] & P2_CELL_FLOOR);
+		};
+
+		bool cellIsCross(int square) const
+		{
+			return (m_cells[square] & P2_CELL_CROSS);
+		};
+
+		// Offset to the neighbouring (padded) square in a direction
+		int stride(Direction d) const
+		{
+			return m_level.strides[d];
+		};
+
+		// Move to another (padded) square, updating the object array
+		void moveTo(int square);
 
 		const TileSet *m_sprites;
 		uint8_t m_x;
 		uint8_t m_y;
+		int m_square;
+		int m_start_square;
 		GameObject **m_objects;
 		int &m_objects_left;
 
 	private:
-		const uint8_t *m_tilemap;
-		const uint8_t m_first_floor_tile;
-		const uint8_t m_first_cross_tile;
-};
-
-enum Direction
-{
-	Left,
-	Right,
-	Up,
-	Down
+		const Level &m_level;
+		const uint8_t *m_cells;
 };
 
 class AnimableObject
@@ -62,33 +150,66 @@ class AnimableObject
 		AnimableObject(uint8_t ax, uint8_t ay);
 		virtual ~AnimableObject() {};
 	protected:
-		float m_anim_x;
-		float m_anim_y;
-		float m_anim_fps;
+		// Position in fixed-point pixels - see P2_SUBPIXEL_SHIFT -
+		// as of the current and previous ticks
+		int32_t m_pos_x;
+		int32_t m_pos_y;
+		int32_t m_prev_x;
+		int32_t m_prev_y;
+		int m_anim_fps;
 		uint8_t m_anim_index;
 		uint8_t m_anim_state;
 
-		// Move object to given destination square at given speed.
-		// Returns true when arrived.
-		bool slideTo(uint8_t x, uint8_t y, float speed, float elapsed);
+		// Back to the still, unanimated state objects start in,
+		// at the given square
+		void resetAnim(uint8_t ax, uint8_t ay);
+
+		// Position and animation, for GameObject::save and restore.
+		// The animation rate never changes, so isn't included.
+		void saveAnim(ObjectState &s) const;
+		void restoreAnim(const ObjectState &s);
 
-		// Return number of frames by which to advance animation
-		int advanceAnim(float elapsed);
+		// Remember the current position before starting a new tick
+		void beginTick()
+		{
+			m_prev_x = m_pos_x;
+			m_prev_y = m_pos_y;
+		};
+
+		// Position in level pixels, interpolating between the previous
+		// and current positions - see GameObject::render
+		void animPosition(int32_t alpha, int &x, int &y) const;
+
+		// Where on the frame to draw the object - see GameObject::render.
+		// Returns false if it would be entirely off the frame.
+		bool animRect(int32_t alpha, int origin_x, int origin_y,
+			const RenderQueue &queue, SDL_Rect &rect) const;
+
+		// Move object towards given destination square by the given
+		// number of fixed-point pixels.  Returns true when arrived.
+		bool slideTo(uint8_t x, uint8_t y, int32_t step);
+
+		// Return number of frames by which to advance animation this tick
+		int advanceAnim();
+
+		uint32_t digestAnim(uint32_t h) const;
 
 	private:
-		float m_anim_frames_elapsed;
+		// Animation frames elapsed, in units of 1/P2_TICK_RATE frames
+		int m_anim_frames_elapsed;
 };
 
 class PushableObject: public GameObject, public AnimableObject
 {
 	public:
-		PushableObject(const TileSet *sprites, const uint8_t *tilemap,
-			uint8_t x, uint8_t y, GameObject **objects,
-			uint8_t first_floor_tile, uint8_t first_cross_tile,
-			int &objects_left);
+		PushableObject(const TileSet *sprites, const Level &level,
+			uint8_t x, uint8_t y, GameObject **objects, int &objects_left);
 		bool canMove(Direction d) const;
 		virtual void push(Direction d) = 0;
 		virtual ~PushableObject() {};
+		void reset();
+		void save(ObjectState &s) const;
+		void restore(const ObjectState &s);
 	protected:
 		bool m_defused;
 };
@@ -96,39 +217,51 @@ class PushableObject: public GameObject, public AnimableObject
 class Ball: public PushableObject
 {
 	public:
-		Ball(const TileSet *sprites, const uint8_t *tilemap,
-			uint8_t x, uint8_t y, GameObject **objects,
-			uint8_t first_floor_tile, uint8_t first_cross_tile,
-			int &objects_left);
+		Ball(const TileSet *sprites, const Level &level,
+			uint8_t x, uint8_t y, GameObject **objects, int &objects_left);
 		void push(Direction d);
-		void render(SDL_Surface *screen, float elapsed);
+		void tick();
+		void reset();
+		void save(ObjectState &s) const;
+		void restore(const ObjectState &s);
+		void render(RenderQueue &queue, int32_t alpha,
+			int origin_x, int origin_y) const;
+		uint32_t digest(uint32_t h) const;
 	private:
 		bool m_rolling;
-		float m_speed;
+		int32_t m_speed;
 };
 
 class Box: public PushableObject
 {
 	public:
-		Box(const TileSet *sprites, const uint8_t *tilemap,
-			uint8_t x, uint8_t y, GameObject **objects,
-			uint8_t first_floor_tile, uint8_t first_cross_tile,
-			int &objects_left);
+		Box(const TileSet *sprites, const Level &level,
+			uint8_t x, uint8_t y, GameObject **objects, int &objects_left);
 		void push(Direction d);
-		void render(SDL_Surface *screen, float elapsed);
+		void tick();
+		void render(RenderQueue &queue, int32_t alpha,
+			int origin_x, int origin_y) const;
+		uint32_t digest(uint32_t h) const;
 };
 
 class Player: public GameObject, AnimableObject
 {
 	public:
-		Player(const TileSet *sprites, const uint8_t *tilemap,
-			uint8_t x, uint8_t y, GameObject **objects,
-			uint8_t first_floor_tile, uint8_t first_cross_tile,
-			int &objects_left);
-		void render(SDL_Surface *screen, float elapsed);
+		Player(const TileSet *sprites, const Level &level,
+			uint8_t x, uint8_t y, GameObject **objects, int &objects_left);
+		void tick();
+		void reset();
+		void save(ObjectState &s) const;
+		void restore(const ObjectState &s);
+		void render(RenderQueue &queue, int32_t alpha,
+			int origin_x, int origin_y) const;
+		uint32_t digest(uint32_t h) const;
 		void move(Direction d);
+
+		// Position in level pixels, interpolated as for render()
+		void position(int32_t alpha, int &x, int &y) const;
 	private:
-		float m_speed;
+		int32_t m_speed;
 		bool m_busy;
 		bool m_straining;
 };
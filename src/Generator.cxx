@@ -0,0 +1,331 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+
+// System
+
+// Library
+
+// Local
+#include "Generator.hxx"
+#include "ThreadPool.hxx"
+
+//
+// Implementation
+//
+
+// Bonus counter start value for generated levels: a base amount,
+// plus a bit more for each push needed to solve them
+#define GEN_BONUS 500
+#define GEN_BONUS_PER_PUSH 20
+
+// Rooms are carved until they have somewhere between this many
+// floor squares and this many more
+#define GEN_MIN_FLOOR 24
+#define GEN_EXTRA_FLOOR 40
+
+Generator::Options::Options()
+	: count(100), seed(1), tries(8), min_boxes(2), max_boxes(4),
+	  max_balls(1), min_pushes(10), max_states(200000), threads(0),
+	  name("Random")
+{
+}
+
+Generator::Generator(const Xsb::Tiles &tiles, uint8_t first_floor_tile,
+	uint8_t first_cross_tile, const Options &o)
+	: m_tiles(tiles), m_first_floor_tile(first_floor_tile),
+	  m_first_cross_tile(first_cross_tile), m_options(o),
+	  m_search(o.max_states)
+{
+}
+
+void Generator::carve(Level &l)
+{
+	l.width = P2_LEVEL_WIDTH;
+	l.height = P2_LEVEL_HEIGHT;
+	l.tilemap.assign(l.width * l.height, m_tiles.wall);
+	l.cells.clear();
+
+	// Wander about inside the outer wall, sometimes carving out
+	// a 2*2 block rather than a single square, so that there are
+	// rooms as well as corridors
+	int target = GEN_MIN_FLOOR + random(GEN_EXTRA_FLOOR);
+	int floor = 0;
+	int x = 1 + random(l.width - 2);
+	int y = 1 + random(l.height - 2);
+	for (int step = 0; floor < target && step < 10000; ++step)
+	{
+		int size = random(3) ? 1 : 2;
+		for (int j = y; j < std::min(y + size, l.height - 1); ++j)
+		{
+			for (int i = x; i < std::min(x + size, l.width - 1); ++i)
+			{
+				uint8_t &t = l.tilemap[(j * l.width) + i];
+				if (t != m_tiles.floor)
+				{
+					t = m_tiles.floor;
+					++floor;
+				}
+			}
+		}
+
+		switch (random(4))
+		{
+			case 0: x = std::max(x - 1, 1); break;
+			case 1: x = std::min(x + 1, l.width - 2); break;
+			case 2: y = std::max(y - 1, 1); break;
+			case 3: y = std::min(y + 1, l.height - 2); break;
+		}
+	}
+}
+
+bool Generator::make(uint32_t seed, Result &r)
+{
+	m_random.seed(seed);
+	Level &l = r.level;
+	carve(l);
+
+	// Crosses go where something could be pulled off them, on squares
+	// with floor either side in at least one direction
+	std::vector<int> squares;
+	for (int i = 0; i < l.width * l.height; ++i)
+	{
+		if (l.tilemap[i] != m_tiles.floor)
+			continue;
+		bool horz = (l.tilemap[i - 1] == m_tiles.floor
+			&& l.tilemap[i + 1] == m_tiles.floor);
+		bool vert = (l.tilemap[i - l.width] == m_tiles.floor
+			&& l.tilemap[i + l.width] == m_tiles.floor);
+		if (horz || vert)
+			squares.push_back(i);
+	}
+	int boxes = m_options.min_boxes
+		+ random((m_options.max_boxes - m_options.min_boxes) + 1);
+	int balls = random(m_options.max_balls + 1);
+	int objects = boxes + balls;
+	if ((int)(squares.size()) <= objects)
+		return false;
+	for (int i = 0; i < objects; ++i)
+		std::swap(squares[i], squares[i + random(squares.size() - i)]);
+
+	// The player's starting square doesn't matter yet, as every
+	// position the objects can be in is searched from every square
+	// the player could be in
+	l.num_sprites = 1 + objects;
+	l.spriteinfo[0].x = squares[objects] % l.width;
+	l.spriteinfo[0].y = squares[objects] / l.width;
+	l.spriteinfo[0].index = Board::NoPiece;
+	for (int i = 0; i < objects; ++i)
+	{
+		l.tilemap[squares[i]] = m_tiles.cross;
+		SpriteInfo &s = l.spriteinfo[i + 1];
+		s.x = squares[i] % l.width;
+		s.y = squares[i] / l.width;
+		s.index = (i < boxes) ? Board::BoxPiece : Board::BallPiece;
+	}
+	Board b(l, m_first_floor_tile, m_first_cross_tile);
+
+	// Start from every way of putting the balls on the crosses,
+	// with the player in every separate part of the room left free
+	m_search.reset(b, true);
+	std::vector<bool> ball(objects, false);
+	std::fill(ball.end() - balls, ball.end(), true);
+	std::vector<uint8_t> grid(b.numSquares());
+	std::vector<uint8_t> done(b.numSquares());
+	do
+	{
+		Board::State s;
+		memset(&s, 0, sizeof(s));
+		int box = 0;
+		int ball_index = boxes;
+		for (int i = 0; i < objects; ++i)
+			s.objects[ball[i] ? ball_index++ : box++] = squares[i];
+
+		std::fill(done.begin(), done.end(), 0);
+		b.occupancy(s, &(grid[0]));
+		for (int i = 0; i < b.numSquares(); ++i)
+		{
+			if (done[i] || !b.isFloor(i) || grid[i] != Board::NoPiece)
+				continue;
+			m_search.reach(i, &(grid[0]));
+			for (int j = i; j < b.numSquares(); ++j)
+			{
+				if (m_search.reachable(j))
+					done[j] = 1;
+			}
+			s.player = i;
+			m_search.start(s);
+		}
+	}
+	while (std::next_permutation(ball.begin(), ball.end()));
+
+	// Search backwards, so that positions are found in order of
+	// the number of pushes needed to solve them
+	m_search.run();
+	const std::vector<Search::Node> &nodes = m_search.nodes();
+
+	// The level starts from the furthest position with every object
+	// off the crosses
+	uint32_t best = 0;
+	bool found = false;
+	for (uint32_t i = 0; i < nodes.size(); ++i)
+	{
+		const Search::Node &n = nodes[i];
+		if (found && n.depth <= nodes[best].depth)
+			continue;
+		bool off = true;
+		for (int j = 0; off && j < objects; ++j)
+			off = !b.isCross(n.state.objects[j]);
+		if (off)
+		{
+			best = i;
+			found = true;
+		}
+	}
+	if (!found || nodes[best].depth < m_options.min_pushes)
+		return false;
+
+	// Follow the shortest solution back to the crosses
+	r.pushes = nodes[best].depth;
+	int total = 0;
+	for (uint32_t i = best; nodes[i].depth > 0; i = nodes[i].parent)
+		total += m_search.branching(nodes[i].state);
+	r.branching = (double)total / r.pushes;
+	r.score = r.pushes * r.branching;
+
+	const Board::State &s = nodes[best].state;
+	l.spriteinfo[0].x = s.player % l.width;
+	l.spriteinfo[0].y = s.player / l.width;
+	for (int i = 0; i < objects; ++i)
+	{
+		SpriteInfo &si = l.spriteinfo[i + 1];
+		si.x = s.objects[i] % l.width;
+		si.y = s.objects[i] / l.width;
+		si.index = b.pieceAt(i);
+	}
+	return true;
+}
+
+int Generator::generate(const LevelSet &style, const Options &o,
+	const std::string &pack, std::ostream &out)
+{
+	std::ofstream p(pack.c_str(), std::ios_base::binary);
+	if (!p.is_open())
+	{
+		out << "Could not open \"" << pack << "\" for writing" << std::endl;
+		return -1;
+	}
+	LevelSet::writeHeader(p, style, 0);
+	Xsb::Tiles tiles = Xsb::chooseTiles(style);
+
+	// Each level, ready to write into the pack, and what to say
+	// about it, filled in by whichever thread makes it
+	struct Slot
+	{
+		std::string level;
+		std::string report;
+		bool ok;
+	};
+
+	// Seeds depend only on the level's number and the try, so which
+	// thread makes which level makes no difference.  Each level is
+	// written out as soon as it and those before it are done.
+	uint32_t total = 0;
+	int failures = 0;
+	ThreadPool pool(o.threads);
+	pool.parallelInOrder<Slot>(o.count, [&](size_t k, Slot &slot) {
+		Generator g(tiles, style.firstFloorTile(), style.firstCrossTile(), o);
+		Result r, best;
+		bool ok = false;
+		for (int t = 0; t < o.tries; ++t)
+		{
+			uint32_t seed = o.seed + ((uint32_t)k * (uint32_t)(o.tries)) + t;
+			if (g.make(seed, r) && (!ok || r.score > best.score))
+			{
+				std::swap(best, r);
+				ok = true;
+			}
+		}
+
+		std::ostringstream level;
+		std::ostringstream report;
+		if (ok)
+		{
+			Level &l = best.level;
+			std::ostringstream name;
+			name << o.name << ' ' << (k + 1);
+			l.name = name.str();
+			if (l.name.size() > 12)
+			{
+				name.str(std::string());
+				name << (k + 1);
+				l.name = name.str();
+			}
+			l.bonus = GEN_BONUS + (GEN_BONUS_PER_PUSH * best.pushes);
+			if (style.size())
+			{
+				memcpy(l.name_colour,
+					style[k % style.size()].name_colour, 3);
+			}
+			else
+				memset(l.name_colour, 255, 3);
+			LevelSet::writeLevel(level, l);
+			report << best.pushes << " pushes, branching "
+				<< best.branching << ", score " << best.score;
+		}
+		else
+			report << "FAILED: no candidate accepted";
+
+		slot.level = level.str();
+		slot.report = report.str();
+		slot.ok = ok;
+	}, [&](size_t k, Slot &slot) {
+		p.write(slot.level.data(), slot.level.size());
+		if (slot.ok)
+			++total;
+		else
+			++failures;
+		out << "Level " << (k + 1) << ": " << slot.report << std::endl;
+	});
+
+	// Now the number of levels is known
+	p.seekp(0);
+	LevelSet::writeHeader(p, style, total);
+	p.close();
+	if (!p)
+	{
+		out << "Could not write \"" << pack << "\"" << std::endl;
+		return -1;
+	}
+	out << total << " levels written to " << pack << std::endl;
+	return failures;
+}
@@ -0,0 +1,122 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HXX_GENERATOR
+#define HXX_GENERATOR
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdint>
+
+#include "Board.hxx"
+#include "LevelSet.hxx"
+#include "Search.hxx"
+#include "Xsb.hxx"
+
+// Makes new levels on the original 20*12 grid.  Each candidate is a
+// randomly carved room with its boxes and balls sat on crosses; from
+// there, the generator searches backwards (see Search), so that every
+// position reached is known to be solvable in the least number of
+// pushes it took to reach.  The furthest position with nothing left on
+// a cross becomes the level.
+class Generator
+{
+	public:
+		struct Options
+		{
+			Options();
+
+			// Number of levels to write
+			uint32_t count;
+
+			// Levels are made from this, so the same options always
+			// give the same levels, whatever the number of threads
+			uint32_t seed;
+
+			// Candidates tried for each level, of which the best is kept
+			int tries;
+
+			// Number of each kind of object; there are always
+			// at least one box
+			int min_boxes;
+			int max_boxes;
+			int max_balls;
+
+			// Candidates needing fewer pushes than this are rejected
+			int min_pushes;
+
+			// Positions explored per candidate, at most
+			size_t max_states;
+
+			// Threads to generate on; zero means one per core
+			unsigned int threads;
+
+			// Levels are named this, followed by their number
+			std::string name;
+		};
+
+		// A level made from a candidate, with what it was scored on
+		struct Result
+		{
+			Level level;
+			uint32_t pushes;
+			double branching;
+			double score;
+		};
+
+		Generator(const Xsb::Tiles &tiles, uint8_t first_floor_tile,
+			uint8_t first_cross_tile, const Options &o);
+
+		// Make a candidate from the given seed, returning false if
+		// it was rejected.  Candidates are scored by the number of
+		// pushes in the shortest solution, times the mean number of
+		// pushes open to the player at each step along it which don't
+		// leave a box in a corner.  The level's name, bonus and name
+		// colour are left for the caller.
+		bool make(uint32_t seed, Result &r);
+
+		// Generate levels and write them into an extended level set,
+		// drawn with the tiles, sprites and title screen of the style
+		// set, trying candidates in parallel across all cores.  Writes
+		// a line of results per level; returns the number of levels
+		// for which no candidate was accepted, or -1 if the pack
+		// couldn't be written.
+		static int generate(const LevelSet &style, const Options &o,
+			const std::string &pack, std::ostream &out);
+
+	private:
+		// Random number in [0, n)
+		int random(int n)
+		{
+			return (int)(m_random() % (uint32_t)n);
+		};
+
+		// Carve a connected room out of solid wall
+		void carve(Level &l);
+
+		Xsb::Tiles m_tiles;
+		uint8_t m_first_floor_tile;
+		uint8_t m_first_cross_tile;
+		Options m_options;
+		std::mt19937 m_random;
+		Search m_search;
+};
+
+#endif
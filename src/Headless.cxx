@@ -0,0 +1,405 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+
+// System
+
+// Library
+#include <SDL.h>
+
+// Local
+#include "Headless.hxx"
+#include "MemoryBackend.hxx"
+#include "Display.hxx"
+#include "MainMenu.hxx"
+#include "Credits.hxx"
+#include "PasswordEntry.hxx"
+#include "InGame.hxx"
+#include "Transition.hxx"
+#include "AllocStats.hxx"
+#include "Xsb.hxx"
+
+//
+// Implementation
+//
+
+// Golden sequences are played at this frame rate
+#define GOLDEN_FPS 60
+
+// Frames to play of each level
+#define GOLDEN_LEVEL_FRAMES 240
+
+// Frames to let each level settle before checking it doesn't allocate
+#define ALLOC_CHECK_WARMUP_FRAMES 30
+
+// Size of the level the allocation check scrolls around
+#define SCROLL_LEVEL_WIDTH 60
+#define SCROLL_LEVEL_HEIGHT 30
+
+// Largest size of level thumbnails
+#define THUMBNAIL_WIDTH 160
+#define THUMBNAIL_HEIGHT 96
+
+// Keys to hold down on a given frame of a golden sequence
+typedef void (*GoldenScript)(int frame, Uint8 *keys);
+
+static void noKeys(int frame, Uint8 *keys)
+{}
+
+// Move down the menu every third of a second
+static void menuKeys(int frame, Uint8 *keys)
+{
+	if ((frame % 20) == 10)
+		keys[SDLK_DOWN] = 1;
+}
+
+// Type a letter every sixth of a second
+static void passwordKeys(int frame, Uint8 *keys)
+{
+	if ((frame % 10) == 5)
+		keys[SDLK_a + ((frame / 10) % 26)] = 1;
+}
+
+// Hold each direction in turn for half a second,
+// leaving every third half second idle
+static void levelKeys(int frame, Uint8 *keys)
+{
+	static const SDLKey directions[4] = {
+		SDLK_UP, SDLK_RIGHT, SDLK_DOWN, SDLK_LEFT
+	};
+	int step = frame / (GOLDEN_FPS / 2);
+	if ((step % 3) != 2)
+		keys[directions[(step + (step / 4)) % 4]] = 1;
+}
+
+static uint32_t foldHash(uint32_t h, uint32_t v)
+{
+	return (h ^ v) * 16777619u;
+}
+
+// Play up to the given number of frames of a game loop, stopping early
+// if it wants to be swapped out.  Returns the hash of all frames drawn,
+// and adds the number drawn to played.
+static uint32_t play(GameLoop &g, int frames, GoldenScript script,
+	RenderQueue &queue, MemoryBackend &backend, int &played)
+{
+	Uint8 keys[SDLK_LAST];
+	uint32_t h = 2166136261u;
+	for (int i = 0; i < frames; ++i)
+	{
+		memset(keys, 0, sizeof(keys));
+		script(i, keys);
+		bool keep = g.update(i ? (1.0f / GOLDEN_FPS) : 0.0f, keys, queue);
+		queue.flush(backend);
+		h = foldHash(h, backend.hash());
+		++played;
+		if (!keep)
+			break;
+	}
+	return h;
+}
+
+// Copy of the last frame drawn, for the transition
+static SDL_Surface *copyFrame(const MemoryBackend &backend)
+{
+	SDL_Surface *s = Display::createFrameSurface();
+	SDL_BlitSurface(backend.surface(), NULL, s, NULL);
+	return s;
+}
+
+static void printHash(std::ostream &out, const std::string &name, uint32_t h)
+{
+	char hex[9];
+	sprintf(hex, "%08x", h);
+	out << name << ' ' << hex << std::endl;
+}
+
+int Headless::renderGolden(const Alphabet &a, const LevelSet &l,
+	std::ostream &out)
+{
+	SDL_Surface *frame = Display::frame();
+	RenderQueue queue(frame->w, frame->h);
+	MemoryBackend backend(frame->w, frame->h);
+	int played = 0;
+
+	{
+		MainMenu g(a, l);
+		printHash(out, "main-menu",
+			play(g, GOLDEN_FPS * 2, menuKeys, queue, backend, played));
+	}
+	{
+		Credits g(a, l);
+		printHash(out, "credits",
+			play(g, 2, noKeys, queue, backend, played));
+	}
+	{
+		PasswordEntry g(a, l);
+		printHash(out, "password",
+			play(g, GOLDEN_FPS, passwordKeys, queue, backend, played));
+	}
+
+	for (size_t i = 0; i < l.size(); ++i)
+	{
+		InGame g(a, l, i);
+		char name[16];
+		sprintf(name, "level-%03u", (unsigned int)i);
+		printHash(out, name, play(g, GOLDEN_LEVEL_FRAMES, levelKeys, queue,
+			backend, played));
+	}
+
+	// From the main menu into the first level, as when starting a game
+	SDL_Surface *old_frame;
+	SDL_Surface *new_frame;
+	{
+		MainMenu g(a, l);
+		play(g, 1, noKeys, queue, backend, played);
+		old_frame = copyFrame(backend);
+	}
+	{
+		InGame g(a, l, 0);
+		play(g, 1, noKeys, queue, backend, played);
+		new_frame = copyFrame(backend);
+	}
+	Transition t(old_frame, new_frame);
+	uint32_t h = 2166136261u;
+	for (float elapsed = 0.0f; t.update(elapsed, queue);
+		elapsed = 1.0f / GOLDEN_FPS)
+	{
+		queue.flush(backend);
+		h = foldHash(h, backend.hash());
+		++played;
+	}
+	printHash(out, "transition", h);
+
+	return played;
+}
+
+// Play a level as renderGolden does, counting allocations and surfaces
+// created once it has had time to settle
+static AllocCounts countAllocations(const Alphabet &a, const LevelSet &l,
+	int level, RenderQueue &queue, MemoryBackend &backend, int &frames)
+{
+	Uint8 keys[SDLK_LAST];
+	InGame g(a, l, level);
+	AllocCounts start = AllocStats::totals();
+	int f;
+	for (f = 0; f < GOLDEN_LEVEL_FRAMES; ++f)
+	{
+		if (f == ALLOC_CHECK_WARMUP_FRAMES)
+			start = AllocStats::totals();
+		memset(keys, 0, sizeof(keys));
+		levelKeys(f, keys);
+		bool keep = g.update(f ? (1.0f / GOLDEN_FPS) : 0.0f, keys, queue);
+		queue.flush(backend);
+		if (!keep)
+			break;
+	}
+	frames = std::max(f - ALLOC_CHECK_WARMUP_FRAMES, 0);
+	return AllocStats::totals() - start;
+}
+
+// A walled level much bigger than the frame in the given set's style.
+// The player starts just left of a boundary between the view's chunks
+// and levelKeys moves right after the warm-up, so the view has to draw
+// chunks it has not drawn before while the allocations are counted.
+static void scrollingLevel(const LevelSet &style, Level &lv)
+{
+	Xsb::Tiles tiles = Xsb::chooseTiles(style);
+	lv.name = "Scrolling";
+	lv.bonus = 1000;
+	memset(lv.name_colour, 255, 3);
+	lv.width = SCROLL_LEVEL_WIDTH;
+	lv.height = SCROLL_LEVEL_HEIGHT;
+	lv.tilemap.assign(lv.width * lv.height, tiles.floor);
+	for (int x = 0; x < lv.width; ++x)
+	{
+		lv.tilemap[x] = tiles.wall;
+		lv.tilemap[((lv.height - 1) * lv.width) + x] = tiles.wall;
+	}
+	for (int y = 0; y < lv.height; ++y)
+	{
+		lv.tilemap[y * lv.width] = tiles.wall;
+		lv.tilemap[(y * lv.width) + lv.width - 1] = tiles.wall;
+	}
+
+	// Player, then a box away from where the keys go, and its cross
+	lv.num_sprites = 2;
+	lv.spriteinfo[0].x = 37;
+	lv.spriteinfo[0].y = 10;
+	lv.spriteinfo[0].index = 0;
+	lv.spriteinfo[1].x = 10;
+	lv.spriteinfo[1].y = 25;
+	lv.spriteinfo[1].index = 1;
+	lv.tilemap[(25 * lv.width) + 12] = tiles.cross;
+}
+
+int Headless::checkAllocations(const Alphabet &a, const LevelSet &l,
+	std::ostream &out)
+{
+	if (!AllocStats::enabled())
+	{
+		out << "Allocation check: not counted in this build"
+			" (configure with --enable-alloc-stats)" << std::endl;
+		return 1;
+	}
+
+	SDL_Surface *frame = Display::frame();
+	RenderQueue queue(frame->w, frame->h);
+	MemoryBackend backend(frame->w, frame->h);
+	int failures = 0;
+
+	// The bundled levels all fit in the frame, so also play one which
+	// scrolls, written out and loaded back like any other level
+	std::stringstream pack;
+	Level big;
+	scrollingLevel(l, big);
+	LevelSet::writeHeader(pack, l, 1);
+	LevelSet::writeLevel(pack, big);
+	LevelSet scroll(pack);
+
+	// With a screen, this is done on setting the video mode
+	l.prepareSprites(backend.surface()->format);
+	scroll.prepareSprites(backend.surface()->format);
+	for (size_t i = 0; i <= l.size(); ++i)
+	{
+		bool scrolling = (i == l.size());
+		int frames;
+		AllocCounts d = countAllocations(a, scrolling ? scroll : l,
+			scrolling ? 0 : i, queue, backend, frames);
+		if (d.news || d.surfaces)
+		{
+			if (scrolling)
+				out << "Scrolling level: ";
+			else
+				out << "Level " << i << ": ";
+			out << d.news << " allocations and " << d.surfaces
+				<< " surfaces in " << frames << " frames of play" << std::endl;
+			++failures;
+		}
+	}
+
+	out << "Allocation check: " << l.size() << " levels and one scrolling "
+		"level, " << (GOLDEN_LEVEL_FRAMES - ALLOC_CHECK_WARMUP_FRAMES)
+		<< " frames each after " << ALLOC_CHECK_WARMUP_FRAMES << ": "
+		<< (failures ? "FAILED" : "OK") << std::endl;
+	return failures;
+}
+
+// Draw the level in bands the height of the frame, so that big levels
+// don't need one huge buffer, adding each pixel into the sum for the
+// thumbnail pixel it falls in
+static bool writeThumbnail(const LevelSet &l, int level,
+	const std::string &filename)
+{
+	const Level &lv = l[level];
+	int width = lv.width * P2_TILE_WIDTH;
+	int height = lv.height * P2_TILE_HEIGHT;
+
+	// Shrink by a whole factor, averaging each square of that many pixels
+	int factor = std::max(
+		(width + THUMBNAIL_WIDTH - 1) / THUMBNAIL_WIDTH,
+		(height + THUMBNAIL_HEIGHT - 1) / THUMBNAIL_HEIGHT
+	);
+	int thumb_width = (width + factor - 1) / factor;
+	int thumb_height = (height + factor - 1) / factor;
+	std::vector<uint32_t> sums(thumb_width * thumb_height * 3, 0);
+	std::vector<uint32_t> counts(thumb_width * thumb_height, 0);
+
+	int band = std::min(height, Display::frame()->h);
+	RenderQueue queue(width, band);
+	MemoryBackend backend(width, band);
+	LevelView view(lv, l.getTiles(), width, band);
+	Simulation sim(l, level);
+	for (int top = 0; top < height; top += band)
+	{
+		// The last band may be moved up to stay within the level
+		view.centreOn(width / 2, top + (band / 2));
+		view.render(queue);
+		sim.render(queue, view.originX(), view.originY());
+		queue.flush(backend);
+
+		for (int r = 0; r < band; ++r)
+		{
+			int y = view.originY() + r;
+			if (y < top || y >= (top + band) || y >= height)
+				continue;
+			const uint32_t *row = backend.pixels() + (r * width);
+			for (int x = 0; x < width; ++x)
+			{
+				int t = ((y / factor) * thumb_width) + (x / factor);
+				sums[(t * 3)] += (row[x] >> 16) & 0xff;
+				sums[(t * 3) + 1] += (row[x] >> 8) & 0xff;
+				sums[(t * 3) + 2] += row[x] & 0xff;
+				++counts[t];
+			}
+		}
+	}
+
+	std::vector<uint32_t> thumb(thumb_width * thumb_height);
+	for (size_t t = 0; t < thumb.size(); ++t)
+	{
+		uint32_t n = std::max(counts[t], 1u);
+		thumb[t] = ((sums[(t * 3)] / n) << 16)
+			| ((sums[(t * 3) + 1] / n) << 8)
+			| (sums[(t * 3) + 2] / n);
+	}
+
+	SDL_Surface *s = SDL_CreateRGBSurfaceFrom(&(thumb[0]), thumb_width,
+		thumb_height, 32, thumb_width * 4,
+		0x00ff0000, 0x0000ff00, 0x000000ff, 0);
+	if (!s)
+		return false;
+	bool saved = (SDL_SaveBMP(s, filename.c_str()) == 0);
+	SDL_FreeSurface(s);
+	return saved;
+}
+
+int Headless::writeThumbnails(const LevelSet &l, const std::string &dir,
+	std::ostream &out)
+{
+	int failures = 0;
+	for (size_t i = 0; i < l.size(); ++i)
+	{
+		char name[32];
+		sprintf(name, "/level-%03u.bmp", (unsigned int)i);
+		std::string filename(dir + name);
+		if (!writeThumbnail(l, i, filename))
+		{
+			out << "Could not save \"" << filename << "\": " << SDL_GetError()
+				<< std::endl;
+			++failures;
+		}
+	}
+	return failures;
+}
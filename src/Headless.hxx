@@ -0,0 +1,56 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HXX_HEADLESS
+#define HXX_HEADLESS
+
+#include <string>
+#include <iostream>
+
+class Alphabet;
+class LevelSet;
+
+// Rendering without a display, into a MemoryBackend.  Display must
+// have been set up with Display::setHeadless() first.
+namespace Headless
+{
+	// Play a fixed script of input through the menus, every level and
+	// the transition wipe, writing a hash of each sequence's frames, one
+	// per line.  Any change in what is drawn changes the hashes, so the
+	// output can be kept and compared between builds.
+	// Returns the number of frames rendered.
+	int renderGolden(const Alphabet &a, const LevelSet &l,
+		std::ostream &out);
+
+	// Save a picture of each level's starting position, shrunk to fit
+	// within 160*96 pixels, as a BMP in the given directory.  Returns
+	// the number of levels which couldn't be saved, having written a
+	// line about each.
+	int writeThumbnails(const LevelSet &l, const std::string &dir,
+		std::ostream &out);
+
+	// Play every level as for renderGolden(), and once each has got
+	// going, check that no frame allocates memory or creates surfaces.
+	// Needs a build with allocation counting (see AllocStats.hxx).
+	// Writes a line about each level which allocates, then a summary;
+	// returns the number of such levels.
+	int checkAllocations(const Alphabet &a, const LevelSet &l,
+		std::ostream &out);
+}
+
+#endif
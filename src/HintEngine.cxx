@@ -0,0 +1,153 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+
+// System
+
+// Library
+
+// Local
+#include "HintEngine.hxx"
+
+//
+// Implementation
+//
+
+// Length of each background search slice between requests, and the
+// most slices given to one search, so that a position which is never
+// solved doesn't keep a core busy until the solver runs out of nodes
+#define BACKGROUND_SLICE_MS 20
+#define BACKGROUND_MAX_SLICES 25
+
+HintEngine::HintEngine(const Board &b, unsigned int budget_ms)
+	: m_board(b), m_solver(b), m_budget(budget_ms), m_pending(false),
+	  m_background_slices(0), m_woken(false), m_quit(false)
+{
+	// Start the thread last, once everything it uses exists
+	m_thread = std::thread(&HintEngine::run, this);
+}
+
+HintEngine::~HintEngine()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_idle_mutex);
+		m_quit.store(true);
+		m_woken = true;
+	}
+	m_wake.notify_one();
+	m_thread.join();
+}
+
+bool HintEngine::request(const Board::State &s)
+{
+	if (m_pending || !m_requests.put(s))
+		return false;
+
+	m_pending = true;
+
+	// Only held for as long as it takes the worker to start waiting
+	// or to see the flag, so this never waits for the search
+	std::lock_guard<std::mutex> lock(m_idle_mutex);
+	m_woken = true;
+	m_wake.notify_one();
+	return true;
+}
+
+bool HintEngine::poll(Hint &h)
+{
+	if (!m_pending || !m_results.take(h))
+		return false;
+
+	m_pending = false;
+	return true;
+}
+
+void HintEngine::run()
+{
+	while (!m_quit.load())
+	{
+		Board::State s;
+		if (m_requests.take(s))
+		{
+			m_solver.setRoot(s);
+			m_background_slices = 0;
+			Solver::Status status = m_solver.search(
+				Solver::Clock::now() + m_budget);
+
+			Hint h;
+			h.complete = (status == Solver::Solved);
+			if (status == Solver::Solved && m_solver.solutionLength() == 0)
+				h.result = Hint::AlreadySolved;
+			else if (m_solver.firstPush(h.push))
+			{
+				h.result = Hint::PushNext;
+
+				// Player stands on the opposite side of the object
+				// to the direction of the push
+				Direction back = Left;
+				switch (h.push.dir)
+				{
+					case Left:
+						back = Right;
+						break;
+					case Right:
+						back = Left;
+						break;
+					case Up:
+						back = Down;
+						break;
+					case Down:
+						back = Up;
+				}
+				h.stand = m_board.neighbour(h.push.square, back);
+			}
+			else if (status == Solver::Unsolvable)
+				h.result = Hint::NoSolution;
+			else
+				h.result = Hint::NotFound;
+
+			// There is only ever one request in flight,
+			// so the result slot is always free here
+			m_results.put(h);
+		}
+		else if (m_solver.status() == Solver::Searching
+			&& m_background_slices < BACKGROUND_MAX_SLICES)
+		{
+			// Nothing asked of us, but the last search didn't finish.
+			// Keep growing its tree in case the same position comes back.
+			m_solver.search(Solver::Clock::now()
+				+ std::chrono::milliseconds(BACKGROUND_SLICE_MS));
+			++m_background_slices;
+		}
+		else
+		{
+			std::unique_lock<std::mutex> lock(m_idle_mutex);
+			m_wake.wait(lock, [this] { return m_woken; });
+			m_woken = false;
+		}
+	}
+}
@@ -0,0 +1,100 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HXX_HINTENGINE
+#define HXX_HINTENGINE
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "Solver.hxx"
+#include "SpscSlot.hxx"
+
+// Result of a hint search
+struct Hint
+{
+	enum Result
+	{
+		// Push the object on push.square in direction push.dir,
+		// standing on square stand to do it
+		PushNext,
+		// Every object is already on a cross
+		AlreadySolved,
+		// Nothing can be done from here - time to retry
+		NoSolution,
+		// The search ran out of time or room before finding anything
+		// worth suggesting; there may still be a way forward
+		NotFound
+	};
+
+	Result result;
+	Solver::Push push;
+	uint16_t stand;
+
+	// True if the push is part of a full solution, false if it is
+	// only the most promising move found within the time budget
+	bool complete;
+};
+
+// Runs a Solver on a worker thread.  Positions go in, and hints come
+// out, through lock-free slots, so neither request() nor poll() ever
+// waits for the search.  Each request is answered within the time
+// budget; between requests, an unfinished search carries on growing
+// its tree for a while, so that the next hint is more likely to be
+// complete.
+class HintEngine
+{
+	public:
+		HintEngine(const Board &b, unsigned int budget_ms = 80);
+		~HintEngine();
+
+		// Ask for a hint from the given position.  Returns false if a
+		// request is already in flight.
+		bool request(const Board::State &s);
+
+		// Collect the answer to the last request, if it is ready
+		bool poll(Hint &h);
+
+	private:
+		void run();
+
+		const Board &m_board;
+		Solver m_solver;
+		std::chrono::milliseconds m_budget;
+
+		SpscSlot<Board::State> m_requests;
+		SpscSlot<Hint> m_results;
+		bool m_pending;
+
+		// Background slices spent on the search since the last request
+		int m_background_slices;
+
+		// Only used to put the worker to sleep when it has nothing
+		// to do.  m_woken is set, under the mutex, whenever there is
+		// something for it; the main thread takes the mutex just long
+		// enough to do that.
+		std::mutex m_idle_mutex;
+		std::condition_variable m_wake;
+		bool m_woken;
+		std::atomic<bool> m_quit;
+
+		std::thread m_thread;
+};
+
+#endif
@@ -27,6 +27,7 @@
 // Language
 #include <sstream>
 #include <cmath>
+#include <cstdio>
 
 // System
 
@@ -37,154 +38,263 @@
 #include "PauseMenu.hxx"
 #include "Score.hxx"
 #include "MainMenu.hxx"
+#include "Replay.hxx"
+#include "Display.hxx"
 
 
 //
 // Implementation
 //
 
-#define BONUS_COUNTER_RATE 9.05f
+// Time between steps back while rewinding, in milliseconds
+#define REWIND_STEP_MS 125
 
 InGame::InGame(const Alphabet &a, const LevelSet &l, int level, uint32_t score)
 	: GameLoop(a, l), m_level(level), m_score(score), m_advance(false),
-	  m_player(NULL), m_name_surf(NULL), m_background_surf(NULL),
-	  m_score_surf(NULL), m_int_bonus_counter(-1), m_bonus_surf(NULL)
+	  m_sim(l, level), m_rewind(m_sim), m_rewinding(false), m_rewind_ms(0),
+	  m_view(LevelView::recent(l[level], l.getTiles(), Display::frame()->w,
+		Display::frame()->h)),
+	  m_name_surf(NULL),
+	  m_score_surf(NULL),
+	  m_board(l[level], l.firstFloorTile(), l.firstCrossTile()),
+	  m_show_hint(false), m_hint_key_down(false)
 {
+	for (int i = 0; i < 10; ++i)
+		m_digit_surfs[i] = NULL;
+	renderText();
+
+	// Start recording, if the session is being recorded
+	m_run.level = level;
+	m_run.pack_hash = l.hash();
+	m_run.tick_rate = P2_TICK_RATE;
+	m_run.start_score = score;
+	m_run.final_score = score;
+	m_run.completed = false;
+	if (Replay::output)
+		m_run.inputs.reserve(1024);
+}
+
+void InGame::renderText()
+{
+	if (m_name_surf)
+		SDL_FreeSurface(m_name_surf);
+	if (m_score_surf)
+		SDL_FreeSurface(m_score_surf);
+	for (int i = 0; i < 10; ++i)
+	{
+		if (m_digit_surfs[i])
+			SDL_FreeSurface(m_digit_surfs[i]);
+	}
+
 	// Render level name into a surface
-	m_name_surf = a.renderWord(l[level].name,
-		l[level].name_colour[0],
-		l[level].name_colour[1],
-		l[level].name_colour[2]);
+	const Level &l = m_levelset[m_level];
+	m_name_surf = m_alphabet.renderWord(l.name,
+		l.name_colour[0],
+		l.name_colour[1],
+		l.name_colour[2]);
 
 	// Render current score into a surface
 	std::ostringstream score_str;
 	score_str << m_score;
-	m_score_surf = a.renderWord(score_str.str(), 215, 215, 215);
+	m_score_surf = m_alphabet.renderWord(score_str.str(), 215, 215, 215);
 
-	// Set initial value of bonus counter
-	m_bonus_counter = l[level].bonus;
-
-	// Create the game objects for the current level,
-	// placing them in the array representing the squares.
-	m_objects.reserve(l[level].num_sprites);
-	memset(m_object_array, 0, sizeof(m_object_array));
-	for (uint8_t i = 0; i < l[level].num_sprites; ++i)
+	// RGB values based on colours from a screenshot
+	for (int i = 0; i < 10; ++i)
 	{
-		const SpriteInfo *s = &(l[level].spriteinfo[i]);
-		GameObject **o = &(m_object_array[(s->y * P2_LEVEL_WIDTH) + s->x]);
-		switch (s->index)
-		{
-			case 0:
-				*o = new Player(&(l.getPlayerSprites()),
-					l[level].tilemap, s->x, s->y, m_object_array,
-					l.firstFloorTile(), l.firstCrossTile(), m_objects_left);
-				m_player = (Player*) *o;
-				break;
-			case 1:
-				*o = new Box(&(l.getSprites()),
-					l[level].tilemap, s->x, s->y, m_object_array,
-					l.firstFloorTile(), l.firstCrossTile(), m_objects_left);
-				break;
-			case 2:
-				*o = new Ball(&(l.getSprites()),
-					l[level].tilemap, s->x, s->y, m_object_array,
-					l.firstFloorTile(), l.firstCrossTile(), m_objects_left);
-		}
-		m_objects.emplace_back(*o);
+		m_digit_surfs[i] = m_alphabet.renderWord(std::string(1, '0' + i),
+			62, 253, 231);
 	}
+}
 
-	// Set the number of objects in the current level,
-	// for keeping track of when the level is completed.
-	// One object is the player.
-	m_objects_left = l[level].num_sprites - 1;
-
-	// Create pre-rendered surface containing game background
-	const uint8_t *tilemap = m_levelset[m_level].tilemap;
-	m_background_surf = SDL_DisplayFormat(SDL_GetVideoSurface());
-	for (int y = 0; y < P2_LEVEL_HEIGHT; ++y)
+std::shared_ptr<GameLoop> InGame::reload(unsigned assets)
+{
+	// Game objects, the board and the recording are all built from
+	// the level, so an edited level is started again from scratch.
+	// Tiles and sprites are picked up as they are drawn.
+	if (assets & P2_ASSET_LEVELS)
 	{
-		for (int x = 0; x < P2_LEVEL_WIDTH; ++x)
-		{
-			SDL_Rect rect = {
-				(Sint16)(x * P2_TILE_WIDTH),
-				(Sint16)(y * P2_TILE_HEIGHT),
-				0, 0
-			};
-			SDL_BlitSurface(m_tileset[tilemap[(y * P2_LEVEL_WIDTH) + x]],
-				NULL, m_background_surf, &rect);
-		}
+		return std::shared_ptr<GameLoop>(new InGame(m_alphabet, m_levelset,
+			m_level, m_run.start_score));
 	}
+	if (assets & P2_ASSET_GLYPHS)
+		renderText();
+	return shared_from_this();
 }
 
-bool InGame::update(float elapsed, const Uint8 *kbdstate, SDL_Surface *screen)
+bool InGame::update(float elapsed, const Uint8 *kbdstate, RenderQueue &queue)
 {
 	// Handle keypresses separately
 	// (we don't care about explicit presses/releases,
 	// just which keys are being held down)
+	int direction = -1;
 	if (kbdstate[SDLK_UP])
-		m_player->move(Up);
+		direction = Up;
 	else if (kbdstate[SDLK_DOWN])
-		m_player->move(Down);
+		direction = Down;
 	else if (kbdstate[SDLK_LEFT])
-		m_player->move(Left);
+		direction = Left;
 	else if (kbdstate[SDLK_RIGHT])
-		m_player->move(Right);
+		direction = Right;
 
 	// Pause when escape is pressed or app loses focus
-	if (kbdstate[SDLK_ESCAPE] || !(SDL_GetAppState() & SDL_APPINPUTFOCUS))
+	// (if there is an app window to lose focus at all)
+	if (kbdstate[SDLK_ESCAPE]
+		|| (Display::screen() && !(SDL_GetAppState() & SDL_APPINPUTFOCUS)))
 		return false;
 
-	// Render background & game objects
-	SDL_BlitSurface(m_background_surf, NULL, screen, NULL);
-	for (auto i = m_objects.cbegin(); i != m_objects.cend(); ++i)
+	// While Backspace is held, wind back a move at a time instead
+	// of playing, cutting the recording back to match.  The first
+	// step happens as soon as it is pressed.
+	// Otherwise, advance the simulation by however many ticks are due.
+	// The frame time is converted back into the whole milliseconds
+	// main() measured, so that no float rounding gets into the game.
+	uint32_t elapsed_ms = (uint32_t)lroundf(elapsed * 1000.0f);
+	if (kbdstate[SDLK_BACKSPACE])
 	{
-		(*i)->render(screen, elapsed);
+		if (!m_rewinding)
+		{
+			m_rewinding = true;
+			m_rewind_ms = REWIND_STEP_MS;
+		}
+		else
+			m_rewind_ms += elapsed_ms;
+		for (; m_rewind_ms >= REWIND_STEP_MS; m_rewind_ms -= REWIND_STEP_MS)
+		{
+			if (m_rewind.step(m_sim) && Replay::output)
+				Replay::truncate(m_run, m_sim.ticks());
+		}
 	}
-
-	// Render level name & score
-	SDL_Rect rect = {
-		50, 320, 0, 0
-	};
-	SDL_BlitSurface(m_name_surf, NULL, screen, &rect);
-	rect.x = (screen->w - 50) - m_score_surf->w;
-	rect.y = 320; rect.w = 0; rect.h = 0;
-	SDL_BlitSurface(m_score_surf, NULL, screen, &rect);
-
-	// Render current bonus counter value
-	// RGB values based on colours from a screenshot
-	if (m_int_bonus_counter)
+	else
 	{
-		m_bonus_counter -= BONUS_COUNTER_RATE * elapsed;
-		if (m_int_bonus_counter != (int) floorf(m_bonus_counter))
+		m_rewinding = false;
+		int due = m_sim.ticksDue(elapsed_ms);
+		for (int i = 0; i < due && !m_sim.complete(); ++i)
 		{
-			m_int_bonus_counter = (int) floorf(m_bonus_counter);
+			m_sim.tick(direction);
+			m_rewind.record(m_sim);
+			if (Replay::output)
+				Replay::record(m_run, direction);
+		}
+	}
 
-			std::ostringstream bonus_str;
-			bonus_str << m_int_bonus_counter;
+	// Ask for a hint when H is pressed.  The search runs in the
+	// background; we just pick up the answer on a later frame.
+	Board::State current(m_sim.snapshot(m_board));
+	if (kbdstate[SDLK_h] && !m_hint_key_down)
+	{
+		if (!m_hints)
+			m_hints.reset(new HintEngine(m_board));
+		if (m_hints->request(current))
+			m_hint_state = current;
+	}
+	m_hint_key_down = kbdstate[SDLK_h];
 
-			if (m_bonus_surf)
-				SDL_FreeSurface(m_bonus_surf);
+	Hint h;
+	if (m_hints && m_hints->poll(h))
+	{
+		m_hint = h;
+		m_show_hint = true;
+	}
+	if (m_show_hint && current != m_hint_state)
+		m_show_hint = false;
+
+	// Render background & game objects, following the player
+	int player_x, player_y;
+	m_sim.playerPosition(player_x, player_y);
+	m_view->centreOn(player_x + (P2_TILE_WIDTH / 2),
+		player_y + (P2_TILE_HEIGHT / 2));
+	m_view->render(queue);
+	m_sim.render(queue, m_view->originX(), m_view->originY());
 
-			m_bonus_surf = m_alphabet.renderWord(bonus_str.str(),
-				62, 253, 231);
+	// Highlight the object to push next, and where to push it from,
+	// or the player if there's no way forward from here.  Nothing is
+	// shown if the search didn't get far enough to say either way.
+	if (m_show_hint)
+	{
+		if (m_hint.result == Hint::PushNext)
+		{
+			highlight(queue, m_hint.push.square, 0, 255, 255, 0);
+			highlight(queue, m_hint.stand, 8, 62, 253, 231);
+		}
+		else if (m_hint.result == Hint::NoSolution)
+		{
+			highlight(queue, m_hint_state.player, 0, 255, 0, 0);
 		}
 	}
 
-	rect.x = 448; rect.y = 4; rect.w = 0; rect.h = 0;
-	SDL_BlitSurface(m_bonus_surf, NULL, screen, &rect);
+	// Render level name & score
+	queue.blit(RenderQueue::Text, m_name_surf, NULL, 50, 320);
+	queue.blit(RenderQueue::Text, m_score_surf, NULL,
+		(queue.width() - 50) - m_score_surf->w, 320);
+
+	// Render current bonus counter value, a digit at a time.
+	// Digits don't overlap, so the order they're drawn in doesn't matter.
+	char bonus[16];
+	snprintf(bonus, sizeof(bonus), "%d", m_sim.bonus());
+	int x = 448;
+	for (const char *c = bonus; *c; ++c)
+	{
+		queue.blit(RenderQueue::Text, m_digit_surfs[*c - '0'], NULL, x, 4);
+		x += m_alphabet.advance(*c);
+	}
 
-	if (m_objects_left)
+	if (!m_sim.complete())
 		return true;
 	else
 	{
-		m_score += m_int_bonus_counter;
+		m_score += m_sim.bonus();
 		if (m_score > Score::high)
 			Score::high = m_score;
 		m_advance = true;
+
+		if (Replay::output)
+		{
+			m_run.completed = true;
+			m_run.final_score = m_score;
+			Replay::writeRun(*Replay::output, m_run);
+		}
 		return false;
 	}
 }
 
+void InGame::reset()
+{
+	// Record the abandoned attempt, then start a new one
+	if (Replay::output && !m_advance)
+		Replay::writeRun(*Replay::output, m_run);
+	m_run.inputs.clear();
+	m_run.final_score = m_run.start_score;
+	m_run.completed = false;
+
+	m_sim.reset();
+	m_rewind.reset(m_sim);
+	m_rewinding = false;
+	m_score = m_run.start_score;
+	m_advance = false;
+	m_show_hint = false;
+	m_hint_key_down = false;
+}
+
+void InGame::highlight(RenderQueue &queue, int square, int inset,
+	uint8_t r, uint8_t g, uint8_t b) const
+{
+	int width = m_board.width();
+	Sint16 x = ((square % width) * P2_TILE_WIDTH) + inset - m_view->originX();
+	Sint16 y = ((square / width) * P2_TILE_HEIGHT) + inset - m_view->originY();
+	Uint16 w = P2_TILE_WIDTH - (inset * 2);
+	Uint16 h = P2_TILE_HEIGHT - (inset * 2);
+
+	// Two pixel outline: top, bottom, left, right
+	SDL_Rect edges[4] = {
+		{ x, y, w, 2 },
+		{ x, (Sint16)(y + h - 2), w, 2 },
+		{ x, y, 2, h },
+		{ (Sint16)(x + w - 2), y, 2, h }
+	};
+	for (int i = 0; i < 4; ++i)
+		queue.fill(RenderQueue::Overlay, &(edges[i]), r, g, b);
+}
+
 std::unique_ptr<GameLoopFactory> InGame::nextLoop()
 {
 	// If we get here, update() must have returned false.
@@ -222,10 +332,14 @@ std::unique_ptr<GameLoopFactory> InGame::nextLoop()
 
 InGame::~InGame()
 {
+	// Record abandoned attempts too (retries, quitting to the menu)
+	if (Replay::output && !m_advance)
+		Replay::writeRun(*Replay::output, m_run);
+
 	SDL_FreeSurface(m_name_surf);
-	SDL_FreeSurface(m_background_surf);
 	SDL_FreeSurface(m_score_surf);
-	SDL_FreeSurface(m_bonus_surf);
+	for (int i = 0; i < 10; ++i)
+		SDL_FreeSurface(m_digit_surfs[i]);
 }
 
 std::shared_ptr<GameLoop> InGameFactory::operator() ()
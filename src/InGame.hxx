@@ -19,7 +19,11 @@
 #define HXX_INGAME
 
 #include "GameLoop.hxx"
-#include "GameObjects.hxx"
+#include "Simulation.hxx"
+#include "HintEngine.hxx"
+#include "Replay.hxx"
+#include "Rewind.hxx"
+#include "LevelView.hxx"
 
 // GameLoop-derived class for main in-level gameplay
 class InGame: public GameLoop
@@ -29,8 +33,14 @@ class InGame: public GameLoop
 			uint32_t score = 0);
 		~InGame();
 
-		bool update(float elapsed, const Uint8 *kbdstate, SDL_Surface *screen);
+		bool update(float elapsed, const Uint8 *kbdstate, RenderQueue &queue);
 		std::unique_ptr<GameLoopFactory> nextLoop();
+		std::shared_ptr<GameLoop> reload(unsigned assets);
+
+		// Start the level again from the beginning, with the score
+		// it was started with.  Everything already built for it is
+		// kept, so this costs next to nothing.
+		void reset();
 
 		int getLevel() const
 		{
@@ -43,34 +53,52 @@ class InGame: public GameLoop
 		};
 
 	private:
+		// Render the level name, score and bonus digits onto surfaces
+		void renderText();
+
+		// Outline a square of the level in the given colour
+		void highlight(RenderQueue &queue, int square, int inset,
+			uint8_t r, uint8_t g, uint8_t b) const;
+
 		int m_level;
 		uint32_t m_score;
-		int m_objects_left;
 		bool m_advance;
 
-		// Array of pointers to game objects, one per square.
-		// Each game object has a pointer to it somewhere in this
-		// array, their positions managed by the GameObjects themselves
-		// as they move around (they contain a pointer to this array).
-		GameObject* m_object_array[P2_LEVEL_WIDTH * P2_LEVEL_HEIGHT];
+		// Game objects and bonus counter
+		Simulation m_sim;
 
-		// Each game object is also stored here, so that they can be
-		// iterated over without having to walk the whole array above,
-		// and so that they get deleted on ~InGame().
-		std::vector<std::unique_ptr<GameObject>> m_objects;
+		// History for winding back while Backspace is held, and
+		// how long until the next step back
+		Rewind m_rewind;
+		bool m_rewinding;
+		uint32_t m_rewind_ms;
 
-		// Just a plain-old pointer because the player is a
-		// GameObject, hence deleted when the above vector
-		// is deleted.
-		Player* m_player;
+		// Level tiles, scrolled to follow the player.  Shared with
+		// LevelView's cache of recently played levels.
+		std::shared_ptr<LevelView> m_view;
 
 		SDL_Surface *m_name_surf;
-		SDL_Surface *m_background_surf;
 		SDL_Surface *m_score_surf;
 
-		float m_bonus_counter;
-		int m_int_bonus_counter;
-		SDL_Surface *m_bonus_surf;
+		// Digits 0-9 for the bonus counter, which changes too often to
+		// render afresh each time without allocating during play
+		SDL_Surface *m_digit_surfs[10];
+
+		// Logical model of the level, and the hint search which runs
+		// over it.  The latter is created on first use, so that levels
+		// played without hints never start a search thread.
+		Board m_board;
+		std::unique_ptr<HintEngine> m_hints;
+
+		// Most recent hint, and the position it applies to.
+		// Hidden as soon as anything moves.
+		Hint m_hint;
+		Board::State m_hint_state;
+		bool m_show_hint;
+		bool m_hint_key_down;
+
+		// Recording of this attempt at the level
+		ReplayRun m_run;
 };
 
 struct InGameFactory: public GameLoopFactory
@@ -28,6 +28,7 @@
 #include <fstream>
 #include <stdexcept>
 #include <cstring>
+#include <algorithm>
 
 // System
 
@@ -35,11 +36,32 @@
 
 // Local
 #include "LevelSet.hxx"
+#include "AssetRegistry.hxx"
+#include "Board.hxx"
 
 //
 // Implementation
 //
 
+// Original level sets are laid out as follows, with all ints 32-bit
+// little endian:
+//
+//   int     number of levels
+//   int     first floor tile; int first cross tile
+//   12 * 3  tile, sprite & player sprite file names
+//   240     title screen tile map (20*12)
+//   then for each level:
+//     12    name, each byte inverted
+//     int   bonus counter start value
+//     4     name colour (RGB, then junk)
+//     240   tile map (20*12)
+//     int   number of sprites; 20 * 3 sprite info (x, y, index)
+//
+// Extended sets start with P2_EXTENDED_SET_MAGIC and an int version, then
+// carry on as above, except that each level also has an int width and an
+// int height before its tile map, which is width*height bytes, and only
+// holds as many sprite infos as there are sprites.
+
 // Endian-independant read of a 32-bit int from a file
 // saved with little-endian ints
 uint32_t readInt(std::istream &s)
@@ -67,12 +89,170 @@ void readString(std::istream &s, char *buffer, bool decrypt = false)
 		*cr = '\0';
 }
 
-LevelSet::LevelSet(const char *filename)
+// Counterparts of the above, for writing level sets out.
+// Strings longer than 12 bytes are cut short.
+void writeInt(std::ostream &s, uint32_t i)
+{
+	unsigned char c[4] = {
+		(unsigned char)(i & 0xff), (unsigned char)((i >> 8) & 0xff),
+		(unsigned char)((i >> 16) & 0xff), (unsigned char)(i >> 24)
+	};
+	s.write((const char*)(c), 4);
+}
+
+void writeString(std::ostream &s, const std::string &str, bool encrypt = false)
+{
+	char buffer[12];
+	memset(buffer, 0, 12);
+	memcpy(buffer, str.data(), std::min<size_t>(str.size(), 12));
+	if (encrypt)
+	{
+		for (int i = 0; i < 12; ++i)
+			buffer[i] = 255 - buffer[i];
+	}
+	s.write(buffer, 12);
+}
+
+void LevelSet::writeHeader(std::ostream &s, const LevelSet &style,
+	uint32_t num_levels)
+{
+	s.write(P2_EXTENDED_SET_MAGIC, 4);
+	writeInt(s, P2_EXTENDED_SET_VERSION);
+	writeInt(s, num_levels);
+	writeInt(s, style.m_first_floor_tile);
+	writeInt(s, style.m_first_cross_tile);
+	writeString(s, style.m_tiles_file);
+	writeString(s, style.m_sprites_file);
+	writeString(s, style.m_playersprites_file);
+	s.write((const char*)(style.m_titlescreen), sizeof(style.m_titlescreen));
+}
+
+void LevelSet::writeLevel(std::ostream &s, const Level &l)
+{
+	writeString(s, l.name, true);
+	writeInt(s, l.bonus);
+	s.write((const char*)(l.name_colour), 3);
+	s.put(0);
+	writeInt(s, l.width);
+	writeInt(s, l.height);
+	s.write((const char*)&(l.tilemap[0]), l.width * l.height);
+	writeInt(s, l.num_sprites);
+	for (uint8_t i = 0; i < l.num_sprites; ++i)
+	{
+		s.put(l.spriteinfo[i].x);
+		s.put(l.spriteinfo[i].y);
+		s.put(l.spriteinfo[i].index);
+	}
+}
+
+void LevelSet::convertToDisplayFormat()
+{
+	if (!hasGraphics())
+		return;
+
+	// Other level sets may have converted the same files already;
+	// if not, they are converted from the sets held here, which are
+	// then freed once nothing else uses them.
+	m_tileset = AssetRegistry::tiles(m_tiles_file.c_str(),
+		P2_TILE_WIDTH, P2_TILE_HEIGHT, false, true);
+	m_spriteset = AssetRegistry::tiles(m_sprites_file.c_str(),
+		P2_TILE_WIDTH, P2_TILE_HEIGHT, true, true);
+	m_playerspriteset = AssetRegistry::tiles(m_playersprites_file.c_str(),
+		P2_TILE_WIDTH, P2_TILE_HEIGHT, true, true);
+}
+
+void LevelSet::prepareSprites(const SDL_PixelFormat *format) const
+{
+	if (!hasGraphics())
+		return;
+	m_spriteset->prepareSprites(format);
+	m_playerspriteset->prepareSprites(format);
+}
+
+bool LevelSet::replaceLevels(const LevelSet &other)
+{
+	if (other.m_levelset.size() != m_levelset.size())
+		return false;
+
+	// Assign level by level, rather than swapping vectors, so that
+	// references to levels stay valid
+	for (size_t i = 0; i < m_levelset.size(); ++i)
+		m_levelset[i] = other.m_levelset[i];
+	memcpy(m_titlescreen, other.m_titlescreen, sizeof(m_titlescreen));
+	m_first_floor_tile = other.m_first_floor_tile;
+	m_first_cross_tile = other.m_first_cross_tile;
+	m_hash = other.m_hash;
+	return true;
+}
+
+void LevelSet::buildCells(Level &l) const
+{
+	// Floor and cross tiles can be moved into.  Anything
+	// outside the level is left as wall.
+	l.cells.assign(l.paddedWidth() * (l.height + 2), 0);
+	for (int y = 0; y < l.height; ++y)
+	{
+		for (int x = 0; x < l.width; ++x)
+		{
+			uint8_t tile = l.tilemap[(y * l.width) + x];
+			uint8_t &cell = l.cells[l.paddedIndex(x, y)];
+			if (tile >= m_first_floor_tile)
+			{
+				cell = P2_CELL_FLOOR;
+				if (tile < m_first_cross_tile)
+					cell |= P2_CELL_CROSS;
+			}
+		}
+	}
+
+	l.strides[Left] = -1;
+	l.strides[Right] = 1;
+	l.strides[Up] = -l.paddedWidth();
+	l.strides[Down] = l.paddedWidth();
+}
+
+LevelSet::LevelSet(const char *filename, bool graphics)
 {
 	// Open level set file
 	std::ifstream setfile;
 	setfile.exceptions(std::ios::badbit | std::ios::failbit | std::ios::eofbit);
 	setfile.open(filename, std::ios_base::binary);
+	load(setfile, graphics);
+}
+
+LevelSet::LevelSet(std::istream &setfile, bool graphics)
+{
+	setfile.exceptions(std::ios::badbit | std::ios::failbit | std::ios::eofbit);
+	load(setfile, graphics);
+}
+
+void LevelSet::load(std::istream &setfile, bool graphics)
+{
+	// Hash the whole file (FNV-1a), then go back to the start
+	m_hash = 2166136261u;
+	char c;
+	setfile.exceptions(std::ios::badbit);
+	while (setfile.get(c))
+	{
+		m_hash ^= (unsigned char)c;
+		m_hash *= 16777619u;
+	}
+	setfile.clear();
+	setfile.exceptions(std::ios::badbit | std::ios::failbit | std::ios::eofbit);
+	setfile.seekg(0);
+
+	// Extended level sets start with a magic number and version;
+	// original ones go straight into the number of levels
+	char magic[4];
+	setfile.read(magic, 4);
+	bool extended = (memcmp(magic, P2_EXTENDED_SET_MAGIC, 4) == 0);
+	if (extended)
+	{
+		if (readInt(setfile) != P2_EXTENDED_SET_VERSION)
+			throw std::runtime_error("Unsupported level set version");
+	}
+	else
+		setfile.seekg(0);
 
 	// Read in number of levels in the set
 	uint32_t num_levels = readInt(setfile);
@@ -89,11 +269,20 @@ LevelSet::LevelSet(const char *filename)
 	// Read in the tile, sprite & player sprite files
 	char strbuff[13];
 	readString(setfile, strbuff);
-	m_tileset.reset(new TileSet(strbuff, P2_TILE_WIDTH, P2_TILE_HEIGHT));
+	m_tiles_file.assign(strbuff);
+	if (graphics)
+		m_tileset = AssetRegistry::tiles(strbuff, P2_TILE_WIDTH, P2_TILE_HEIGHT);
 	readString(setfile, strbuff);
-	m_spriteset.reset(new TileSet(strbuff, P2_TILE_WIDTH, P2_TILE_HEIGHT, true));
+	m_sprites_file.assign(strbuff);
+	if (graphics)
+		m_spriteset = AssetRegistry::tiles(strbuff, P2_TILE_WIDTH, P2_TILE_HEIGHT, true);
 	readString(setfile, strbuff);
-	m_playerspriteset.reset(new TileSet(strbuff, P2_TILE_WIDTH, P2_TILE_HEIGHT, true));
+	m_playersprites_file.assign(strbuff);
+	if (graphics)
+	{
+		m_playerspriteset = AssetRegistry::tiles(strbuff,
+			P2_TILE_WIDTH, P2_TILE_HEIGHT, true);
+	}
 
 	// Read in the title screen tilemap
 	setfile.read((char*)m_titlescreen, P2_LEVEL_HEIGHT * P2_LEVEL_WIDTH);
@@ -114,26 +303,57 @@ LevelSet::LevelSet(const char *filename)
 		setfile.read((char*)(l.name_colour), 3);
 		setfile.seekg(1, std::ios::cur);
 
+		// Extended sets give each level's size; original ones are all 20*12
+		l.width = P2_LEVEL_WIDTH;
+		l.height = P2_LEVEL_HEIGHT;
+		if (extended)
+		{
+			uint32_t width = readInt(setfile);
+			uint32_t height = readInt(setfile);
+			if (width < 1 || width > P2_MAX_LEVEL_WIDTH
+				|| height < 1 || height > P2_MAX_LEVEL_HEIGHT)
+				throw std::runtime_error("Bad level size");
+			l.width = width;
+			l.height = height;
+		}
+
 		// tile map
-		setfile.read((char*)(l.tilemap), P2_LEVEL_HEIGHT * P2_LEVEL_WIDTH);
+		l.tilemap.resize(l.width * l.height);
+		setfile.read((char*)&(l.tilemap[0]), l.width * l.height);
+		buildCells(l);
 
 		// number of sprites
-		l.num_sprites = readInt(setfile);
-		if (l.num_sprites > P2_MAX_SPRITES_PER_LEVEL)
+		uint32_t num_sprites = readInt(setfile);
+		if (num_sprites > P2_MAX_SPRITES_PER_LEVEL)
 			throw std::runtime_error("Too many sprites in level");
-		
-		// Read in sprite info
+		l.num_sprites = num_sprites;
+
+		// Read in sprite info.  Index 0 is the player, of which there
+		// must be exactly one; the others are Board's kinds of piece.
+		int players = 0;
 		for (uint32_t j = 0; j < l.num_sprites; ++j)
 		{
 			setfile.read((char*)&(l.spriteinfo[j].x), 1);
 			setfile.read((char*)&(l.spriteinfo[j].y), 1);
 			setfile.read((char*)&(l.spriteinfo[j].index), 1);
+			if (l.spriteinfo[j].x >= l.width || l.spriteinfo[j].y >= l.height)
+				throw std::runtime_error("Sprite outside level");
+			if (l.spriteinfo[j].index > Board::BallPiece)
+				throw std::runtime_error("Unknown sprite in level");
+			if (l.spriteinfo[j].index == Board::NoPiece)
+				++players;
 		}
+		if (players != 1)
+			throw std::runtime_error("Level needs exactly one player");
 
-		// Skip junk data if we don't have a full sprite info section
-		setfile.seekg(
-			(P2_MAX_SPRITES_PER_LEVEL - l.num_sprites) * 3,
-			std::ios::cur
-		);
+		// Skip junk data if we don't have a full sprite info section.
+		// Extended sets don't store it.
+		if (!extended)
+		{
+			setfile.seekg(
+				(P2_MAX_SPRITES_PER_LEVEL - l.num_sprites) * 3,
+				std::ios::cur
+			);
+		}
 	}
 }
@@ -20,11 +20,17 @@
 
 #include <memory>
 #include <string>
+#include <iosfwd>
+#include <vector>
 #include <cstdint>
 
 #include "TileSet.hxx"
 #include "Constants.hxx"
 
+// Extended level set files start with this, then a version number
+#define P2_EXTENDED_SET_MAGIC "P2LX"
+#define P2_EXTENDED_SET_VERSION 1
+
 // Structure representing one sprite in a level
 struct SpriteInfo
 {
@@ -41,15 +47,45 @@ struct Level
 	unsigned char name_colour[3];
 	uint8_t num_sprites;
 	SpriteInfo spriteinfo[P2_MAX_SPRITES_PER_LEVEL];
-	uint8_t tilemap[P2_LEVEL_HEIGHT * P2_LEVEL_WIDTH];
+
+	// Size in tiles, and tiles row by row
+	int width;
+	int height;
+	std::vector<uint8_t> tilemap;
+
+	// P2_CELL_* flags for each square, with a border of wall all the
+	// way round, so that every square has a neighbour in every direction
+	// and moves never need to check for the edge of the level.
+	// Indexed by paddedIndex(); strides gives the offset between
+	// neighbouring squares in each Direction.
+	std::vector<uint8_t> cells;
+	int strides[4];
+
+	int paddedWidth() const
+	{
+		return width + 2;
+	};
+
+	int paddedIndex(int x, int y) const
+	{
+		return ((y + 1) * (width + 2)) + x + 1;
+	};
 };
 
-// Load in a level set, including the tiles and sprites it requires
-// Every level in the set is assumed to be 20*12 tiles in size
+// Load in a level set, including the tiles and sprites it requires,
+// which are shared with any other level sets using the same ones.
+// Original level sets hold 20*12 levels; extended sets (see LevelSet.cxx)
+// hold levels of any size up to P2_MAX_LEVEL_WIDTH * P2_MAX_LEVEL_HEIGHT.
+// Tools which only need the levels themselves can skip loading the
+// graphics, in which case the tile set accessors must not be used.
 class LevelSet
 {
 	public:
-		LevelSet(const char *filename);
+		LevelSet(const char *filename, bool graphics = true);
+
+		// Load from a stream instead, which must be able to seek back
+		// to the start; read errors are thrown as for files
+		LevelSet(std::istream &s, bool graphics = true);
 
 		const Level &operator[](int index) const
 		{
@@ -61,6 +97,11 @@ class LevelSet
 			return m_levelset.size();
 		};
 
+		bool hasGraphics() const
+		{
+			return (m_tileset.get() != NULL);
+		};
+
 		const TileSet &getTiles() const
 		{
 			return *m_tileset;
@@ -76,6 +117,57 @@ class LevelSet
 			return *m_playerspriteset;
 		};
 
+		// Names of the files the tiles and sprites were loaded from
+		const std::string &getTilesFile() const
+		{
+			return m_tiles_file;
+		};
+
+		const std::string &getSpritesFile() const
+		{
+			return m_sprites_file;
+		};
+
+		const std::string &getPlayerSpritesFile() const
+		{
+			return m_playersprites_file;
+		};
+
+		// Swap in fresh copies of the tiles or sprites, loaded after
+		// their files were edited, for every level set sharing them.
+		// The old ones are left in the arguments.  Sets must not
+		// shrink, or levels might refer to tiles and sprites which no
+		// longer exist.
+		void swapTiles(TileSet &tiles)
+		{
+			m_tileset->swap(tiles);
+		};
+
+		void swapSprites(TileSet &sprites)
+		{
+			m_spriteset->swap(sprites);
+		};
+
+		void swapPlayerSprites(TileSet &sprites)
+		{
+			m_playerspriteset->swap(sprites);
+		};
+
+		// Take on the levels and title screen of a fresh copy of this
+		// set, loaded after its file was edited.  Levels are updated in
+		// place, so references to them stay valid, but anything built
+		// from them must be rebuilt.  Fails, changing nothing, if the
+		// number of levels differs.
+		bool replaceLevels(const LevelSet &other);
+
+		// Convert all tiles and sprites to the screen's pixel
+		// format - see TileSet::convertToDisplayFormat
+		void convertToDisplayFormat();
+
+		// Encode all sprites for the given format up front, for
+		// drawing somewhere other than the screen
+		void prepareSprites(const SDL_PixelFormat *format) const;
+
 		const uint8_t *getTitleScreen() const
 		{
 			return m_titlescreen;
@@ -91,14 +183,43 @@ class LevelSet
 			return m_first_cross_tile;
 		};
 
+		// Write an extended level set a level at a time: a header,
+		// taking its tiles, sprites and title screen from the given set,
+		// then each level.  Level cells are not written; they are built
+		// from the tiles on loading.  The header is always the same
+		// size, so it can be written again with the right number of
+		// levels once they have all been written.
+		static void writeHeader(std::ostream &s, const LevelSet &style,
+			uint32_t num_levels);
+		static void writeLevel(std::ostream &s, const Level &l);
+
+		// Hash of the level set file's contents, for telling
+		// whether replays were recorded against this set
+		uint32_t hash() const
+		{
+			return m_hash;
+		};
+
 	private:
-		std::unique_ptr<TileSet> m_tileset;
-		std::unique_ptr<TileSet> m_spriteset;
-		std::unique_ptr<TileSet> m_playerspriteset;
+		// Read the set from the start of a stream, throwing on errors
+		void load(std::istream &setfile, bool graphics);
+
+		// Fill in a level's cells and strides from its tile map
+		void buildCells(Level &l) const;
+
+		// Shared with other level sets using the same files;
+		// see AssetRegistry
+		std::shared_ptr<TileSet> m_tileset;
+		std::shared_ptr<TileSet> m_spriteset;
+		std::shared_ptr<TileSet> m_playerspriteset;
+		std::string m_tiles_file;
+		std::string m_sprites_file;
+		std::string m_playersprites_file;
 		std::vector<Level> m_levelset;
 		uint8_t m_titlescreen[P2_LEVEL_HEIGHT * P2_LEVEL_WIDTH];
 		uint8_t m_first_floor_tile;
 		uint8_t m_first_cross_tile;
+		uint32_t m_hash;
 };
 
 #endif
@@ -0,0 +1,277 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <algorithm>
+
+// System
+
+// Library
+
+// Local
+#include "LevelView.hxx"
+#include "Display.hxx"
+
+//
+// Implementation
+//
+
+// Width and height of a chunk in tiles, and most chunks kept built at
+// once.  A 640*384 window overlaps at most 4*3 chunks of 256*256 pixels.
+#define CHUNK_TILES 8
+#define MAX_CHUNKS 32
+
+// Most views kept by LevelView::recent()
+#define MAX_RECENT 4
+
+std::list<std::shared_ptr<LevelView>> LevelView::m_recent;
+uint32_t LevelView::m_tiles_generation = 0;
+
+LevelView::LevelView(const Level &level, const TileSet &tiles,
+	int view_width, int view_height)
+	: m_level(level), m_tiles(tiles),
+	  m_view_width(view_width), m_view_height(view_height),
+	  m_origin_x(0), m_origin_y(0),
+	  m_chunks_x((level.width + CHUNK_TILES - 1) / CHUNK_TILES),
+	  m_chunks_y((level.height + CHUNK_TILES - 1) / CHUNK_TILES),
+	  m_chunks(m_chunks_x * m_chunks_y, NULL),
+	  m_last_drawn(m_chunks_x * m_chunks_y, 0),
+	  m_frame(0),
+	  m_bpp(0), m_rmask(0), m_gmask(0), m_bmask(0),
+	  m_generation(m_tiles_generation)
+{
+	centreOn((level.width * P2_TILE_WIDTH) / 2,
+		(level.height * P2_TILE_HEIGHT) / 2);
+	if (Display::frame())
+		allocate();
+}
+
+LevelView::~LevelView()
+{
+	flush();
+}
+
+std::shared_ptr<LevelView> LevelView::recent(const Level &level,
+	const TileSet &tiles, int view_width, int view_height)
+{
+	for (auto i = m_recent.begin(); i != m_recent.end(); ++i)
+	{
+		const LevelView &v = **i;
+		if (&(v.m_level) == &level && &(v.m_tiles) == &tiles
+			&& v.m_view_width == view_width && v.m_view_height == view_height)
+		{
+			m_recent.splice(m_recent.begin(), m_recent, i);
+			return m_recent.front();
+		}
+	}
+
+	m_recent.push_front(std::make_shared<LevelView>(level, tiles,
+		view_width, view_height));
+	if (m_recent.size() > MAX_RECENT)
+		m_recent.pop_back();
+	return m_recent.front();
+}
+
+void LevelView::reloaded(unsigned assets)
+{
+	if (assets & P2_ASSET_TILES)
+		++m_tiles_generation;
+
+	// Views in use carry on until their owners are rebuilt
+	if (assets & P2_ASSET_LEVELS)
+		m_recent.clear();
+}
+
+void LevelView::release()
+{
+	for (auto i = m_chunks.begin(); i != m_chunks.end(); ++i)
+	{
+		if (*i)
+		{
+			m_spare.push_back(*i);
+			*i = NULL;
+		}
+	}
+}
+
+void LevelView::flush()
+{
+	release();
+	for (auto i = m_spare.begin(); i != m_spare.end(); ++i)
+		SDL_FreeSurface(*i);
+	m_spare.clear();
+}
+
+void LevelView::allocate()
+{
+	flush();
+	const SDL_PixelFormat *f = Display::frame()->format;
+	m_bpp = f->BytesPerPixel;
+	m_rmask = f->Rmask;
+	m_gmask = f->Gmask;
+	m_bmask = f->Bmask;
+
+	// No more than can ever be wanted at once, or than there are chunks
+	size_t count = std::min((size_t)MAX_CHUNKS, m_chunks.size());
+	m_spare.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		SDL_Surface *s = SDL_CreateRGBSurface(SDL_SWSURFACE,
+			CHUNK_TILES * P2_TILE_WIDTH, CHUNK_TILES * P2_TILE_HEIGHT,
+			f->BitsPerPixel, f->Rmask, f->Gmask, f->Bmask, f->Amask);
+		if (!s)
+			break;
+		m_spare.push_back(s);
+	}
+}
+
+void LevelView::centreOn(int x, int y)
+{
+	int level_width = m_level.width * P2_TILE_WIDTH;
+	int level_height = m_level.height * P2_TILE_HEIGHT;
+
+	if (level_width <= m_view_width)
+		m_origin_x = (level_width - m_view_width) / 2;
+	else
+	{
+		m_origin_x = std::min(std::max(x - (m_view_width / 2), 0),
+			level_width - m_view_width);
+	}
+
+	if (level_height <= m_view_height)
+		m_origin_y = (level_height - m_view_height) / 2;
+	else
+	{
+		m_origin_y = std::min(std::max(y - (m_view_height / 2), 0),
+			level_height - m_view_height);
+	}
+}
+
+SDL_Surface *LevelView::chunk(int cx, int cy)
+{
+	int index = (cy * m_chunks_x) + cx;
+	m_last_drawn[index] = m_frame;
+	if (m_chunks[index])
+		return m_chunks[index];
+
+	if (m_spare.empty())
+		evict();
+	if (m_spare.empty())
+		return NULL;
+	SDL_Surface *s = m_spare.back();
+	m_spare.pop_back();
+
+	// Chunks along the right and bottom edges may be cut short
+	int x0 = cx * CHUNK_TILES;
+	int y0 = cy * CHUNK_TILES;
+	int w = std::min(CHUNK_TILES, m_level.width - x0);
+	int h = std::min(CHUNK_TILES, m_level.height - y0);
+	for (int y = 0; y < h; ++y)
+	{
+		for (int x = 0; x < w; ++x)
+		{
+			SDL_Rect rect = {
+				(Sint16)(x * P2_TILE_WIDTH),
+				(Sint16)(y * P2_TILE_HEIGHT),
+				0, 0
+			};
+			uint8_t tile = m_level.tilemap[((y0 + y) * m_level.width) + x0 + x];
+			SDL_BlitSurface(m_tiles[tile], NULL, s, &rect);
+		}
+	}
+
+	m_chunks[index] = s;
+	return s;
+}
+
+void LevelView::evict()
+{
+	int oldest = -1;
+	for (size_t i = 0; i < m_chunks.size(); ++i)
+	{
+		if (m_chunks[i] && m_last_drawn[i] != m_frame
+			&& (oldest < 0 || m_last_drawn[i] < m_last_drawn[oldest]))
+			oldest = i;
+	}
+	if (oldest < 0)
+		return;
+
+	m_spare.push_back(m_chunks[oldest]);
+	m_chunks[oldest] = NULL;
+}
+
+void LevelView::render(RenderQueue &queue)
+{
+	++m_frame;
+
+	// Chunks are built in the frame's format; make new surfaces if
+	// the video mode has changed since, or rebuild the chunks if the
+	// tiles have been reloaded
+	const SDL_PixelFormat *f = Display::frame()->format;
+	if (f->BytesPerPixel != m_bpp || f->Rmask != m_rmask
+		|| f->Gmask != m_gmask || f->Bmask != m_bmask)
+		allocate();
+	if (m_generation != m_tiles_generation)
+	{
+		release();
+		m_generation = m_tiles_generation;
+	}
+
+	// Levels which don't fill the window have a black border
+	if (m_origin_x < 0 || m_origin_y < 0)
+		queue.fill(RenderQueue::Background, NULL, 0, 0, 0);
+
+	// Chunks overlapping the window, clamped to the level
+	const int chunk_width = CHUNK_TILES * P2_TILE_WIDTH;
+	const int chunk_height = CHUNK_TILES * P2_TILE_HEIGHT;
+	int first_x = std::max(m_origin_x, 0) / chunk_width;
+	int first_y = std::max(m_origin_y, 0) / chunk_height;
+	int last_x = std::min((m_origin_x + m_view_width - 1) / chunk_width,
+		m_chunks_x - 1);
+	int last_y = std::min((m_origin_y + m_view_height - 1) / chunk_height,
+		m_chunks_y - 1);
+
+	for (int cy = first_y; cy <= last_y; ++cy)
+	{
+		for (int cx = first_x; cx <= last_x; ++cx)
+		{
+			SDL_Surface *s = chunk(cx, cy);
+			if (s)
+			{
+				SDL_Rect used = {
+					0, 0,
+					(Uint16)(std::min(CHUNK_TILES,
+						m_level.width - (cx * CHUNK_TILES)) * P2_TILE_WIDTH),
+					(Uint16)(std::min(CHUNK_TILES,
+						m_level.height - (cy * CHUNK_TILES)) * P2_TILE_HEIGHT)
+				};
+				queue.blit(RenderQueue::Background, s, &used,
+					(cx * chunk_width) - m_origin_x,
+					(cy * chunk_height) - m_origin_y);
+			}
+		}
+	}
+}
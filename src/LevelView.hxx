@@ -0,0 +1,123 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HXX_LEVELVIEW
+#define HXX_LEVELVIEW
+
+#include <vector>
+#include <list>
+#include <memory>
+#include <cstdint>
+
+#include <SDL.h>
+
+#include "LevelSet.hxx"
+#include "RenderQueue.hxx"
+
+// Draws a level's tiles through a window the size of the screen, which
+// can be moved about to follow the player around levels bigger than it.
+// Tiles are pre-rendered in chunks of 8*8, each built the first time it
+// comes into view.  Only the few chunks overlapping the window are drawn
+// each frame, so big levels cost no more to draw than small ones.  The
+// surfaces chunks are built on are made along with the view, and once
+// they are all in use the least recently drawn chunk gives up its
+// surface, so scrolling about never allocates anything.
+class LevelView
+{
+	public:
+		LevelView(const Level &level, const TileSet &tiles,
+			int view_width, int view_height);
+		~LevelView();
+
+		// A view of the given level, reusing one of the last few asked
+		// for if the level has been played recently, so that going back
+		// to it doesn't mean building its chunks all over again
+		static std::shared_ptr<LevelView> recent(const Level &level,
+			const TileSet &tiles, int view_width, int view_height);
+
+		// After data has been reloaded (P2_ASSET_* flags), rebuild
+		// every view's chunks if the tiles changed, and stop handing
+		// out old views if the levels did
+		static void reloaded(unsigned assets);
+
+		// Move the window so that the given level pixel is in the
+		// middle of it, as far as the edges of the level allow.
+		// Levels smaller than the window are centred in it.
+		void centreOn(int x, int y);
+
+		// Level pixel in the top left corner of the window
+		int originX() const
+		{
+			return m_origin_x;
+		};
+
+		int originY() const
+		{
+			return m_origin_y;
+		};
+
+		void render(RenderQueue &queue);
+
+	private:
+		// Get the given chunk, building it if need be
+		SDL_Surface *chunk(int cx, int cy);
+
+		// Give up the least recently drawn chunk not drawn this frame
+		void evict();
+
+		// Give up every chunk, as when the tiles change
+		void release();
+
+		// Free all the surfaces, and make them afresh in the frame's
+		// format, as when the screen format changes
+		void allocate();
+		void flush();
+
+		const Level &m_level;
+		const TileSet &m_tiles;
+		int m_view_width;
+		int m_view_height;
+		int m_origin_x;
+		int m_origin_y;
+
+		// One entry per chunk, row by row: the surface (NULL until
+		// built) and the frame on which it was last drawn.  Surfaces
+		// not holding a chunk wait in m_spare; all are a whole chunk
+		// in size, so those on the right and bottom edges are part used.
+		int m_chunks_x;
+		int m_chunks_y;
+		std::vector<SDL_Surface*> m_chunks;
+		std::vector<uint32_t> m_last_drawn;
+		std::vector<SDL_Surface*> m_spare;
+		uint32_t m_frame;
+
+		// Pixel format chunks were built in, and the value of
+		// m_tiles_generation when they were
+		int m_bpp;
+		Uint32 m_rmask;
+		Uint32 m_gmask;
+		Uint32 m_bmask;
+		uint32_t m_generation;
+
+		// Views handed out by recent(), most recently used first
+		static std::list<std::shared_ptr<LevelView>> m_recent;
+
+		// Bumped each time the tiles are reloaded
+		static uint32_t m_tiles_generation;
+};
+
+#endif
@@ -45,7 +45,7 @@
 //
 
 MainMenu::MainMenu(const Alphabet &a, const LevelSet &l)
-	: Menu(a, l)
+	: Menu(a, l), m_hiscore_surf(NULL)
 {
 	// Set main menu items
 	setMenuItems(4,
@@ -54,10 +54,18 @@ MainMenu::MainMenu(const Alphabet &a, const LevelSet &l)
 		"Credits", 255, 127, 0,
 		"Quit Game", 255, 0, 0);
 
+	renderHighScore();
+}
+
+void MainMenu::renderHighScore()
+{
+	if (m_hiscore_surf)
+		SDL_FreeSurface(m_hiscore_surf);
+
 	// Render the high score into a surface
 	std::ostringstream hs;
 	hs << "High: " << Score::high;
-	m_hiscore_surf = a.renderWord(hs.str(), 192, 192, 192);
+	m_hiscore_surf = m_alphabet.renderWord(hs.str(), 192, 192, 192);
 }
 
 GameLoopFactory * MainMenu::loopForItem(int item)
@@ -92,21 +100,25 @@ GameLoopFactory * MainMenu::loopForItem(int item)
 }
 		
 bool MainMenu::update(float elapsed, const Uint8 *kbdstate,
-	SDL_Surface *screen)
+	RenderQueue &queue)
 {
-	bool result = Menu::update(elapsed, kbdstate, screen);
+	bool result = Menu::update(elapsed, kbdstate, queue);
 
 	// Render the high score on top of everything
 	// already put there by our base class
-	SDL_Rect rect = {
-		(Sint16)(320 - (m_hiscore_surf->w / 2)),
-		320, 0, 0
-	};
-	SDL_BlitSurface(m_hiscore_surf, NULL, screen, &rect);
+	queue.blit(RenderQueue::Text, m_hiscore_surf, NULL,
+		320 - (m_hiscore_surf->w / 2), 320);
 
 	return result;
 }
 
+std::shared_ptr<GameLoop> MainMenu::reload(unsigned assets)
+{
+	if (assets & P2_ASSET_GLYPHS)
+		renderHighScore();
+	return Menu::reload(assets);
+}
+
 MainMenu::~MainMenu()
 {
 	SDL_FreeSurface(m_hiscore_surf);
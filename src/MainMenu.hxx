@@ -28,11 +28,15 @@ class MainMenu: public Menu
 		~MainMenu();
 
 		bool update(float elapsed, const Uint8 *kbdstate,
-			SDL_Surface *screen);
+			RenderQueue &queue);
+		std::shared_ptr<GameLoop> reload(unsigned assets);
 
 	private:
 		GameLoopFactory * loopForItem(int item);
 
+		// Render the high score onto m_hiscore_surf
+		void renderHighScore();
+
 		SDL_Surface *m_hiscore_surf;
 };
 
@@ -0,0 +1,213 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <cstring>
+
+// System
+
+// Library
+
+// Local
+#include "MemoryBackend.hxx"
+#include "RleSprite.hxx"
+#include "Pixels.hxx"
+
+//
+// Implementation
+//
+
+#define MEMORY_RMASK 0x00ff0000
+#define MEMORY_GMASK 0x0000ff00
+#define MEMORY_BMASK 0x000000ff
+
+// Blend one channel of a source pixel over a destination pixel
+static inline uint32_t blendChannel(uint32_t s, uint32_t d, uint32_t shift,
+	int alpha)
+{
+	int sc = (s >> shift) & 0xff;
+	int dc = (d >> shift) & 0xff;
+	return (uint32_t)(dc + (((sc - dc) * alpha) / 255)) << shift;
+}
+
+MemoryBackend::MemoryBackend(int width, int height)
+	: m_width(width), m_height(height), m_pixels(width * height, 0)
+{
+	m_surface = SDL_CreateRGBSurfaceFrom(&(m_pixels[0]), width, height, 32,
+		width * 4, MEMORY_RMASK, MEMORY_GMASK, MEMORY_BMASK, 0);
+	if (!m_surface)
+	{
+		throw std::runtime_error(
+			std::string("Cannot allocate SDL surface for frame: ")
+			.append(SDL_GetError())
+		);
+	}
+}
+
+MemoryBackend::~MemoryBackend()
+{
+	SDL_FreeSurface(m_surface);
+}
+
+uint32_t MemoryBackend::hash() const
+{
+	// Every fourth pixel goes into the same one of four hashes, so that
+	// they can be worked out side by side, rather than each step waiting
+	// on the multiply before
+	uint32_t h[4] = {
+		2166136261u, 2166136261u, 2166136261u, 2166136261u
+	};
+	size_t n = m_pixels.size();
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		for (int lane = 0; lane < 4; ++lane)
+			h[lane] = (h[lane] ^ m_pixels[i + lane]) * 16777619u;
+	}
+	for (; i < n; ++i)
+		h[0] = (h[0] ^ m_pixels[i]) * 16777619u;
+
+	uint32_t result = 2166136261u;
+	for (int lane = 0; lane < 4; ++lane)
+		result = (result ^ h[lane]) * 16777619u;
+	return result;
+}
+
+void MemoryBackend::blit(SDL_Surface *source, const SDL_Rect &src_rect,
+	int x, int y, uint8_t alpha)
+{
+	// Clip to the source surface, then to the frame
+	int sx = src_rect.x;
+	int sy = src_rect.y;
+	int w = src_rect.w;
+	int h = src_rect.h;
+	if (sx < 0)
+	{
+		w += sx;
+		x -= sx;
+		sx = 0;
+	}
+	if (sy < 0)
+	{
+		h += sy;
+		y -= sy;
+		sy = 0;
+	}
+	w = std::min(w, source->w - sx);
+	h = std::min(h, source->h - sy);
+	if (x < 0)
+	{
+		w += x;
+		sx -= x;
+		x = 0;
+	}
+	if (y < 0)
+	{
+		h += y;
+		sy -= y;
+		y = 0;
+	}
+	w = std::min(w, m_width - x);
+	h = std::min(h, m_height - y);
+	if (w <= 0 || h <= 0)
+		return;
+
+	// The same opacity as SurfaceBackend would end up drawing at
+	int a = alpha;
+	if (a == 255 && (source->flags & SDL_SRCALPHA))
+		a = source->format->alpha;
+	const SDL_PixelFormat *f = source->format;
+	bool keyed = ((source->flags & SDL_SRCCOLORKEY) != 0);
+	bool native = (f->BytesPerPixel == 4 && f->Rmask == MEMORY_RMASK
+		&& f->Gmask == MEMORY_GMASK && f->Bmask == MEMORY_BMASK);
+
+	if (SDL_MUSTLOCK(source) && SDL_LockSurface(source) < 0)
+		return;
+
+	for (int r = 0; r < h; ++r)
+	{
+		const uint8_t *src = (const uint8_t*)(source->pixels)
+			+ ((sy + r) * source->pitch) + (sx * f->BytesPerPixel);
+		uint32_t *dest = &(m_pixels[((y + r) * m_width) + x]);
+
+		// Straight copies for the common case
+		if (native && !keyed && a == 255)
+		{
+			memcpy(dest, src, w * 4);
+			continue;
+		}
+
+		for (int i = 0; i < w; ++i)
+		{
+			uint32_t v = loadPixel(src + (i * f->BytesPerPixel),
+				f->BytesPerPixel);
+			if (keyed && v == f->colorkey)
+				continue;
+			if (!native)
+			{
+				Uint8 red, green, blue;
+				SDL_GetRGB(v, f, &red, &green, &blue);
+				v = (red << 16) | (green << 8) | blue;
+			}
+			if (a != 255)
+			{
+				v = blendChannel(v, dest[i], 16, a)
+					| blendChannel(v, dest[i], 8, a)
+					| blendChannel(v, dest[i], 0, a);
+			}
+			dest[i] = v & 0x00ffffff;
+		}
+	}
+
+	if (SDL_MUSTLOCK(source))
+		SDL_UnlockSurface(source);
+}
+
+void MemoryBackend::sprite(const RleSprite &sprite, int x, int y)
+{
+	sprite.blit(m_surface, x, y);
+}
+
+void MemoryBackend::fill(const SDL_Rect &rect, uint8_t r, uint8_t g,
+	uint8_t b)
+{
+	int left = std::max((int)rect.x, 0);
+	int top = std::max((int)rect.y, 0);
+	int right = std::min(rect.x + rect.w, m_width);
+	int bottom = std::min(rect.y + rect.h, m_height);
+	if (left >= right)
+		return;
+	uint32_t colour = (r << 16) | (g << 8) | b;
+	for (int y = top; y < bottom; ++y)
+	{
+		std::fill(m_pixels.begin() + (y * m_width) + left,
+			m_pixels.begin() + (y * m_width) + right, colour);
+	}
+}
@@ -0,0 +1,81 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HXX_MEMORYBACKEND
+#define HXX_MEMORYBACKEND
+
+#include <vector>
+#include <cstdint>
+
+#include "RenderQueue.hxx"
+
+// Backend drawing into a plain buffer of 0x00RRGGBB pixels, row by row,
+// with no need for a display.  Opaque and colour-keyed drawing gives the
+// same pixels as SDL does on a 32-bit screen; translucent drawing blends
+// as d + ((s - d) * alpha / 255), which may differ by one in places from
+// SDL's own blitters, but is the same on every machine.  So frames can
+// be hashed and compared between builds, as golden images.
+//
+// Sources may be in any pixel format, but are quickest to draw in ours,
+// as they are when nothing has converted them for a screen.
+// Per-pixel alpha is ignored.
+class MemoryBackend: public RenderBackend
+{
+	public:
+		MemoryBackend(int width, int height);
+		~MemoryBackend();
+
+		int width() const
+		{
+			return m_width;
+		};
+
+		int height() const
+		{
+			return m_height;
+		};
+
+		const uint32_t *pixels() const
+		{
+			return &(m_pixels[0]);
+		};
+
+		// The buffer as an SDL surface, sharing the same pixels, for
+		// drawing sprites into and for saving as an image
+		SDL_Surface *surface() const
+		{
+			return m_surface;
+		};
+
+		// Hash of the whole frame, for telling frames apart - FNV-1a
+		// over every pixel, but in four interleaved streams
+		uint32_t hash() const;
+
+		void blit(SDL_Surface *source, const SDL_Rect &src_rect,
+			int x, int y, uint8_t alpha);
+		void sprite(const RleSprite &sprite, int x, int y);
+		void fill(const SDL_Rect &rect, uint8_t r, uint8_t g, uint8_t b);
+
+	private:
+		int m_width;
+		int m_height;
+		std::vector<uint32_t> m_pixels;
+		SDL_Surface *m_surface;
+};
+
+#endif
@@ -34,6 +34,7 @@
 
 // Local
 #include "Menu.hxx"
+#include "Display.hxx"
 
 
 //
@@ -41,13 +42,28 @@
 //
 
 Menu::Menu(const Alphabet &a, const LevelSet &l)
-	: GameLoop(a, l), m_selected_item(0),
+	: GameLoop(a, l), m_selected_item(0), m_shown_item(-1), m_changed(true),
 	  m_y_offset(0), m_background_surf(NULL),
 	  m_old_kbdstate(NULL), m_next_loop(0)
 {
+	renderBackground();
+
+	// Store current keyboard state, and size of keyboard state array.
+	// This is so that later we can process keypresses separate from
+	// keys which were already held down when entering the menu.
+	const Uint8 *kbdstate = SDL_GetKeyState(&m_kbdstate_size);
+	m_old_kbdstate = new Uint8[m_kbdstate_size];
+	memcpy(m_old_kbdstate, kbdstate, m_kbdstate_size);
+}
+
+void Menu::renderBackground()
+{
+	if (m_background_surf)
+		SDL_FreeSurface(m_background_surf);
+
 	// Render main menu background
 	const uint8_t *tilemap = m_levelset.getTitleScreen();
-	m_background_surf = SDL_DisplayFormat(SDL_GetVideoSurface());
+	m_background_surf = Display::createFrameSurface();
 	for (int y = 0; y < P2_LEVEL_HEIGHT; ++y)
 	{
 		for (int x = 0; x < P2_LEVEL_WIDTH; ++x)
@@ -63,20 +79,13 @@ Menu::Menu(const Alphabet &a, const LevelSet &l)
 	}
 
 	// Render title at the top
-	SDL_Surface *title = a.renderWord("Pushy II", 192, 192, 192);
+	SDL_Surface *title = m_alphabet.renderWord("Pushy II", 192, 192, 192);
 	SDL_Rect rect = {
 		(Sint16)(320 - (title->w / 2)),
 		40, 0, 0
 	};
 	SDL_BlitSurface(title, NULL, m_background_surf, &rect);
 	SDL_FreeSurface(title);
-
-	// Store current keyboard state, and size of keyboard state array.
-	// This is so that later we can process keypresses separate from
-	// keys which were already held down when entering the menu.
-	const Uint8 *kbdstate = SDL_GetKeyState(&m_kbdstate_size);
-	m_old_kbdstate = new Uint8[m_kbdstate_size];
-	memcpy(m_old_kbdstate, kbdstate, m_kbdstate_size);
 }
 
 Menu::~Menu()
@@ -91,23 +100,41 @@ void Menu::setMenuItems(int count, ...)
 {
 	va_list ap;
 
-	// Render text of menu items onto surfaces
-	m_menu_items.reserve(count);
-	int h = 0;
+	// Keep the text and colour of each item, so that
+	// they can be rendered again if the glyphs change
+	m_items.reserve(count);
 	va_start(ap, count);
 	for (int i = 0; i < count; ++i)
 	{
-		const char * word = va_arg(ap, const char*);
-		int r = va_arg(ap, int);
-		int g = va_arg(ap, int);
-		int b = va_arg(ap, int);
+		Item item;
+		item.word = va_arg(ap, const char*);
+		item.r = va_arg(ap, int);
+		item.g = va_arg(ap, int);
+		item.b = va_arg(ap, int);
+		m_items.push_back(item);
+	}
+	va_end(ap);
+
+	renderItems();
+}
+
+void Menu::renderItems()
+{
+	for (auto i = m_menu_items.begin(); i != m_menu_items.end(); ++i)
+		SDL_FreeSurface(*i);
+	m_menu_items.clear();
 
-		m_menu_items.push_back(m_alphabet.renderWord(word, r, g, b));
+	// Render text of menu items onto surfaces
+	m_menu_items.reserve(m_items.size());
+	int h = 0;
+	for (auto i = m_items.begin(); i != m_items.end(); ++i)
+	{
+		m_menu_items.push_back(m_alphabet.renderWord(i->word,
+			i->r, i->g, i->b));
 
 		// Calculate total height of menu - used later for vertical centreing
 		h += m_menu_items.back()->h;
 	}
-	va_end(ap);
 
 	// Calculate Y offset for menu rendering
 	// Window height is 384 pixels, half of which is 192,
@@ -115,25 +142,21 @@ void Menu::setMenuItems(int count, ...)
 	m_y_offset = 205 - (h / 2);
 }
 
-bool Menu::update(float elapsed, const Uint8 *kbdstate, SDL_Surface *screen)
+bool Menu::update(float elapsed, const Uint8 *kbdstate, RenderQueue &queue)
 {
-	SDL_BlitSurface(m_background_surf, NULL, screen, NULL);
+	queue.blit(RenderQueue::Background, m_background_surf, NULL, 0, 0);
+
+	m_changed = (m_shown_item != m_selected_item);
+	m_shown_item = m_selected_item;
 
-	// Main menu visible.  Render menu items.
-	Sint16 yoff = m_y_offset;
+	// Main menu visible.  Render menu items,
+	// with all but the selected one faded out.
+	int yoff = m_y_offset;
 	for (size_t i = 0; i < m_menu_items.size(); ++i)
 	{
-		if (i == (size_t)m_selected_item)
-			SDL_SetAlpha(m_menu_items[i], SDL_SRCALPHA, 255);
-		else
-			SDL_SetAlpha(m_menu_items[i], SDL_SRCALPHA, 127);
-
-		SDL_Rect rect = {
-			(Sint16)(320 - (m_menu_items[i]->w / 2)),
-			yoff, 0, 0
-		};
-
-		SDL_BlitSurface(m_menu_items[i], NULL, screen, &rect);
+		queue.blit(RenderQueue::Text, m_menu_items[i], NULL,
+			320 - (m_menu_items[i]->w / 2), yoff,
+			(i == (size_t)m_selected_item) ? 255 : 127);
 		yoff += m_menu_items[i]->h;
 	}
 
@@ -166,6 +189,26 @@ bool Menu::update(float elapsed, const Uint8 *kbdstate, SDL_Surface *screen)
 	return true;
 }
 
+Uint32 Menu::idle() const
+{
+	// Navigation is drawn on the update after the key press
+	if (m_changed || m_shown_item != m_selected_item)
+		return 0;
+	return P2_IDLE_FOREVER;
+}
+
+std::shared_ptr<GameLoop> Menu::reload(unsigned assets)
+{
+	if (assets & (P2_ASSET_TILES | P2_ASSET_GLYPHS | P2_ASSET_LEVELS))
+		renderBackground();
+	if (assets & P2_ASSET_GLYPHS)
+		renderItems();
+
+	// Draw the next frame even if nothing is pressed
+	m_shown_item = -1;
+	return shared_from_this();
+}
+
 std::unique_ptr<GameLoopFactory> Menu::nextLoop()
 {
 	return std::unique_ptr<GameLoopFactory>(m_next_loop);
@@ -28,9 +28,11 @@ class Menu: public GameLoop
 		~Menu();
 
 		bool update(float elapsed, const Uint8 *kbdstate,
-			SDL_Surface *screen);
+			RenderQueue &queue);
 
 		std::unique_ptr<GameLoopFactory> nextLoop();
+		Uint32 idle() const;
+		std::shared_ptr<GameLoop> reload(unsigned assets);
 
 	protected:
 		virtual GameLoopFactory * loopForItem(int item) = 0;
@@ -38,7 +40,26 @@ class Menu: public GameLoop
 		void setMenuItems(int count, ...);
 
 	private:
+		// Draw the title screen and title onto m_background_surf,
+		// and the item text onto m_menu_items
+		void renderBackground();
+		void renderItems();
+
+		struct Item
+		{
+			const char *word;
+			int r;
+			int g;
+			int b;
+		};
+
 		int m_selected_item;
+
+		// Item shown as selected in the last frame, and whether
+		// that frame differed from the one before
+		int m_shown_item;
+		bool m_changed;
+		std::vector<Item> m_items;
 		std::vector<SDL_Surface*> m_menu_items;
 		Sint16 m_y_offset;
 
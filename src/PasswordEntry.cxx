@@ -33,6 +33,7 @@
 
 // Local
 #include "PasswordEntry.hxx"
+#include "Display.hxx"
 #include "InGame.hxx"
 #include "MainMenu.hxx"
 
@@ -42,12 +43,27 @@
 //
 
 PasswordEntry::PasswordEntry(const Alphabet &a, const LevelSet &l)
-	: GameLoop(a, l), m_background_surf(NULL),
-	  m_old_kbdstate(NULL), m_password_surf(NULL), m_next_loop(0)
+	: GameLoop(a, l), m_background_surf(NULL), m_drawn(false),
+	  m_changed(true), m_old_kbdstate(NULL), m_password_surf(NULL), m_next_loop(0)
 {
+	renderBackground();
+
+	// Store current keyboard state, and size of keyboard state array.
+	// This is so that later we can process keypresses separate from
+	// keys which were already held down when entering the menu.
+	const Uint8 *kbdstate = SDL_GetKeyState(&m_kbdstate_size);
+	m_old_kbdstate = new Uint8[m_kbdstate_size];
+	memcpy(m_old_kbdstate, kbdstate, m_kbdstate_size);
+}
+
+void PasswordEntry::renderBackground()
+{
+	if (m_background_surf)
+		SDL_FreeSurface(m_background_surf);
+
 	// Render main menu background
 	const uint8_t *tilemap = m_levelset.getTitleScreen();
-	m_background_surf = SDL_DisplayFormat(SDL_GetVideoSurface());
+	m_background_surf = Display::createFrameSurface();
 	for (int y = 0; y < P2_LEVEL_HEIGHT; ++y)
 	{
 		for (int x = 0; x < P2_LEVEL_WIDTH; ++x)
@@ -62,19 +78,12 @@ PasswordEntry::PasswordEntry(const Alphabet &a, const LevelSet &l)
 		}
 	}
 
-	SDL_Surface *p = a.renderWord("Password:", 255, 0, 255);
+	SDL_Surface *p = m_alphabet.renderWord("Password:", 255, 0, 255);
 	SDL_Rect rect = {
 		(Sint16)(320 - (p->w / 2)), 100, 0, 0
 	};
 	SDL_BlitSurface(p, NULL, m_background_surf, &rect);
 	SDL_FreeSurface(p);
-
-	// Store current keyboard state, and size of keyboard state array.
-	// This is so that later we can process keypresses separate from
-	// keys which were already held down when entering the menu.
-	const Uint8 *kbdstate = SDL_GetKeyState(&m_kbdstate_size);
-	m_old_kbdstate = new Uint8[m_kbdstate_size];
-	memcpy(m_old_kbdstate, kbdstate, m_kbdstate_size);
 }
 
 PasswordEntry::~PasswordEntry()
@@ -85,9 +94,9 @@ PasswordEntry::~PasswordEntry()
 	delete[] m_old_kbdstate;
 }
 
-bool PasswordEntry::update(float elapsed, const Uint8 *kbdstate, SDL_Surface *screen)
+bool PasswordEntry::update(float elapsed, const Uint8 *kbdstate, RenderQueue &queue)
 {
-	SDL_BlitSurface(m_background_surf, NULL, screen, NULL);
+	queue.blit(RenderQueue::Background, m_background_surf, NULL, 0, 0);
 
 	bool password_changed = false;
 
@@ -136,13 +145,14 @@ bool PasswordEntry::update(float elapsed, const Uint8 *kbdstate, SDL_Surface *sc
 		}
 	}
 
+	m_changed = (password_changed || !m_drawn);
+	m_drawn = true;
+
 	// Render the current password string
 	if (m_password_surf)
 	{
-		SDL_Rect rect = {
-			(Sint16)(320 - (m_password_surf->w / 2)), 200, 0, 0
-		};
-		SDL_BlitSurface(m_password_surf, NULL, screen, &rect);
+		queue.blit(RenderQueue::Text, m_password_surf, NULL,
+			320 - (m_password_surf->w / 2), 200);
 	}
 
 	// If enter is pressed, see if there is a level with the
@@ -173,6 +183,21 @@ bool PasswordEntry::update(float elapsed, const Uint8 *kbdstate, SDL_Surface *sc
 	return true;
 }
 
+std::shared_ptr<GameLoop> PasswordEntry::reload(unsigned assets)
+{
+	if (!(assets & (P2_ASSET_TILES | P2_ASSET_GLYPHS | P2_ASSET_LEVELS)))
+		return shared_from_this();
+
+	renderBackground();
+	if ((assets & P2_ASSET_GLYPHS) && m_password_surf)
+	{
+		SDL_FreeSurface(m_password_surf);
+		m_password_surf = m_alphabet.renderWord(m_password, 255, 255, 0);
+	}
+	m_drawn = false;
+	return shared_from_this();
+}
+
 std::unique_ptr<GameLoopFactory> PasswordEntry::nextLoop()
 {
 	return std::unique_ptr<GameLoopFactory>(m_next_loop);
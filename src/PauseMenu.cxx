@@ -63,6 +63,12 @@ PauseMenu::PauseMenu(const Alphabet &a, const LevelSet &l,
 		"Quit", 0, 255, 0);
 }
 
+std::shared_ptr<GameLoop> PauseMenu::reload(unsigned assets)
+{
+	m_paused_loop = m_paused_loop->reload(assets);
+	return Menu::reload(assets);
+}
+
 GameLoopFactory * PauseMenu::loopForItem(int item)
 {
 	GameLoopFactory *r = 0;
@@ -77,19 +83,13 @@ GameLoopFactory * PauseMenu::loopForItem(int item)
 			((UnpauseFactory*)r)->paused_loop = m_paused_loop;
 			break;
 		case 1:
-			{
-				// Retry - destroy old InGame object,
-				// then create a new one for the same level
-				InGame *i = (InGame*)(m_paused_loop.get());
-				int level = i->getLevel();
-				uint32_t score = i->getScore();
-				m_paused_loop.reset();
-				r = new InGameFactory();
-				r->a = &m_alphabet;
-				r->l = &m_levelset;
-				((InGameFactory*)r)->score = score;
-				((InGameFactory*)r)->level = level;
-			}
+			// Retry - start the paused level again from scratch,
+			// then carry on as for "Continue"
+			((InGame*)(m_paused_loop.get()))->reset();
+			r = new UnpauseFactory();
+			r->a = &m_alphabet;
+			r->l = &m_levelset;
+			((UnpauseFactory*)r)->paused_loop = m_paused_loop;
 			break;
 
 		default:
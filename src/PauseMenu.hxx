@@ -26,7 +26,10 @@ class PauseMenu: public Menu
 	public:
 		PauseMenu(const Alphabet &a, const LevelSet &l,
 			std::shared_ptr<GameLoop> paused_loop);
-		
+
+		// Reloads the paused game too
+		std::shared_ptr<GameLoop> reload(unsigned assets);
+
 	private:
 		GameLoopFactory * loopForItem(int item);
 
@@ -0,0 +1,68 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HXX_PIXELS
+#define HXX_PIXELS
+
+#include <cstdint>
+
+#include <SDL.h>
+
+// Read and write single pixels of 1 to 4 bytes, in SDL's layout
+
+inline uint32_t loadPixel(const uint8_t *p, int bpp)
+{
+	switch (bpp)
+	{
+		case 1:
+			return *p;
+		case 2:
+			return *((const uint16_t*)p);
+		case 3:
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+			return (p[0] << 16) | (p[1] << 8) | p[2];
+#else
+			return p[0] | (p[1] << 8) | (p[2] << 16);
+#endif
+		default:
+			return *((const uint32_t*)p);
+	}
+}
+
+inline void storePixel(uint8_t *p, uint32_t v, int bpp)
+{
+	switch (bpp)
+	{
+		case 1:
+			*p = v;
+			break;
+		case 2:
+			*((uint16_t*)p) = v;
+			break;
+		case 3:
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+			p[0] = v >> 16; p[1] = v >> 8; p[2] = v;
+#else
+			p[0] = v; p[1] = v >> 8; p[2] = v >> 16;
+#endif
+			break;
+		default:
+			*((uint32_t*)p) = v;
+	}
+}
+
+#endif
@@ -0,0 +1,136 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+
+// System
+
+// Library
+
+// Local
+#include "RenderPipeline.hxx"
+#include "Display.hxx"
+#include "FrameCapture.hxx"
+
+//
+// Implementation
+//
+
+RenderPipeline::RenderPipeline(RenderBackend &backend, int width,
+	int height, bool threaded)
+	: m_backend(backend), m_threaded(threaded), m_capture(NULL),
+	  m_busy(false), m_quit(false)
+{
+	for (int i = 0; i < 3; ++i)
+		m_queues[i].reset(new RenderQueue(width, height));
+	if (m_threaded)
+		m_thread = std::thread(&RenderPipeline::run, this);
+}
+
+RenderPipeline::~RenderPipeline()
+{
+	if (m_threaded)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+		}
+		m_wake.notify_one();
+		m_thread.join();
+	}
+}
+
+void RenderPipeline::submit()
+{
+	if (!m_threaded)
+	{
+		queue().flush(m_backend);
+		if (m_capture)
+			m_capture->add(Display::frame());
+		Display::present();
+		return;
+	}
+
+	m_buffers.publish();
+
+	// The new back buffer is no longer wanted by the render thread.
+	// Surfaces are released here, rather than over there, because
+	// their reference counts aren't atomic.
+	queue().clear();
+
+	// Taking the lock makes sure the render thread is either already
+	// awake, or waiting and about to be woken
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+	}
+	m_wake.notify_one();
+}
+
+void RenderPipeline::finish()
+{
+	if (!m_threaded)
+		return;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this] { return !m_busy && !m_buffers.fresh(); });
+}
+
+RenderStats RenderPipeline::totals() const
+{
+	RenderStats t = { 0, 0, 0, 0 };
+	for (int i = 0; i < 3; ++i)
+	{
+		const RenderStats &q = m_queues[i]->totals();
+		t.frames += q.frames;
+		t.draws += q.draws;
+		t.batches += q.batches;
+		t.pixels += q.pixels;
+	}
+	return t;
+}
+
+void RenderPipeline::run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_wake.wait(lock, [this] { return m_quit || m_buffers.fresh(); });
+		if (m_quit)
+			break;
+		m_buffers.fetch();
+		m_busy = true;
+		lock.unlock();
+
+		m_queues[m_buffers.front()]->draw(m_backend);
+		if (m_capture)
+			m_capture->add(Display::frame());
+		Display::present();
+
+		lock.lock();
+		m_busy = false;
+		m_idle.notify_all();
+	}
+}
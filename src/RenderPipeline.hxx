@@ -0,0 +1,102 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HXX_RENDERPIPELINE
+#define HXX_RENDERPIPELINE
+
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "RenderQueue.hxx"
+#include "TripleBuffer.hxx"
+
+class FrameCapture;
+
+// Takes each frame as queued up by the game loop, draws it, and puts it
+// on the screen with Display::present().
+//
+// If threaded, frames are drawn and presented on a thread of their own,
+// so that the main thread can get on with input and simulation while
+// the screen flips.  Queues are passed over through a TripleBuffer: if
+// frames come quicker than they can be shown, the latest one wins.
+// Otherwise each frame is drawn as soon as it's submitted.
+class RenderPipeline
+{
+	public:
+		RenderPipeline(RenderBackend &backend, int width, int height,
+			bool threaded);
+		~RenderPipeline();
+
+		bool threaded() const
+		{
+			return m_threaded;
+		};
+
+		// Queue in which to build the next frame.  Empty to begin with.
+		RenderQueue &queue()
+		{
+			return *(m_queues[m_buffers.back()]);
+		};
+
+		// Draw and present the frame built in queue()
+		void submit();
+
+		// Hand every frame drawn from now on to the given capture,
+		// or stop capturing if NULL.  Call only when no frame has been
+		// submitted since the last finish().
+		void capture(FrameCapture *c)
+		{
+			m_capture = c;
+		};
+
+		// Throw away the frame built in queue() without drawing it,
+		// leaving the last one submitted on the screen
+		void discard()
+		{
+			queue().clear();
+		};
+
+		// Wait until the latest frame submitted is on the screen, and
+		// nothing is being drawn, so that the screen may be read from
+		void finish();
+
+		// Drawing done for every frame so far.  Call finish() first.
+		RenderStats totals() const;
+
+	private:
+		void run();
+
+		RenderBackend &m_backend;
+		bool m_threaded;
+		FrameCapture *m_capture;
+		std::unique_ptr<RenderQueue> m_queues[3];
+		TripleBuffer m_buffers;
+
+		// The render thread sleeps on m_wake until a frame is published,
+		// and signals m_idle when it has finished drawing
+		std::thread m_thread;
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		std::condition_variable m_idle;
+		bool m_busy;
+		bool m_quit;
+};
+
+#endif
@@ -0,0 +1,273 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <algorithm>
+#include <functional>
+
+// System
+
+// Library
+
+// Local
+#include "RenderQueue.hxx"
+#include "RleSprite.hxx"
+
+//
+// Implementation
+//
+
+void RenderBackend::drawQueue(const RenderQueue &queue)
+{
+	queue.drawBand(*this, 0, queue.height());
+}
+
+void SurfaceBackend::blit(SDL_Surface *source, const SDL_Rect &src_rect,
+	int x, int y, uint8_t alpha)
+{
+	SDL_Rect src = src_rect;
+	SDL_Rect dst = {
+		(Sint16)x, (Sint16)y, 0, 0
+	};
+	if (alpha == 255)
+	{
+		SDL_BlitSurface(source, &src, m_target, &dst);
+		return;
+	}
+
+	// Put the source's own alpha settings back afterwards, so that
+	// one command's opacity doesn't leak into the next
+	Uint32 flags = source->flags & (SDL_SRCALPHA | SDL_RLEACCEL);
+	Uint8 old_alpha = source->format->alpha;
+	SDL_SetAlpha(source, SDL_SRCALPHA, alpha);
+	SDL_BlitSurface(source, &src, m_target, &dst);
+	SDL_SetAlpha(source, flags, old_alpha);
+}
+
+void SurfaceBackend::sprite(const RleSprite &sprite, int x, int y)
+{
+	sprite.blit(m_target, x, y);
+}
+
+void SurfaceBackend::fill(const SDL_Rect &rect, uint8_t r, uint8_t g,
+	uint8_t b)
+{
+	SDL_Rect dst = rect;
+	SDL_FillRect(m_target, &dst, SDL_MapRGB(m_target->format, r, g, b));
+}
+
+RenderQueue::RenderQueue(int width, int height, size_t capacity)
+	: m_width(width), m_height(height)
+{
+	m_commands.reserve(capacity);
+	m_order.reserve(capacity);
+	m_stats.frames = 0;
+	m_stats.draws = 0;
+	m_stats.batches = 0;
+	m_stats.pixels = 0;
+	m_totals = m_stats;
+}
+
+RenderQueue::~RenderQueue()
+{
+	clear();
+}
+
+void RenderQueue::clear()
+{
+	for (auto i = m_commands.cbegin(); i != m_commands.cend(); ++i)
+	{
+		if (i->kind == Blit)
+			SDL_FreeSurface((SDL_Surface*)(i->source));
+	}
+	m_commands.clear();
+}
+
+void RenderQueue::blit(Layer layer, SDL_Surface *source,
+	const SDL_Rect *src_rect, int x, int y, uint8_t alpha)
+{
+	Command c;
+	c.layer = layer;
+	c.kind = Blit;
+	c.alpha = alpha;
+	c.source = source;
+	if (src_rect)
+		c.rect = *src_rect;
+	else
+	{
+		c.rect.x = 0;
+		c.rect.y = 0;
+		c.rect.w = source->w;
+		c.rect.h = source->h;
+	}
+	c.x = x;
+	c.y = y;
+	m_commands.push_back(c);
+
+	// Released by clear()
+	++(source->refcount);
+}
+
+void RenderQueue::sprite(Layer layer, const RleSprite &sprite, int x, int y)
+{
+	Command c;
+	c.layer = layer;
+	c.kind = Sprite;
+	c.alpha = 255;
+	c.source = &sprite;
+	c.x = x;
+	c.y = y;
+	m_commands.push_back(c);
+}
+
+void RenderQueue::fill(Layer layer, const SDL_Rect *rect, uint8_t r,
+	uint8_t g, uint8_t b)
+{
+	Command c;
+	c.layer = layer;
+	c.kind = Fill;
+	c.alpha = 255;
+	c.colour[0] = r;
+	c.colour[1] = g;
+	c.colour[2] = b;
+	c.source = NULL;
+	if (rect)
+		c.rect = *rect;
+	else
+	{
+		c.rect.x = 0;
+		c.rect.y = 0;
+		c.rect.w = m_width;
+		c.rect.h = m_height;
+	}
+	c.x = c.rect.x;
+	c.y = c.rect.y;
+	m_commands.push_back(c);
+}
+
+bool RenderQueue::before(uint32_t a, uint32_t b) const
+{
+	const Command &ca = m_commands[a];
+	const Command &cb = m_commands[b];
+	if (ca.layer != cb.layer)
+		return (ca.layer < cb.layer);
+	if ((ca.kind == Fill) != (cb.kind == Fill))
+		return (ca.kind == Fill);
+	if (ca.source != cb.source)
+		return std::less<const void*>()(ca.source, cb.source);
+	return (a < b);
+}
+
+void RenderQueue::extent(const Command &c, int &x, int &y, int &w,
+	int &h) const
+{
+	x = c.x;
+	y = c.y;
+	if (c.kind == Sprite)
+	{
+		// Only the opaque part of a sprite is drawn
+		const RleSprite *s = (const RleSprite*)c.source;
+		x += s->trimX();
+		y += s->trimY();
+		w = s->trimWidth();
+		h = s->trimHeight();
+	}
+	else
+	{
+		w = c.rect.w;
+		h = c.rect.h;
+	}
+}
+
+uint32_t RenderQueue::coverage(const Command &c) const
+{
+	int x, y, w, h;
+	extent(c, x, y, w, h);
+
+	int left = std::max(x, 0);
+	int top = std::max(y, 0);
+	int right = std::min(x + w, m_width);
+	int bottom = std::min(y + h, m_height);
+	if (left >= right || top >= bottom)
+		return 0;
+	return (right - left) * (bottom - top);
+}
+
+void RenderQueue::draw(RenderBackend &backend)
+{
+	m_order.resize(m_commands.size());
+	for (uint32_t i = 0; i < m_order.size(); ++i)
+		m_order[i] = i;
+	std::sort(m_order.begin(), m_order.end(),
+		[this](uint32_t a, uint32_t b) { return before(a, b); });
+
+	m_stats.frames = 1;
+	m_stats.draws = m_commands.size();
+	m_stats.batches = 0;
+	m_stats.pixels = 0;
+	const void *last_source = NULL;
+	for (auto i = m_order.cbegin(); i != m_order.cend(); ++i)
+	{
+		const Command &c = m_commands[*i];
+		if (i == m_order.cbegin() || c.source != last_source)
+			++m_stats.batches;
+		last_source = c.source;
+		m_stats.pixels += coverage(c);
+	}
+
+	backend.drawQueue(*this);
+
+	m_totals.frames += 1;
+	m_totals.draws += m_stats.draws;
+	m_totals.batches += m_stats.batches;
+	m_totals.pixels += m_stats.pixels;
+}
+
+void RenderQueue::drawBand(RenderBackend &backend, int top, int bottom) const
+{
+	for (auto i = m_order.cbegin(); i != m_order.cend(); ++i)
+	{
+		const Command &c = m_commands[*i];
+		int x, y, w, h;
+		extent(c, x, y, w, h);
+		if (y >= bottom || y + h <= top)
+			continue;
+
+		switch (c.kind)
+		{
+			case Fill:
+				backend.fill(c.rect, c.colour[0], c.colour[1], c.colour[2]);
+				break;
+			case Blit:
+				backend.blit((SDL_Surface*)c.source, c.rect, c.x, c.y,
+					c.alpha);
+				break;
+			case Sprite:
+				backend.sprite(*(const RleSprite*)c.source, c.x, c.y);
+		}
+	}
+}
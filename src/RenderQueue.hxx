@@ -0,0 +1,214 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HXX_RENDERQUEUE
+#define HXX_RENDERQUEUE
+
+#include <vector>
+#include <cstdint>
+
+#include <SDL.h>
+
+class RleSprite;
+class RenderQueue;
+
+// Something which carries out drawing commands on a frame
+class RenderBackend
+{
+	public:
+		virtual ~RenderBackend() {};
+
+		// Draw a whole queue, as RenderQueue::draw() asks us to.  By
+		// default this draws every command in turn; backends which can
+		// split the work up may instead draw parts of the frame with
+		// RenderQueue::drawBand().
+		virtual void drawQueue(const RenderQueue &queue);
+
+		// Copy part of a surface with its top left corner at (x, y), at
+		// the given opacity.  At 255 the surface's own colour key and
+		// alpha settings apply.
+		virtual void blit(SDL_Surface *source, const SDL_Rect &src_rect,
+			int x, int y, uint8_t alpha) = 0;
+
+		// Draw a sprite - see RleSprite::blit
+		virtual void sprite(const RleSprite &sprite, int x, int y) = 0;
+
+		// Fill a rectangle with a solid colour
+		virtual void fill(const SDL_Rect &rect, uint8_t r, uint8_t g,
+			uint8_t b) = 0;
+};
+
+// Backend drawing straight onto an SDL surface
+class SurfaceBackend: public RenderBackend
+{
+	public:
+		explicit SurfaceBackend(SDL_Surface *target)
+			: m_target(target)
+		{};
+
+		void blit(SDL_Surface *source, const SDL_Rect &src_rect,
+			int x, int y, uint8_t alpha);
+		void sprite(const RleSprite &sprite, int x, int y);
+		void fill(const SDL_Rect &rect, uint8_t r, uint8_t g, uint8_t b);
+
+	private:
+		SDL_Surface *m_target;
+};
+
+// Drawing done over some number of frames
+struct RenderStats
+{
+	uint64_t frames;
+
+	// Commands, and runs of consecutive commands with the same source
+	uint64_t draws;
+	uint64_t batches;
+
+	// Pixels covered by all commands, clipped to the frame.  Divide by
+	// the frame's area for the average number of times each pixel
+	// was drawn.
+	uint64_t pixels;
+};
+
+// Drawing commands for one frame, collected as the frame is built and
+// then handed to a backend all at once.  Commands are drawn layer by
+// layer; within a layer, fills come first, then the rest grouped by
+// source in the order submitted, so nothing drawn on one layer may
+// depend on the order of anything else on the same layer.
+//
+// Queued surfaces are kept alive, by holding a reference to each, until
+// the queue is flushed or cleared, so they may be freed as soon as they
+// have been queued.  Sprites must outlive the queue.  Surface reference
+// counts aren't thread safe, so only one thread may queue, flush or
+// clear, though another may draw() a finished queue while nothing else
+// touches it or its surfaces' reference counts.
+class RenderQueue
+{
+	public:
+		enum Layer
+		{
+			Background,
+			Objects,
+			Overlay,
+			Text
+		};
+
+		// Size of the frame to be drawn, and room for this many commands
+		// before the queue has to grow
+		RenderQueue(int width, int height, size_t capacity = 1024);
+		~RenderQueue();
+
+		int width() const
+		{
+			return m_width;
+		};
+
+		int height() const
+		{
+			return m_height;
+		};
+
+		// Copy part of a surface (all of it if src_rect is NULL)
+		// with its top left corner at (x, y)
+		void blit(Layer layer, SDL_Surface *source, const SDL_Rect *src_rect,
+			int x, int y, uint8_t alpha = 255);
+
+		// Draw a sprite with the top left corner of the untrimmed
+		// sprite at (x, y)
+		void sprite(Layer layer, const RleSprite &sprite, int x, int y);
+
+		// Fill a rectangle (the whole frame if rect is NULL)
+		void fill(Layer layer, const SDL_Rect *rect, uint8_t r, uint8_t g,
+			uint8_t b);
+
+		// Draw everything queued since the last flush, then empty the queue
+		void flush(RenderBackend &backend)
+		{
+			draw(backend);
+			clear();
+		};
+
+		// Draw everything queued since the last flush, leaving it queued
+		void draw(RenderBackend &backend);
+
+		// Throw away everything queued since the last flush
+		void clear();
+
+		// Draw the commands which touch rows [top, bottom) of the frame,
+		// in the same order as draw() would.  Only for backends'
+		// drawQueue(), which must make sure nothing is drawn outside
+		// those rows.  Several threads may draw different bands at once.
+		void drawBand(RenderBackend &backend, int top, int bottom) const;
+
+		// Drawing done by the last draw or flush
+		const RenderStats &stats() const
+		{
+			return m_stats;
+		};
+
+		// Drawing done by every draw and flush so far
+		const RenderStats &totals() const
+		{
+			return m_totals;
+		};
+
+	private:
+		enum Kind
+		{
+			Fill,
+			Blit,
+			Sprite
+		};
+
+		struct Command
+		{
+			uint8_t layer;
+			uint8_t kind;
+			uint8_t alpha;
+			uint8_t colour[3];
+
+			// SDL_Surface for blits, RleSprite for sprites, NULL for fills
+			const void *source;
+
+			// Source rectangle for blits, destination for fills
+			SDL_Rect rect;
+			int x;
+			int y;
+		};
+
+		// Does a command draw before another on the same frame?
+		bool before(uint32_t a, uint32_t b) const;
+
+		// Area a command draws to, before clipping
+		void extent(const Command &c, int &x, int &y, int &w, int &h) const;
+
+		// Pixels covered by a command, clipped to the frame
+		uint32_t coverage(const Command &c) const;
+
+		int m_width;
+		int m_height;
+		std::vector<Command> m_commands;
+
+		// Order in which to draw commands, as indices into m_commands
+		std::vector<uint32_t> m_order;
+
+		RenderStats m_stats;
+		RenderStats m_totals;
+};
+
+#endif
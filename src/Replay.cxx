@@ -0,0 +1,338 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <chrono>
+#include <cstring>
+
+// System
+
+// Library
+
+// Local
+#include "Replay.hxx"
+#include "Constants.hxx"
+#include "Simulation.hxx"
+#include "ThreadPool.hxx"
+
+//
+// Implementation
+//
+
+#define REPLAY_MAGIC "P2RP"
+#define REPLAY_VERSION 2
+
+// Token layout: tick count in the top bits, then
+// direction plus one (zero for no key)
+#define TOKEN_DIRECTION_BITS 3
+
+namespace Replay
+{
+	std::ostream *output = NULL;
+}
+
+static void writeVarint(std::ostream &s, uint32_t v)
+{
+	// Seven bits at a time, low bits first, top bit set on
+	// every byte except the last
+	char buff[5];
+	int len = 0;
+	while (v >= 0x80)
+	{
+		buff[len++] = (char)((v & 0x7f) | 0x80);
+		v >>= 7;
+	}
+	buff[len++] = (char)v;
+	s.write(buff, len);
+}
+
+static uint32_t readVarint(std::istream &s)
+{
+	uint32_t v = 0;
+	for (int shift = 0; shift < 35; shift += 7)
+	{
+		int c = s.get();
+		if (c == EOF)
+			throw std::runtime_error("Replay data truncated");
+		v |= (uint32_t)(c & 0x7f) << shift;
+		if (!(c & 0x80))
+			return v;
+	}
+	throw std::runtime_error("Replay data corrupt: over-long number");
+}
+
+uint32_t Replay::token(uint32_t ticks, int direction)
+{
+	return (ticks << TOKEN_DIRECTION_BITS) | (uint32_t)(direction + 1);
+}
+
+void Replay::untoken(uint32_t token, uint32_t &ticks, int &direction)
+{
+	ticks = token >> TOKEN_DIRECTION_BITS;
+	direction = (int)(token & ((1 << TOKEN_DIRECTION_BITS) - 1)) - 1;
+}
+
+void Replay::record(ReplayRun &r, int direction)
+{
+	// Extend the last token if the same key is still held
+	if (!r.inputs.empty())
+	{
+		uint32_t ticks;
+		int last;
+		untoken(r.inputs.back(), ticks, last);
+		if (last == direction && ticks < (UINT32_MAX >> TOKEN_DIRECTION_BITS))
+		{
+			r.inputs.back() = token(ticks + 1, direction);
+			return;
+		}
+	}
+	r.inputs.push_back(token(1, direction));
+}
+
+uint32_t Replay::length(const ReplayRun &r)
+{
+	uint32_t total = 0;
+	for (auto i = r.inputs.cbegin(); i != r.inputs.cend(); ++i)
+		total += (*i >> TOKEN_DIRECTION_BITS);
+	return total;
+}
+
+void Replay::truncate(ReplayRun &r, uint32_t ticks)
+{
+	uint32_t total = 0;
+	for (auto i = r.inputs.begin(); i != r.inputs.end(); ++i)
+	{
+		uint32_t t;
+		int direction;
+		untoken(*i, t, direction);
+		if (total + t >= ticks)
+		{
+			*i = token(ticks - total, direction);
+			r.inputs.erase((ticks > total) ? i + 1 : i, r.inputs.end());
+			return;
+		}
+		total += t;
+	}
+}
+
+void Replay::writeHeader(std::ostream &s)
+{
+	s.write(REPLAY_MAGIC, 4);
+	writeVarint(s, REPLAY_VERSION);
+}
+
+void Replay::writeRun(std::ostream &s, const ReplayRun &r)
+{
+	writeVarint(s, r.level);
+
+	// Pack hash is effectively random, so would only grow as a varint
+	unsigned char c[4] = {
+		(unsigned char)(r.pack_hash), (unsigned char)(r.pack_hash >> 8),
+		(unsigned char)(r.pack_hash >> 16), (unsigned char)(r.pack_hash >> 24)
+	};
+	s.write((char*)c, 4);
+
+	writeVarint(s, r.tick_rate);
+	writeVarint(s, r.start_score);
+	writeVarint(s, r.final_score);
+	writeVarint(s, r.completed ? 1 : 0);
+	writeVarint(s, r.inputs.size());
+	for (auto i = r.inputs.cbegin(); i != r.inputs.cend(); ++i)
+		writeVarint(s, *i);
+
+	// Flush so that a crash (or a kill) doesn't lose finished runs
+	s.flush();
+}
+
+void Replay::readHeader(std::istream &s)
+{
+	char magic[4];
+	s.read(magic, 4);
+	if (!s || memcmp(magic, REPLAY_MAGIC, 4) != 0)
+		throw std::runtime_error("Not a Pushy II replay file");
+	if (readVarint(s) != REPLAY_VERSION)
+		throw std::runtime_error("Unsupported replay file version");
+}
+
+bool Replay::readRun(std::istream &s, ReplayRun &r)
+{
+	if (s.peek() == EOF)
+		return false;
+
+	r.level = readVarint(s);
+
+	unsigned char c[4];
+	s.read((char*)c, 4);
+	if (!s)
+		throw std::runtime_error("Replay data truncated");
+	r.pack_hash = (c[0] | (c[1] << 8) | (c[2] << 16) | ((uint32_t)c[3] << 24));
+
+	r.tick_rate = readVarint(s);
+	r.start_score = readVarint(s);
+	r.final_score = readVarint(s);
+	r.completed = readVarint(s);
+
+	uint32_t count = readVarint(s);
+	r.inputs.clear();
+	r.inputs.reserve(count);
+	for (uint32_t i = 0; i < count; ++i)
+		r.inputs.push_back(readVarint(s));
+	return true;
+}
+
+bool Replay::verify(const LevelSet &l, const ReplayRun &r, float speed,
+	std::string &problem)
+{
+	std::ostringstream why;
+	if (r.pack_hash != l.hash())
+	{
+		problem = "recorded with a different level pack";
+		return false;
+	}
+	if (r.tick_rate != P2_TICK_RATE)
+	{
+		why << "recorded at " << r.tick_rate << " ticks per second, not "
+			<< P2_TICK_RATE;
+		problem = why.str();
+		return false;
+	}
+	if (r.level >= l.size())
+	{
+		why << "level " << r.level << " does not exist";
+		problem = why.str();
+		return false;
+	}
+
+	// Mirror what InGame::update does with each tick
+	Simulation sim(l, r.level);
+	auto start = std::chrono::steady_clock::now();
+	uint32_t total = length(r);
+	for (auto i = r.inputs.cbegin(); i != r.inputs.cend(); ++i)
+	{
+		uint32_t ticks;
+		int direction;
+		untoken(*i, ticks, direction);
+
+		while (ticks--)
+		{
+			sim.tick(direction);
+			if (sim.complete() && sim.ticks() != total)
+			{
+				why << "level completed early, at tick " << sim.ticks()
+					<< " of " << total;
+				problem = why.str();
+				return false;
+			}
+		}
+
+		if (speed > 0.0f)
+		{
+			std::this_thread::sleep_until(start + std::chrono::microseconds(
+				(uint64_t)(sim.ticks() * (1000000.0f / P2_TICK_RATE) / speed)));
+		}
+	}
+
+	if (sim.complete() != r.completed)
+	{
+		problem = r.completed ? "level not completed" : "level completed";
+		return false;
+	}
+
+	uint32_t score = r.start_score + (sim.complete() ? sim.bonus() : 0);
+	if (score != r.final_score)
+	{
+		why << "final score " << score << ", recorded " << r.final_score;
+		problem = why.str();
+		return false;
+	}
+
+	return true;
+}
+
+int Replay::verifyFiles(const LevelSet &l,
+	const std::vector<std::string> &files, float speed, std::ostream &out)
+{
+	// What to say about each file, filled in by whichever thread
+	// checks it, and written out in order as soon as it can be
+	struct Result
+	{
+		std::string report;
+		bool passed;
+	};
+
+	int failures = 0;
+	ThreadPool pool;
+	pool.parallelInOrder<Result>(files.size(), [&](size_t f, Result &r) {
+		std::ostringstream result;
+		r.passed = false;
+		try
+		{
+			std::ifstream s;
+			s.exceptions(std::ios::badbit);
+			s.open(files[f].c_str(), std::ios_base::binary);
+			if (!s.is_open())
+				throw std::runtime_error("cannot open file");
+			readHeader(s);
+
+			ReplayRun run;
+			int runs = 0;
+			uint64_t ticks = 0;
+			std::string problem;
+			bool ok = true;
+			while (ok && readRun(s, run))
+			{
+				++runs;
+				ticks += length(run);
+				if (!verify(l, run, speed, problem))
+				{
+					result << "FAILED run " << runs << " (level "
+						<< run.level << "): " << problem;
+					ok = false;
+				}
+			}
+			if (ok)
+			{
+				result << "OK (" << runs << " runs, "
+					<< ticks << " ticks)";
+				r.passed = true;
+			}
+		}
+		catch (std::exception &e)
+		{
+			result << "FAILED: " << e.what();
+		}
+		r.report = result.str();
+	}, [&](size_t f, Result &r) {
+		out << files[f] << ": " << r.report << std::endl;
+		if (!r.passed)
+			++failures;
+	});
+	return failures;
+}
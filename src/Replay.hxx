@@ -0,0 +1,88 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HXX_REPLAY
+#define HXX_REPLAY
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <iostream>
+
+class LevelSet;
+
+// Recording of one attempt at one level: the direction key held on every
+// simulation tick.  The simulation is deterministic, so re-simulating
+// a run reproduces it exactly, whatever frame rate it was played at.
+struct ReplayRun
+{
+	uint32_t level;
+	uint32_t pack_hash;
+	uint32_t tick_rate;
+	uint32_t start_score;
+	uint32_t final_score;
+	bool completed;
+
+	// Run-length encoded input - see Replay::token()
+	std::vector<uint32_t> inputs;
+};
+
+namespace Replay
+{
+	// Stream to which every run in the session is written,
+	// or NULL if not recording.  Set up by main().
+	extern std::ostream *output;
+
+	// Pack a number of consecutive ticks with the same direction held
+	// into a token.  Direction is -1 if no key was held.
+	uint32_t token(uint32_t ticks, int direction);
+	void untoken(uint32_t token, uint32_t &ticks, int &direction);
+
+	// Append one tick to a run's input
+	void record(ReplayRun &r, int direction);
+
+	// Total ticks in a run's input
+	uint32_t length(const ReplayRun &r);
+
+	// Cut a run's input short after the given number of ticks,
+	// as when play is rewound
+	void truncate(ReplayRun &r, uint32_t ticks);
+
+	// Replay files are a short header followed by any number of runs.
+	// Everything but the pack hash is stored as LEB128 varints.
+	void writeHeader(std::ostream &s);
+	void writeRun(std::ostream &s, const ReplayRun &r);
+
+	// Throws std::runtime_error on malformed data.
+	// readRun returns false at a clean end of file.
+	void readHeader(std::istream &s);
+	bool readRun(std::istream &s, ReplayRun &r);
+
+	// Re-simulate a run without a display, checking that it ends the
+	// same way as it was recorded.  If speed is non-zero, playback is
+	// paced to that multiple of real time; otherwise it goes flat out.
+	// On mismatch, returns false and describes the problem.
+	bool verify(const LevelSet &l, const ReplayRun &r, float speed,
+		std::string &problem);
+
+	// Verify every run in every given file, spread across all cores,
+	// writing one line of results per file.  Returns number of failures.
+	int verifyFiles(const LevelSet &l, const std::vector<std::string> &files,
+		float speed, std::ostream &out);
+}
+
+#endif
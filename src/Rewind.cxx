@@ -0,0 +1,276 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <algorithm>
+#include <cstring>
+
+// System
+
+// Library
+
+// Local
+#include "Rewind.hxx"
+
+//
+// Implementation
+//
+
+// Extra flags in a record's copy of ObjectState::flags, saying which
+// optional fields follow.  Objects at rest are exactly on their square,
+// so their position needn't be stored, and boxes have no speed.
+#define REWIND_MOVING 0x40
+#define REWIND_SPEED 0x80
+
+// Largest possible record: header, every object moving, and lengths
+#define REWIND_MAX_RECORD (16 + (P2_MAX_SPRITES_PER_LEVEL * 28) + 4)
+
+namespace
+{
+	bool atRest(const ObjectState &s)
+	{
+		int32_t x = (s.x * P2_TILE_WIDTH) << P2_SUBPIXEL_SHIFT;
+		int32_t y = (s.y * P2_TILE_HEIGHT) << P2_SUBPIXEL_SHIFT;
+		return (s.pos_x == x && s.pos_y == y
+			&& s.prev_x == x && s.prev_y == y);
+	}
+
+	// Append a field to a record being built
+	template<typename T> void append(uint8_t *&p, T v)
+	{
+		memcpy(p, &v, sizeof(v));
+		p += sizeof(v);
+	}
+
+	template<typename T> T take(const uint8_t *&p)
+	{
+		T v;
+		memcpy(&v, p, sizeof(v));
+		p += sizeof(v);
+		return v;
+	}
+}
+
+Rewind::Rewind(const Simulation &sim, size_t bytes)
+	: m_ring(bytes), m_last(sim.numObjects())
+{
+	reset(sim);
+}
+
+void Rewind::reset(const Simulation &sim)
+{
+	m_head = 0;
+	m_tail = 0;
+	m_used = 0;
+	m_records = 0;
+	for (int i = 0; i < sim.numObjects(); ++i)
+		sim.saveObject(i, m_last[i]);
+	sim.saveCounters(m_last_counters);
+}
+
+void Rewind::put(const void *data, size_t length)
+{
+	const uint8_t *p = (const uint8_t*)data;
+	size_t first = std::min(length, m_ring.size() - m_head);
+	memcpy(&(m_ring[m_head]), p, first);
+	memcpy(&(m_ring[0]), p + first, length - first);
+	m_head = (m_head + length) % m_ring.size();
+	m_used += length;
+}
+
+void Rewind::get(size_t &pos, void *data, size_t length) const
+{
+	uint8_t *p = (uint8_t*)data;
+	size_t first = std::min(length, m_ring.size() - pos);
+	memcpy(p, &(m_ring[pos]), first);
+	memcpy(p + first, &(m_ring[0]), length - first);
+	pos = (pos + length) % m_ring.size();
+}
+
+uint16_t Rewind::lengthAt(size_t pos) const
+{
+	uint16_t length;
+	get(pos, &length, sizeof(length));
+	return length;
+}
+
+void Rewind::dropOldest()
+{
+	size_t length = lengthAt(m_tail) + (2 * sizeof(uint16_t));
+	m_tail = (m_tail + length) % m_ring.size();
+	m_used -= length;
+	--m_records;
+}
+
+void Rewind::record(const Simulation &sim)
+{
+	// Only record once something has changed square or been defused;
+	// anything else is part of a move already under way
+	int n = sim.numObjects();
+	bool moved = false;
+	for (int i = 0; i < n; ++i)
+	{
+		ObjectState &s = m_states[i];
+		sim.saveObject(i, s);
+		const ObjectState &l = m_last[i];
+		if (s.x != l.x || s.y != l.y
+			|| (s.flags & P2_OBJECT_DEFUSED) != (l.flags & P2_OBJECT_DEFUSED))
+			moved = true;
+	}
+	if (!moved)
+		return;
+
+	// Build the record: the counters and the earlier state of every
+	// object which differs, then bring m_last up to date
+	uint8_t record[REWIND_MAX_RECORD];
+	uint8_t *p = record + sizeof(uint16_t) + 1;
+	append<uint32_t>(p, m_last_counters.ticks);
+	append<uint16_t>(p, m_last_counters.tick_time);
+	append<int64_t>(p, m_last_counters.bonus_counter);
+	append<uint8_t>(p, m_last_counters.objects_left);
+	uint8_t count = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		const ObjectState &l = m_last[i];
+		if (m_states[i].sameAs(l))
+			continue;
+
+		bool moving = !atRest(l);
+		append<uint8_t>(p, i);
+		append<uint8_t>(p, l.x);
+		append<uint8_t>(p, l.y);
+		append<uint8_t>(p, l.flags | (moving ? REWIND_MOVING : 0)
+			| (l.speed ? REWIND_SPEED : 0));
+		append<uint8_t>(p, l.anim_index);
+		append<uint8_t>(p, l.anim_state);
+		append<uint16_t>(p, l.anim_frames);
+		if (moving)
+		{
+			append<int32_t>(p, l.pos_x);
+			append<int32_t>(p, l.pos_y);
+			append<int32_t>(p, l.prev_x);
+			append<int32_t>(p, l.prev_y);
+		}
+		if (l.speed)
+			append<int32_t>(p, l.speed);
+		++count;
+
+		m_last[i] = m_states[i];
+	}
+	record[sizeof(uint16_t)] = count;
+	sim.saveCounters(m_last_counters);
+
+	uint16_t body = (p - record) - sizeof(uint16_t);
+	memcpy(record, &body, sizeof(body));
+	append<uint16_t>(p, body);
+
+	// Make room, then add it to the ring
+	size_t length = p - record;
+	while (m_used + length > m_ring.size())
+		dropOldest();
+	put(record, length);
+	++m_records;
+}
+
+bool Rewind::step(Simulation &sim)
+{
+	int n = sim.numObjects();
+
+	// First go back to the last record point, if anything has
+	// happened since
+	uint8_t count = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		ObjectState s;
+		sim.saveObject(i, s);
+		if (!s.sameAs(m_last[i]))
+		{
+			m_indices[count] = i;
+			m_states[count] = m_last[i];
+			++count;
+		}
+	}
+	Simulation::Counters c;
+	sim.saveCounters(c);
+	if (count || !(c == m_last_counters))
+	{
+		sim.restore(count, m_indices, m_states, m_last_counters);
+		return true;
+	}
+
+	// Otherwise undo the newest record
+	if (!m_records)
+		return false;
+
+	uint16_t body = lengthAt((m_head + m_ring.size() - sizeof(uint16_t))
+		% m_ring.size());
+	size_t start = (m_head + m_ring.size() - body - sizeof(uint16_t))
+		% m_ring.size();
+	uint8_t record[REWIND_MAX_RECORD];
+	size_t pos = start;
+	get(pos, record, body);
+
+	const uint8_t *p = record;
+	count = take<uint8_t>(p);
+	c.ticks = take<uint32_t>(p);
+	c.tick_time = take<uint16_t>(p);
+	c.bonus_counter = take<int64_t>(p);
+	c.objects_left = take<uint8_t>(p);
+	for (int i = 0; i < count; ++i)
+	{
+		ObjectState &s = m_states[i];
+		m_indices[i] = take<uint8_t>(p);
+		s.x = take<uint8_t>(p);
+		s.y = take<uint8_t>(p);
+		uint8_t flags = take<uint8_t>(p);
+		s.flags = flags & ~(REWIND_MOVING | REWIND_SPEED);
+		s.anim_index = take<uint8_t>(p);
+		s.anim_state = take<uint8_t>(p);
+		s.anim_frames = take<uint16_t>(p);
+		if (flags & REWIND_MOVING)
+		{
+			s.pos_x = take<int32_t>(p);
+			s.pos_y = take<int32_t>(p);
+			s.prev_x = take<int32_t>(p);
+			s.prev_y = take<int32_t>(p);
+		}
+		else
+		{
+			s.pos_x = s.prev_x = (s.x * P2_TILE_WIDTH) << P2_SUBPIXEL_SHIFT;
+			s.pos_y = s.prev_y = (s.y * P2_TILE_HEIGHT) << P2_SUBPIXEL_SHIFT;
+		}
+		s.speed = (flags & REWIND_SPEED) ? take<int32_t>(p) : 0;
+		m_last[m_indices[i]] = s;
+	}
+	m_last_counters = c;
+	sim.restore(count, m_indices, m_states, c);
+
+	m_head = (start + m_ring.size() - sizeof(uint16_t)) % m_ring.size();
+	m_used -= body + (2 * sizeof(uint16_t));
+	--m_records;
+	return true;
+}
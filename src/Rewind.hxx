@@ -0,0 +1,94 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HXX_REWIND
+#define HXX_REWIND
+
+#include <vector>
+#include <cstdint>
+
+#include "Constants.hxx"
+#include "GameObjects.hxx"
+#include "Simulation.hxx"
+
+// Default size of the rewind history, enough for a couple of hundred moves
+#define P2_REWIND_BYTES 12288
+
+// History of a Simulation, for winding it back a move at a time.
+//
+// Every time an object changes square or lands on a cross, a record is
+// added holding what has changed since the previous one: the earlier
+// state of only those objects whose state differs, plus the counters.
+// Each record is an undo step from one point to the one before, so going
+// back costs only as much as the move being undone, and no full copies
+// of the level are ever needed - the live Simulation is the keyframe.
+//
+// Records live in a ring of fixed size, allocated up front along with
+// everything else, so that nothing is allocated during play; once the
+// ring is full, the oldest records are forgotten to make room.
+class Rewind
+{
+	public:
+		Rewind(const Simulation &sim, size_t bytes = P2_REWIND_BYTES);
+
+		// Forget all history, starting again from the given state
+		void reset(const Simulation &sim);
+
+		// Call after every tick, to add a record if anything has moved
+		void record(const Simulation &sim);
+
+		// Wind back to the last record point, or if already there,
+		// to the one before.  Returns false if there was nothing left
+		// to go back to, in which case nothing changes.
+		bool step(Simulation &sim);
+
+		// Bytes of history held, and how many records
+		size_t used() const
+		{
+			return m_used;
+		};
+		int records() const
+		{
+			return m_records;
+		};
+
+	private:
+		// Ring of records, each framed by its length at both ends so
+		// that the newest can be popped and the oldest dropped
+		std::vector<uint8_t> m_ring;
+		size_t m_head;
+		size_t m_tail;
+		size_t m_used;
+		int m_records;
+
+		// State as of the newest record point
+		std::vector<ObjectState> m_last;
+		Simulation::Counters m_last_counters;
+
+		// Scratch space for changed objects
+		uint8_t m_indices[P2_MAX_SPRITES_PER_LEVEL];
+		ObjectState m_states[P2_MAX_SPRITES_PER_LEVEL];
+
+		// Ring access, wrapping round the end
+		void put(const void *data, size_t length);
+		void get(size_t &pos, void *data, size_t length) const;
+		uint16_t lengthAt(size_t pos) const;
+		void dropOldest();
+};
+
+#endif
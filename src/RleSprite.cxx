@@ -0,0 +1,188 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <algorithm>
+#include <cstring>
+
+// System
+
+// Library
+#include <SDL.h>
+
+// Local
+#include "RleSprite.hxx"
+#include "Pixels.hxx"
+
+//
+// Implementation
+//
+
+RleSprite::RleSprite(SDL_Surface *source)
+	: m_source(source), m_x(0), m_y(0), m_w(0), m_h(0),
+	  m_bpp(0), m_rmask(0), m_gmask(0), m_bmask(0)
+{
+	// Find the bounding box of the opaque pixels
+	if (SDL_MUSTLOCK(source))
+		SDL_LockSurface(source);
+	const SDL_PixelFormat *f = source->format;
+	int left = source->w, right = -1, top = source->h, bottom = -1;
+	for (int y = 0; y < source->h; ++y)
+	{
+		const uint8_t *row = (const uint8_t*)(source->pixels) + (y * source->pitch);
+		for (int x = 0; x < source->w; ++x)
+		{
+			if (loadPixel(row + (x * f->BytesPerPixel), f->BytesPerPixel)
+				== f->colorkey)
+				continue;
+			left = std::min(left, x);
+			right = std::max(right, x);
+			top = std::min(top, y);
+			bottom = std::max(bottom, y);
+		}
+	}
+	if (SDL_MUSTLOCK(source))
+		SDL_UnlockSurface(source);
+
+	// Entirely transparent sprites are left empty
+	if (right >= 0)
+	{
+		m_x = left;
+		m_y = top;
+		m_w = (right - left) + 1;
+		m_h = (bottom - top) + 1;
+	}
+}
+
+bool RleSprite::encodedFor(const SDL_PixelFormat *format) const
+{
+	return (m_bpp == format->BytesPerPixel && m_rmask == format->Rmask
+		&& m_gmask == format->Gmask && m_bmask == format->Bmask);
+}
+
+void RleSprite::encode(const SDL_PixelFormat *format) const
+{
+	m_runs.clear();
+	m_rows.clear();
+	m_pixels.clear();
+	m_bpp = format->BytesPerPixel;
+	m_rmask = format->Rmask;
+	m_gmask = format->Gmask;
+	m_bmask = format->Bmask;
+
+	if (SDL_MUSTLOCK(m_source))
+		SDL_LockSurface(m_source);
+	const SDL_PixelFormat *f = m_source->format;
+	for (int y = 0; y < m_h; ++y)
+	{
+		m_rows.push_back(m_runs.size());
+		const uint8_t *row = (const uint8_t*)(m_source->pixels)
+			+ ((m_y + y) * m_source->pitch) + (m_x * f->BytesPerPixel);
+		bool in_run = false;
+		for (int x = 0; x < m_w; ++x)
+		{
+			uint32_t v = loadPixel(row + (x * f->BytesPerPixel), f->BytesPerPixel);
+			if (v == f->colorkey)
+			{
+				in_run = false;
+				continue;
+			}
+			if (!in_run)
+			{
+				Run r = { (uint16_t)x, 0, (uint32_t)(m_pixels.size()) };
+				m_runs.push_back(r);
+				in_run = true;
+			}
+			++(m_runs.back().length);
+
+			Uint8 red, green, blue;
+			SDL_GetRGB(v, f, &red, &green, &blue);
+			m_pixels.resize(m_pixels.size() + m_bpp);
+			storePixel(&(m_pixels[m_pixels.size() - m_bpp]),
+				SDL_MapRGB(format, red, green, blue), m_bpp);
+		}
+	}
+	m_rows.push_back(m_runs.size());
+	if (SDL_MUSTLOCK(m_source))
+		SDL_UnlockSurface(m_source);
+}
+
+void RleSprite::blit(SDL_Surface *dest, int x, int y) const
+{
+	if (!m_w)
+		return;
+	if (SDL_MUSTLOCK(dest) && SDL_LockSurface(dest) < 0)
+		return;
+
+	blit((uint8_t*)(dest->pixels), dest->pitch, dest->format,
+		dest->clip_rect, x, y);
+
+	if (SDL_MUSTLOCK(dest))
+		SDL_UnlockSurface(dest);
+}
+
+void RleSprite::blit(uint8_t *pixels, int pitch,
+	const SDL_PixelFormat *format, const SDL_Rect &clip, int x, int y) const
+{
+	if (!m_w)
+		return;
+	if (!encodedFor(format))
+		encode(format);
+
+	// Work out which rows, and which columns within each row, fall
+	// inside the clip rectangle, relative to the trimmed sprite
+	int left = x + m_x;
+	int top = y + m_y;
+	int first_row = std::max(0, clip.y - top);
+	int end_row = std::min(m_h, (clip.y + clip.h) - top);
+	int clip_left = clip.x - left;
+	int clip_right = (clip.x + clip.w) - left;
+	if (first_row >= end_row || clip_right <= 0 || clip_left >= m_w)
+		return;
+
+	for (int r = first_row; r < end_row; ++r)
+	{
+		uint8_t *line = pixels + ((top + r) * pitch);
+		for (uint32_t i = m_rows[r]; i < m_rows[r + 1]; ++i)
+		{
+			const Run &run = m_runs[i];
+			int start = run.x;
+			int end = run.x + run.length;
+			int skip = 0;
+			if (start < clip_left)
+			{
+				skip = clip_left - start;
+				start = clip_left;
+			}
+			if (end > clip_right)
+				end = clip_right;
+			if (start >= end)
+				continue;
+			memcpy(line + ((left + start) * m_bpp),
+				&(m_pixels[run.offset + (skip * m_bpp)]), (end - start) * m_bpp);
+		}
+	}
+}
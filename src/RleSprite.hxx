@@ -0,0 +1,113 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HXX_RLESPRITE
+#define HXX_RLESPRITE
+
+#include <vector>
+#include <cstdint>
+
+struct SDL_Surface;
+struct SDL_PixelFormat;
+struct SDL_Rect;
+
+// A colour-keyed sprite, trimmed to the bounding box of its opaque pixels
+// and stored as runs of opaque pixels along each row, so that drawing it
+// copies only those instead of testing every pixel against the colour key.
+//
+// Runs are stored in the pixel format of the surface last drawn to, and
+// re-encoded from the source surface whenever that changes, so drawing
+// to surfaces of different formats in turn is slow.  Not thread safe.
+class RleSprite
+{
+	public:
+		// Source must have a colour key set, and must outlive us
+		explicit RleSprite(SDL_Surface *source);
+
+		// Encode the runs in the given format now, rather than on
+		// first being drawn to a surface of that format
+		void prepare(const SDL_PixelFormat *format) const
+		{
+			if (!encodedFor(format))
+				encode(format);
+		};
+
+		// Draw with the top left corner of the untrimmed sprite at (x, y),
+		// clipped to the destination's clip rectangle
+		void blit(SDL_Surface *dest, int x, int y) const;
+
+		// As above, but into already locked pixels in the given format,
+		// clipped to the given rectangle.  Several threads may draw the
+		// same sprite at once this way, so long as it has already been
+		// prepared for the format.
+		void blit(uint8_t *pixels, int pitch, const SDL_PixelFormat *format,
+			const SDL_Rect &clip, int x, int y) const;
+
+		// Opaque bounding box, relative to the untrimmed sprite
+		int trimX() const
+		{
+			return m_x;
+		};
+
+		int trimY() const
+		{
+			return m_y;
+		};
+
+		int trimWidth() const
+		{
+			return m_w;
+		};
+
+		int trimHeight() const
+		{
+			return m_h;
+		};
+
+	private:
+		struct Run
+		{
+			// Start within the trimmed row, length in pixels, and offset
+			// of the run's first pixel in m_pixels, in bytes
+			uint16_t x;
+			uint16_t length;
+			uint32_t offset;
+		};
+
+		bool encodedFor(const SDL_PixelFormat *format) const;
+		void encode(const SDL_PixelFormat *format) const;
+
+		SDL_Surface *m_source;
+		int m_x;
+		int m_y;
+		int m_w;
+		int m_h;
+
+		// Runs for each trimmed row: row r has runs m_rows[r] up to (but
+		// not including) m_rows[r + 1]
+		mutable std::vector<Run> m_runs;
+		mutable std::vector<uint32_t> m_rows;
+		mutable std::vector<uint8_t> m_pixels;
+
+		// Format the pixels are currently encoded in
+		mutable int m_bpp;
+		mutable uint32_t m_rmask;
+		mutable uint32_t m_gmask;
+		mutable uint32_t m_bmask;
+};
+
+#endif
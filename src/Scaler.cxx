@@ -0,0 +1,283 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <cstring>
+
+// System
+#if defined(__SSE2__) || defined(_M_X64)
+#	include <emmintrin.h>
+#	define P2_SSE2 1
+#endif
+
+// Library
+
+// Local
+#include "Scaler.hxx"
+#include "Pixels.hxx"
+#include "ThreadPool.hxx"
+
+//
+// Implementation
+//
+
+Scaler::Scaler(int factor, Filter filter, ThreadPool *pool)
+	: m_factor(factor), m_filter(filter), m_pool(pool)
+{
+}
+
+bool Scaler::supports(int factor, Filter filter)
+{
+	if (factor < 1)
+		return false;
+	if (filter == Scale2x)
+		return (factor == 2 || factor == 4);
+	return true;
+}
+
+#ifdef P2_SSE2
+// Store a vector to the same place in each of the given number of rows.
+// The output is far bigger than any cache, and isn't read back before
+// it goes to the screen, so write around the cache where alignment allows.
+static inline void storeRows(uint8_t *dest, int pitch, int rows, __m128i v,
+	bool aligned)
+{
+	for (int i = 0; i < rows; ++i, dest += pitch)
+	{
+		if (aligned)
+			_mm_stream_si128((__m128i*)dest, v);
+		else
+			_mm_storeu_si128((__m128i*)dest, v);
+	}
+}
+#endif
+
+// Widen one row by the given factor, writing the result to that many
+// rows of the destination
+static void widenRow(const uint8_t *src, uint8_t *dest, int dest_pitch,
+	int w, int bpp, int factor)
+{
+	int x = 0;
+#ifdef P2_SSE2
+	bool aligned = ((((uintptr_t)dest) | (uintptr_t)dest_pitch) & 15) == 0;
+	if (bpp == 4 && factor == 2)
+	{
+		for (; x + 4 <= w; x += 4)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(src + (x * 4)));
+			uint8_t *d = dest + (x * 8);
+			storeRows(d, dest_pitch, 2, _mm_unpacklo_epi32(v, v), aligned);
+			storeRows(d + 16, dest_pitch, 2, _mm_unpackhi_epi32(v, v), aligned);
+		}
+	}
+	else if (bpp == 4 && factor == 4)
+	{
+		for (; x + 4 <= w; x += 4)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(src + (x * 4)));
+			uint8_t *d = dest + (x * 16);
+			storeRows(d, dest_pitch, 4, _mm_shuffle_epi32(v, 0x00), aligned);
+			storeRows(d + 16, dest_pitch, 4, _mm_shuffle_epi32(v, 0x55), aligned);
+			storeRows(d + 32, dest_pitch, 4, _mm_shuffle_epi32(v, 0xaa), aligned);
+			storeRows(d + 48, dest_pitch, 4, _mm_shuffle_epi32(v, 0xff), aligned);
+		}
+	}
+	else if (bpp == 2 && factor == 2)
+	{
+		for (; x + 8 <= w; x += 8)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(src + (x * 2)));
+			uint8_t *d = dest + (x * 4);
+			storeRows(d, dest_pitch, 2, _mm_unpacklo_epi16(v, v), aligned);
+			storeRows(d + 16, dest_pitch, 2, _mm_unpackhi_epi16(v, v), aligned);
+		}
+	}
+	else if (bpp == 2 && factor == 4)
+	{
+		for (; x + 8 <= w; x += 8)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(src + (x * 2)));
+			__m128i lo = _mm_unpacklo_epi16(v, v);
+			__m128i hi = _mm_unpackhi_epi16(v, v);
+			uint8_t *d = dest + (x * 8);
+			storeRows(d, dest_pitch, 4, _mm_unpacklo_epi32(lo, lo), aligned);
+			storeRows(d + 16, dest_pitch, 4, _mm_unpackhi_epi32(lo, lo), aligned);
+			storeRows(d + 32, dest_pitch, 4, _mm_unpacklo_epi32(hi, hi), aligned);
+			storeRows(d + 48, dest_pitch, 4, _mm_unpackhi_epi32(hi, hi), aligned);
+		}
+	}
+	if (x == w)
+		return;
+#endif
+
+	// Whatever is left, or everything if there's no SIMD path:
+	// widen into the first row, then copy it down
+	for (int i = x; i < w; ++i)
+	{
+		const uint8_t *p = src + (i * bpp);
+		uint8_t *d = dest + (i * bpp * factor);
+		for (int j = 0; j < factor; ++j)
+			memcpy(d + (j * bpp), p, bpp);
+	}
+	for (int i = 1; i < factor; ++i)
+	{
+		memcpy(dest + (i * dest_pitch) + (x * bpp * factor),
+			dest + (x * bpp * factor), (w - x) * bpp * factor);
+	}
+}
+
+void Scaler::nearest(const uint8_t *src, int src_pitch,
+	uint8_t *dest, int dest_pitch, int w, int h, int bpp, int factor)
+{
+	for (int y = 0; y < h; ++y)
+	{
+		widenRow(src + (y * src_pitch), dest + (y * factor * dest_pitch),
+			dest_pitch, w, bpp, factor);
+	}
+#ifdef P2_SSE2
+	_mm_sfence();
+#endif
+}
+
+void Scaler::scale2x(const uint8_t *src, int src_pitch,
+	uint8_t *dest, int dest_pitch, int w, int h, int bpp,
+	int first_row, int end_row)
+{
+	// Each pixel E becomes four, taking the colour of a neighbour
+	// wherever two neighbours agree on an edge running past it:
+	//
+	//    A B C       E0 E1
+	//    D E F  ->   E2 E3
+	//    G H I
+	//
+	// Pixels beyond the edges of the frame repeat those on it.
+	// Only rows [first_row, end_row) of the source are scaled, but
+	// those either side may be read.
+	for (int y = first_row; y < end_row; ++y)
+	{
+		const uint8_t *row = src + (y * src_pitch);
+		const uint8_t *above = (y > 0) ? row - src_pitch : row;
+		const uint8_t *below = (y < h - 1) ? row + src_pitch : row;
+		uint8_t *out0 = dest + (y * 2 * dest_pitch);
+		uint8_t *out1 = out0 + dest_pitch;
+		for (int x = 0; x < w; ++x)
+		{
+			int left = (x > 0) ? x - 1 : x;
+			int right = (x < w - 1) ? x + 1 : x;
+			uint32_t b = loadPixel(above + (x * bpp), bpp);
+			uint32_t d = loadPixel(row + (left * bpp), bpp);
+			uint32_t e = loadPixel(row + (x * bpp), bpp);
+			uint32_t f = loadPixel(row + (right * bpp), bpp);
+			uint32_t hh = loadPixel(below + (x * bpp), bpp);
+
+			uint32_t e0 = e, e1 = e, e2 = e, e3 = e;
+			if (b != hh && d != f)
+			{
+				if (d == b)
+					e0 = d;
+				if (b == f)
+					e1 = f;
+				if (d == hh)
+					e2 = d;
+				if (hh == f)
+					e3 = f;
+			}
+			storePixel(out0 + (x * 2 * bpp), e0, bpp);
+			storePixel(out0 + (((x * 2) + 1) * bpp), e1, bpp);
+			storePixel(out1 + (x * 2 * bpp), e2, bpp);
+			storePixel(out1 + (((x * 2) + 1) * bpp), e3, bpp);
+		}
+	}
+}
+
+void Scaler::scale(SDL_Surface *src, SDL_Surface *dest)
+{
+	if (SDL_MUSTLOCK(src) && SDL_LockSurface(src) < 0)
+		return;
+	if (SDL_MUSTLOCK(dest) && SDL_LockSurface(dest) < 0)
+	{
+		if (SDL_MUSTLOCK(src))
+			SDL_UnlockSurface(src);
+		return;
+	}
+
+	int bpp = src->format->BytesPerPixel;
+	const uint8_t *in = (const uint8_t*)(src->pixels);
+	uint8_t *out = (uint8_t*)(dest->pixels);
+	int w = src->w;
+	int h = src->h;
+	int src_pitch = src->pitch;
+	int dest_pitch = dest->pitch;
+	int factor = m_factor;
+	if (m_filter == Nearest)
+	{
+		bands(h, [=](size_t first, size_t end) {
+			nearest(in + (first * src_pitch), src_pitch,
+				out + (first * factor * dest_pitch), dest_pitch,
+				w, end - first, bpp, factor);
+		});
+	}
+	else if (m_factor == 2)
+	{
+		bands(h, [=](size_t first, size_t end) {
+			scale2x(in, src_pitch, out, dest_pitch, w, h, bpp, first, end);
+		});
+	}
+	else
+	{
+		// Scale2x twice, via an intermediate 2x image.  The second
+		// pass reads rows either side of each band from the first,
+		// so can't start until the first is finished.
+		int pitch = w * 2 * bpp;
+		m_buffer.resize(pitch * h * 2);
+		uint8_t *buffer = &(m_buffer[0]);
+		bands(h, [=](size_t first, size_t end) {
+			scale2x(in, src_pitch, buffer, pitch, w, h, bpp, first, end);
+		});
+		bands(h * 2, [=](size_t first, size_t end) {
+			scale2x(buffer, pitch, out, dest_pitch, w * 2, h * 2, bpp,
+				first, end);
+		});
+	}
+
+	if (SDL_MUSTLOCK(dest))
+		SDL_UnlockSurface(dest);
+	if (SDL_MUSTLOCK(src))
+		SDL_UnlockSurface(src);
+}
+
+void Scaler::bands(int rows, const std::function<void(size_t, size_t)> &fn)
+{
+	if (!m_pool)
+	{
+		fn(0, rows);
+		return;
+	}
+
+	// Two bands per thread, so that none is left idle for long
+	size_t count = m_pool->size() * 2;
+	m_pool->parallelFor(rows, (rows + count - 1) / count, fn);
+}
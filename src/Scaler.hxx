@@ -0,0 +1,76 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HXX_SCALER
+#define HXX_SCALER
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+#include <SDL.h>
+
+class ThreadPool;
+
+// Enlarges a whole frame by a whole number factor in one pass, for
+// running in a window bigger than the game's native 640*384.  Frames are
+// composed at native size, so drawing costs no more at any scale; only
+// this pass grows with the output size, and it is a single streaming
+// copy.  Nearest neighbour uses SSE2 where available for 16 and 32 bpp.
+// Given a ThreadPool, the frame is scaled in bands across its threads.
+class Scaler
+{
+	public:
+		enum Filter
+		{
+			// Blocky, exactly like the original pixels
+			Nearest,
+
+			// Scale2x edge smoothing - factors 2 and 4 only
+			Scale2x
+		};
+
+		// The pool, if given, must outlive us
+		Scaler(int factor, Filter filter, ThreadPool *pool = NULL);
+
+		// Can the given filter scale by the given factor?
+		static bool supports(int factor, Filter filter);
+
+		// Scale all of src into dest, which must be in the same format
+		// and at least factor times the size
+		void scale(SDL_Surface *src, SDL_Surface *dest);
+
+	private:
+		static void nearest(const uint8_t *src, int src_pitch,
+			uint8_t *dest, int dest_pitch, int w, int h, int bpp, int factor);
+		static void scale2x(const uint8_t *src, int src_pitch,
+			uint8_t *dest, int dest_pitch, int w, int h, int bpp,
+			int first_row, int end_row);
+
+		// Call fn(first_row, end_row) over bands of [0, rows), on the
+		// pool if there is one
+		void bands(int rows, const std::function<void(size_t, size_t)> &fn);
+
+		int m_factor;
+		Filter m_filter;
+		ThreadPool *m_pool;
+
+		// Intermediate 2x image for scaling by 4 with Scale2x
+		std::vector<uint8_t> m_buffer;
+};
+
+#endif
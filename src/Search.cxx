@@ -0,0 +1,352 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <algorithm>
+
+// System
+
+// Library
+
+// Local
+#include "Search.hxx"
+
+//
+// Implementation
+//
+
+// Starting size of the table of positions seen; must be a power of 2
+#define SEARCH_TABLE_SIZE 1024
+
+namespace
+{
+	const Direction all_directions[4] = { Left, Right, Up, Down };
+	const Direction opposite[4] = { Right, Left, Down, Up };
+}
+
+Search::Search(size_t max_states)
+	: m_board(NULL), m_max_states(max_states), m_backwards(false),
+	  m_keep_edges(false), m_dropped(false), m_stamp(0)
+{
+}
+
+void Search::reset(const Board &b, bool backwards, bool edges)
+{
+	m_board = &b;
+	m_backwards = backwards;
+	m_keep_edges = edges;
+	m_dropped = false;
+	m_nodes.clear();
+	m_edge_start.assign(1, 0);
+	m_edges.clear();
+	m_open.clear();
+
+	// Tables left big by a previous search are kept, so
+	// that searches one after another don't keep growing them
+	Slot empty = { 0, 0 };
+	m_table.assign(std::max(m_table.size(), (size_t)SEARCH_TABLE_SIZE), empty);
+
+	const int squares = b.numSquares();
+	m_floor_neighbours.resize(squares * 4);
+	for (int i = 0; i < squares; ++i)
+	{
+		for (int d = 0; d < 4; ++d)
+		{
+			int n = b.neighbour(i, all_directions[d]);
+			m_floor_neighbours[(i * 4) + d] = (n >= 0 && b.isFloor(n)) ? n : -1;
+		}
+	}
+	m_grid.resize(squares);
+	m_marks.assign(squares, 0);
+	m_stamp = 0;
+	m_stack.resize(squares);
+}
+
+void Search::start(const Board::State &s)
+{
+	add(s, 0, 0);
+}
+
+void Search::run()
+{
+	for (uint32_t i = 0; i < m_nodes.size(); ++i)
+		expand(i);
+}
+
+int Search::reach(int player, const uint8_t *grid)
+{
+	if (++m_stamp == 0)
+	{
+		// Stamp wrapped around - clear out stale marks
+		std::fill(m_marks.begin(), m_marks.end(), 0);
+		m_stamp = 1;
+	}
+
+	// This is where searches spend most of their time, so the stack
+	// is big enough for every square, and only floor is looked at
+	int lowest = player;
+	int count = 0;
+	m_stack[count++] = player;
+	m_marks[player] = m_stamp;
+	while (count)
+	{
+		int sq = m_stack[--count];
+		if (sq < lowest)
+			lowest = sq;
+		const int32_t *n = &(m_floor_neighbours[sq * 4]);
+		for (int d = 0; d < 4; ++d)
+		{
+			if (n[d] >= 0 && m_marks[n[d]] != m_stamp
+				&& grid[n[d]] == Board::NoPiece)
+			{
+				m_marks[n[d]] = m_stamp;
+				m_stack[count++] = n[d];
+			}
+		}
+	}
+	return lowest;
+}
+
+int64_t Search::add(Board::State s, uint32_t parent, uint16_t depth)
+{
+	const Board &b = *m_board;
+	b.normalise(s);
+	b.occupancy(s, &(m_grid[0]));
+	s.player = reach(s.player, &(m_grid[0]));
+
+	uint32_t hash = Board::StateHash()(s);
+	size_t mask = m_table.size() - 1;
+	size_t slot = hash & mask;
+	for (; m_table[slot].node; slot = (slot + 1) & mask)
+	{
+		if (m_table[slot].hash == hash
+			&& m_nodes[m_table[slot].node - 1].state == s)
+			return m_table[slot].node - 1;
+	}
+	if (m_nodes.size() >= m_max_states)
+	{
+		m_dropped = true;
+		return -1;
+	}
+
+	uint32_t index = m_nodes.size();
+	m_table[slot].hash = hash;
+	m_table[slot].node = index + 1;
+	Node n = { s, parent, depth };
+	m_nodes.push_back(n);
+	m_open.push_back(false);
+
+	// Keep the table no more than half full
+	if (m_nodes.size() * 2 > m_table.size())
+		grow();
+	return index;
+}
+
+void Search::grow()
+{
+	std::vector<Slot> old(m_table.size() * 2);
+	old.swap(m_table);
+	size_t mask = m_table.size() - 1;
+	for (auto i = old.begin(); i != old.end(); ++i)
+	{
+		if (!i->node)
+			continue;
+		size_t slot = i->hash & mask;
+		while (m_table[slot].node)
+			slot = (slot + 1) & mask;
+		m_table[slot] = *i;
+	}
+}
+
+void Search::expand(uint32_t node)
+{
+	// Work out every position first, as adding them reuses
+	// the occupancy grid and marks
+	const Board &b = *m_board;
+	const Board::State s = m_nodes[node].state;
+	uint16_t depth = m_nodes[node].depth + 1;
+	if (!m_backwards)
+	{
+		for (int i = 0; i < b.numObjects(); ++i)
+		{
+			if (b.isDead(s.objects[i]))
+			{
+				if (m_keep_edges)
+					m_edge_start.push_back(m_edges.size());
+				return;
+			}
+		}
+	}
+	uint8_t *grid = &(m_grid[0]);
+	b.occupancy(s, grid);
+	reach(s.player, grid);
+	auto empty = [&](int sq) {
+		return (sq >= 0 && b.isFloor(sq) && grid[sq] == Board::NoPiece);
+	};
+
+	m_children.clear();
+	for (int i = 0; i < b.numObjects(); ++i)
+	{
+		int o = s.objects[i];
+		Board::Piece p = b.pieceAt(i);
+		for (int d = 0; d < 4; ++d)
+		{
+			Direction dir = all_directions[d];
+			Direction back = opposite[d];
+			if (!m_backwards)
+			{
+				int behind = b.neighbour(o, back);
+				if (behind < 0 || !reachable(behind))
+					continue;
+				int dest = b.pushDestination(grid, o, p, dir);
+				if (dest < 0)
+					continue;
+				Board::State c = s;
+				c.objects[i] = dest;
+				c.player = o;
+				m_children.push_back(c);
+			}
+			else if (p == Board::BoxPiece)
+			{
+				// Pull: the player stands next to the box and steps
+				// away from it, so that a push the other way undoes it
+				int from = b.neighbour(o, back);
+				if (from < 0 || !reachable(from))
+					continue;
+				int to = b.neighbour(from, back);
+				if (!empty(to))
+					continue;
+				Board::State c = s;
+				c.objects[i] = from;
+				c.player = to;
+				m_children.push_back(c);
+			}
+			else
+			{
+				// A ball pushed this way would only have stopped here
+				// if the way on is blocked.  It may have been pushed
+				// from any free square back along the line, leaving the
+				// player standing there, so long as the player could
+				// get behind.
+				if (empty(b.neighbour(o, dir)))
+					continue;
+				for (int from = b.neighbour(o, back); empty(from);
+					from = b.neighbour(from, back))
+				{
+					int behind = b.neighbour(from, back);
+					if (!reachable(from) || !empty(behind))
+						continue;
+					Board::State c = s;
+					c.objects[i] = from;
+					c.player = behind;
+					m_children.push_back(c);
+				}
+			}
+		}
+	}
+
+	for (auto i = m_children.begin(); i != m_children.end(); ++i)
+	{
+		int64_t child = add(*i, node, depth);
+		if (child < 0)
+			m_open[node] = true;
+		else if (m_keep_edges)
+			m_edges.push_back(child);
+	}
+	if (m_keep_edges)
+		m_edge_start.push_back(m_edges.size());
+}
+
+int Search::branching(const Board::State &s)
+{
+	const Board &b = *m_board;
+	uint8_t *grid = &(m_grid[0]);
+	b.occupancy(s, grid);
+	reach(s.player, grid);
+
+	int count = 0;
+	for (int i = 0; i < b.numObjects(); ++i)
+	{
+		int o = s.objects[i];
+		for (int d = 0; d < 4; ++d)
+		{
+			int behind = b.neighbour(o, opposite[d]);
+			if (behind < 0 || !reachable(behind))
+				continue;
+			int dest = b.pushDestination(grid, o, b.pieceAt(i),
+				all_directions[d]);
+			if (dest >= 0 && !b.isDead(dest))
+				++count;
+		}
+	}
+	return count;
+}
+
+bool Search::walk(const Board::State &s, int from, int to,
+	std::vector<Direction> &steps)
+{
+	const Board &b = *m_board;
+	uint8_t *grid = &(m_grid[0]);
+	b.occupancy(s, grid);
+
+	// Breadth first from the destination, so that following the
+	// distances from the start leads straight there
+	std::vector<uint16_t> dist(b.numSquares(), 0xffff);
+	std::vector<int> queue(1, to);
+	dist[to] = 0;
+	for (size_t head = 0; head < queue.size(); ++head)
+	{
+		int sq = queue[head];
+		const int32_t *n = &(m_floor_neighbours[sq * 4]);
+		for (int d = 0; d < 4; ++d)
+		{
+			if (n[d] >= 0 && dist[n[d]] == 0xffff
+				&& grid[n[d]] == Board::NoPiece)
+			{
+				dist[n[d]] = dist[sq] + 1;
+				queue.push_back(n[d]);
+			}
+		}
+	}
+	if (dist[from] == 0xffff)
+		return false;
+
+	for (int sq = from; sq != to;)
+	{
+		for (int d = 0; d < 4; ++d)
+		{
+			int n = b.neighbour(sq, all_directions[d]);
+			if (n >= 0 && dist[n] == dist[sq] - 1)
+			{
+				steps.push_back(all_directions[d]);
+				sq = n;
+				break;
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,156 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HXX_SEARCH
+#define HXX_SEARCH
+
+#include <vector>
+#include <cstdint>
+
+#include "Board.hxx"
+
+// Breadth-first search through the positions of a level, a push at a
+// time.  Searching forwards goes from the level's start; searching
+// backwards goes from positions with everything on crosses, pulling
+// boxes and rolling balls back up the lines they could have rolled
+// down.  Either way, positions are found in order of the number of
+// pushes between them and where the search started, so every
+// position's count is the least possible.
+//
+// Unlike Solver, which looks for any solution as quickly as it can,
+// this visits everything, so it is for tools rather than for play.
+class Search
+{
+	public:
+		struct Node
+		{
+			// Objects sorted, and the player moved to the lowest
+			// numbered square it can walk to
+			Board::State state;
+			uint32_t parent;
+			uint16_t depth;
+		};
+
+		// Searches stop adding positions once this many are found
+		explicit Search(size_t max_states);
+
+		// Start again on the given board.  If edges are kept, every
+		// push found is recorded, including those leading to positions
+		// already seen.
+		void reset(const Board &b, bool backwards, bool edges = false);
+
+		// Add a position to search from, if not already seen
+		void start(const Board::State &s);
+
+		// Search breadth first until there is nothing left
+		void run();
+
+		// True if no position was left out for want of room
+		bool exhausted() const
+		{
+			return !m_dropped;
+		};
+
+		const std::vector<Node> &nodes() const
+		{
+			return m_nodes;
+		};
+
+		// Positions one push on from the given one, if edges are kept.
+		// Open positions had some of theirs left out for want of room.
+		const uint32_t *edgesBegin(uint32_t node) const
+		{
+			return m_edges.data() + m_edge_start[node];
+		};
+
+		const uint32_t *edgesEnd(uint32_t node) const
+		{
+			return m_edges.data() + m_edge_start[node + 1];
+		};
+
+		bool open(uint32_t node) const
+		{
+			return m_open[node];
+		};
+
+		// Flood-fill the squares the player can walk to, marking them
+		// with a new stamp.  Returns the lowest square.
+		int reach(int player, const uint8_t *grid);
+
+		bool reachable(int square) const
+		{
+			return (m_marks[square] == m_stamp);
+		};
+
+		// Number of pushes from a position which don't leave
+		// an object in a corner
+		int branching(const Board::State &s);
+
+		// Steps for the player to walk between two squares without
+		// pushing anything, if it can
+		bool walk(const Board::State &s, int from, int to,
+			std::vector<Direction> &steps);
+
+	private:
+		// Queue a position if it hasn't been seen, returning its
+		// index, or -1 if there is no room for it
+		int64_t add(Board::State s, uint32_t parent, uint16_t depth);
+
+		// Queue every position one push, or pull, on from this one.
+		// Going forwards, positions with anything stuck in a corner
+		// are dead ends, so aren't expanded.
+		void expand(uint32_t node);
+
+		// Make the table of positions seen twice as big
+		void grow();
+
+		const Board *m_board;
+		size_t m_max_states;
+		bool m_backwards;
+		bool m_keep_edges;
+		bool m_dropped;
+
+		std::vector<Node> m_nodes;
+
+		// Positions seen, as a hash table with open addressing,
+		// holding each position's hash and its index plus one.
+		// Zero marks an empty slot.
+		struct Slot
+		{
+			uint32_t hash;
+			uint32_t node;
+		};
+		std::vector<Slot> m_table;
+
+		std::vector<uint32_t> m_edge_start;
+		std::vector<uint32_t> m_edges;
+		std::vector<bool> m_open;
+
+		// For each square, the squares next to it which are
+		// floor, or -1, in the order of Direction
+		std::vector<int32_t> m_floor_neighbours;
+
+		// Scratch space, sized to the board
+		std::vector<uint8_t> m_grid;
+		std::vector<uint32_t> m_marks;
+		uint32_t m_stamp;
+		std::vector<int> m_stack;
+		std::vector<Board::State> m_children;
+};
+
+#endif
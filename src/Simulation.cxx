@@ -0,0 +1,323 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+
+// System
+
+// Library
+
+// Local
+#include "Simulation.hxx"
+#include "GameObjects.hxx"
+
+//
+// Implementation
+//
+
+// Hundredths of a bonus point per second
+#define BONUS_COUNTER_RATE 905
+
+// Frame rates at which the self-test runs
+static const int selftest_rates[] = {30, 60, 240};
+
+// Length of the self-test input for each level
+#define SELFTEST_SECONDS 60
+
+// Self-test keys change only at whole multiples of this, which is
+// a frame boundary at every one of the rates above
+#define SELFTEST_STEP_MS 100
+
+Simulation::Simulation(const LevelSet &l, int level)
+	: m_level(l[level]),
+	  m_object_array(m_level.paddedWidth() * (m_level.height + 2), NULL),
+	  m_player(NULL), m_tick_time(0), m_ticks(0)
+{
+	// Set initial value of bonus counter
+	m_bonus_counter = (int64_t)m_level.bonus * 100 * P2_TICK_RATE;
+	m_int_bonus_counter = m_level.bonus;
+
+	// Create the game objects for the current level,
+	// placing them in the array representing the squares.
+	// Sprites are left out if the level set was loaded without them,
+	// in which case the simulation can run but not be drawn.
+	const TileSet *sprites = l.hasGraphics() ? &(l.getSprites()) : NULL;
+	const TileSet *player_sprites =
+		l.hasGraphics() ? &(l.getPlayerSprites()) : NULL;
+	m_objects.reserve(m_level.num_sprites);
+	for (uint8_t i = 0; i < m_level.num_sprites; ++i)
+	{
+		const SpriteInfo *s = &(m_level.spriteinfo[i]);
+		GameObject **o = &(m_object_array[m_level.paddedIndex(s->x, s->y)]);
+		switch (s->index)
+		{
+			case 0:
+				*o = new Player(player_sprites,
+					m_level, s->x, s->y, &(m_object_array[0]),
+					m_objects_left);
+				m_player = (Player*) *o;
+				break;
+			case 1:
+				*o = new Box(sprites,
+					m_level, s->x, s->y, &(m_object_array[0]),
+					m_objects_left);
+				break;
+			case 2:
+				*o = new Ball(sprites,
+					m_level, s->x, s->y, &(m_object_array[0]),
+					m_objects_left);
+		}
+		m_objects.emplace_back(*o);
+	}
+
+	// Set the number of objects in the current level,
+	// for keeping track of when the level is completed.
+	// One object is the player.
+	m_objects_left = m_level.num_sprites - 1;
+}
+
+void Simulation::reset()
+{
+	// Empty the squares objects have moved to, then put each one
+	// back where it started
+	for (auto i = m_objects.cbegin(); i != m_objects.cend(); ++i)
+		m_object_array[m_level.paddedIndex((*i)->getX(), (*i)->getY())] = NULL;
+	for (auto i = m_objects.cbegin(); i != m_objects.cend(); ++i)
+		(*i)->reset();
+
+	m_bonus_counter = (int64_t)m_level.bonus * 100 * P2_TICK_RATE;
+	m_int_bonus_counter = m_level.bonus;
+	m_objects_left = m_level.num_sprites - 1;
+	m_tick_time = 0;
+	m_ticks = 0;
+}
+
+void Simulation::saveCounters(Counters &c) const
+{
+	c.ticks = m_ticks;
+	c.tick_time = m_tick_time;
+	c.bonus_counter = m_bonus_counter;
+	c.objects_left = m_objects_left;
+}
+
+void Simulation::saveObject(int index, ObjectState &s) const
+{
+	m_objects[index]->save(s);
+}
+
+void Simulation::restore(int count, const uint8_t *indices,
+	const ObjectState *states, const Counters &c)
+{
+	// As for reset(), empty the squares of everything that is about
+	// to move before any of it moves.  Objects left alone are on the
+	// same squares in both states, so can't be in the way.
+	for (int i = 0; i < count; ++i)
+	{
+		const GameObject *o = m_objects[indices[i]].get();
+		m_object_array[m_level.paddedIndex(o->getX(), o->getY())] = NULL;
+	}
+	for (int i = 0; i < count; ++i)
+		m_objects[indices[i]]->restore(states[i]);
+
+	m_ticks = c.ticks;
+	m_tick_time = c.tick_time;
+	m_bonus_counter = c.bonus_counter;
+	m_int_bonus_counter = m_bonus_counter / (100 * P2_TICK_RATE);
+	m_objects_left = c.objects_left;
+}
+
+int Simulation::ticksDue(uint32_t elapsed_ms)
+{
+	m_tick_time += elapsed_ms * P2_TICK_RATE;
+	int due = m_tick_time / 1000;
+	m_tick_time -= due * 1000;
+	return due;
+}
+
+void Simulation::tick(int direction)
+{
+	for (auto i = m_objects.cbegin(); i != m_objects.cend(); ++i)
+	{
+		(*i)->tick();
+	}
+
+	// Input is taken after objects have moved, so that the player's
+	// walking or straining pose survives until it is drawn
+	if (direction >= 0)
+		m_player->move((Direction)direction);
+
+	// Count down the bonus, stopping at zero
+	if (m_int_bonus_counter)
+	{
+		m_bonus_counter -= BONUS_COUNTER_RATE;
+		if (m_bonus_counter < 0)
+			m_bonus_counter = 0;
+		m_int_bonus_counter = (int)(m_bonus_counter / (100 * P2_TICK_RATE));
+	}
+
+	++m_ticks;
+}
+
+Simulation::~Simulation()
+{
+}
+
+int32_t Simulation::alpha() const
+{
+	return (m_tick_time << P2_SUBPIXEL_SHIFT) / 1000;
+}
+
+void Simulation::render(RenderQueue &queue, int origin_x, int origin_y) const
+{
+	int32_t a = alpha();
+	for (auto i = m_objects.cbegin(); i != m_objects.cend(); ++i)
+	{
+		(*i)->render(queue, a, origin_x, origin_y);
+	}
+}
+
+void Simulation::playerPosition(int &x, int &y) const
+{
+	m_player->position(alpha(), x, y);
+}
+
+uint32_t Simulation::digest() const
+{
+	uint32_t h = 2166136261u;
+	for (auto i = m_objects.cbegin(); i != m_objects.cend(); ++i)
+	{
+		h = (*i)->digest(h);
+	}
+	h = GameObject::fold(h, m_objects_left);
+	h = GameObject::fold(h, (uint32_t)m_bonus_counter);
+	h = GameObject::fold(h, (uint32_t)(m_bonus_counter >> 32));
+	h = GameObject::fold(h, m_int_bonus_counter);
+	return GameObject::fold(h, m_ticks);
+}
+
+int Simulation::selfTest(const LevelSet &l, std::ostream &out)
+{
+	const uint32_t total_ms = SELFTEST_SECONDS * 1000;
+	const int num_rates = sizeof(selftest_rates) / sizeof(selftest_rates[0]);
+	int failures = 0;
+
+	for (size_t level = 0; level < l.size(); ++level)
+	{
+		// Pseudo-random input, the same for every frame rate: hold a
+		// direction (or nothing) for up to half a second, as a list of
+		// times at which the key changes
+		struct Press
+		{
+			uint32_t ms;
+			int direction;
+		};
+		std::vector<Press> input;
+		uint32_t seed = 12345 + level;
+		for (uint32_t ms = 0; ms < total_ms;)
+		{
+			seed = seed * 1103515245u + 12345u;
+			Press p = { ms, (int)((seed >> 16) % 5) - 1 };
+			input.push_back(p);
+			ms += SELFTEST_STEP_MS * (1 + ((seed >> 8) % (500 / SELFTEST_STEP_MS)));
+		}
+
+		// Feed it through as InGame would, with frame times in whole
+		// milliseconds as main() measures them, and the key held
+		// looked at once per frame.  A change of key is seen by the
+		// first frame to end after it, which at every rate is the one
+		// starting exactly when it happens, so every rate should
+		// run the same ticks with the same keys held.
+		auto play = [&](Simulation &sim, int rate) {
+			uint32_t t = 0;
+			size_t next = 0;
+			int direction = -1;
+			for (uint32_t frame = 0; t < total_ms; ++frame)
+			{
+				uint32_t ms = ((frame + 1) * 1000 / rate)
+					- (frame * 1000 / rate);
+				t += ms;
+				while (next < input.size() && input[next].ms < t)
+					direction = input[next++].direction;
+				int due = sim.ticksDue(ms);
+				for (int i = 0; i < due; ++i)
+					sim.tick(direction);
+			}
+			return sim.digest();
+		};
+		uint32_t digests[num_rates];
+		for (int r = 0; r < num_rates; ++r)
+		{
+			Simulation sim(l, level);
+			digests[r] = play(sim, selftest_rates[r]);
+
+			// Retrying the level must play out just the same
+			if (r == 0)
+			{
+				sim.reset();
+				if (play(sim, selftest_rates[r]) != digests[r])
+				{
+					out << "Level " << level << ": state after reset differs"
+						<< std::endl;
+					++failures;
+				}
+			}
+		}
+
+		for (int r = 1; r < num_rates; ++r)
+		{
+			if (digests[r] != digests[0])
+			{
+				out << "Level " << level << ": state at " << selftest_rates[r]
+					<< "Hz differs from state at " << selftest_rates[0]
+					<< "Hz" << std::endl;
+				++failures;
+			}
+		}
+	}
+
+	out << "Determinism self-test: " << l.size() << " levels, "
+		<< SELFTEST_SECONDS << "s each at";
+	for (int r = 0; r < num_rates; ++r)
+		out << ' ' << selftest_rates[r] << "Hz";
+	out << ", " << P2_TICK_RATE << " ticks per second: "
+		<< (failures ? "FAILED" : "OK") << std::endl;
+	return failures;
+}
+
+Board::State Simulation::snapshot(const Board &b) const
+{
+	// Objects were created in the same order as the level's sprite
+	// info, so that can be used to tell what kind of object each one is
+	uint8_t kinds[P2_MAX_SPRITES_PER_LEVEL];
+	uint16_t squares[P2_MAX_SPRITES_PER_LEVEL];
+	for (size_t i = 0; i < m_objects.size(); ++i)
+	{
+		kinds[i] = m_level.spriteinfo[i].index;
+		squares[i] = (m_objects[i]->getY() * m_level.width)
+			+ m_objects[i]->getX();
+	}
+	return b.makeState(m_objects.size(), kinds, squares);
+}
@@ -0,0 +1,164 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HXX_SIMULATION
+#define HXX_SIMULATION
+
+#include <memory>
+#include <vector>
+#include <iostream>
+
+#include "LevelSet.hxx"
+#include "Board.hxx"
+
+class RenderQueue;
+class GameObject;
+class Player;
+struct ObjectState;
+
+// The game objects for one level, plus the bonus counter.
+// Owns no surfaces of its own, so that it can be run without a
+// display - as it is when verifying replays - as well as by InGame.
+//
+// Time advances in fixed ticks of 1/P2_TICK_RATE seconds, using only
+// integer arithmetic, so the same input on every tick gives the same
+// result whatever the frame rate.
+class Simulation
+{
+	public:
+		Simulation(const LevelSet &l, int level);
+		~Simulation();
+
+		// Go back to the level's starting state, as if newly
+		// constructed, without reallocating anything
+		void reset();
+
+		// Number of whole ticks due after another frame of the given
+		// length.  Leftover time is carried into the next frame.
+		int ticksDue(uint32_t elapsed_ms);
+
+		// Advance one tick, with the given direction key held
+		// (-1 for none)
+		void tick(int direction);
+
+		// Draw all objects, interpolated between their positions as of
+		// the last two ticks according to how far the next tick is due,
+		// with the level pixel at (origin_x, origin_y) in the frame's
+		// top left corner
+		void render(RenderQueue &queue, int origin_x, int origin_y) const;
+
+		// Where the player would be drawn, in level pixels, for
+		// keeping the view centred on them
+		void playerPosition(int &x, int &y) const;
+
+		// Ticks simulated so far
+		uint32_t ticks() const
+		{
+			return m_ticks;
+		};
+
+		// Hash of all simulation state
+		uint32_t digest() const;
+
+		// Run the same input through every level at several frame
+		// rates, and again after a reset(), checking the results
+		// are bit-identical.  Writes a
+		// line per problem, then a summary; returns number of failures.
+		static int selfTest(const LevelSet &l, std::ostream &out);
+
+		// Have all objects been pushed onto crosses?
+		bool complete() const
+		{
+			return (m_objects_left == 0);
+		};
+
+		// Current bonus counter value, as shown on screen
+		int bonus() const
+		{
+			return m_int_bonus_counter;
+		};
+
+		// Current positions of all objects, in Board terms
+		Board::State snapshot(const Board &b) const;
+
+		// Everything besides the objects which changes during play,
+		// for saving and restoring by Rewind.  The integer bonus
+		// counter always follows from the fine one, so isn't included.
+		struct Counters
+		{
+			uint32_t ticks;
+			uint32_t tick_time;
+			int64_t bonus_counter;
+			int objects_left;
+
+			bool operator==(const Counters &o) const
+			{
+				return (ticks == o.ticks && tick_time == o.tick_time
+					&& bonus_counter == o.bonus_counter
+					&& objects_left == o.objects_left);
+			};
+		};
+		void saveCounters(Counters &c) const;
+
+		// Objects are numbered 0 .. numObjects() - 1, in the order
+		// the level lists them
+		int numObjects() const
+		{
+			return m_objects.size();
+		};
+		void saveObject(int index, ObjectState &s) const;
+
+		// Put the given objects back into saved states, leaving the
+		// others where they are, and restore the counters
+		void restore(int count, const uint8_t *indices,
+			const ObjectState *states, const Counters &c);
+
+	private:
+		const Level &m_level;
+		int m_objects_left;
+
+		// Array of pointers to game objects, one per square of
+		// the padded level (see Level::cells).
+		// Each game object has a pointer to it somewhere in this
+		// array, their positions managed by the GameObjects themselves
+		// as they move around (they contain a pointer to this array).
+		std::vector<GameObject*> m_object_array;
+
+		// Each game object is also stored here, so that they can be
+		// iterated over without having to walk the whole array above,
+		// and so that they get deleted on ~Simulation().
+		std::vector<std::unique_ptr<GameObject>> m_objects;
+
+		// Just a plain-old pointer because the player is a
+		// GameObject, hence deleted when the above vector
+		// is deleted.
+		Player* m_player;
+
+		// Bonus counter in units of 1/(100 * P2_TICK_RATE)
+		int64_t m_bonus_counter;
+		int m_int_bonus_counter;
+
+		// How far between the last tick and the next one to draw objects
+		int32_t alpha() const;
+
+		// Frame time not yet simulated, in units of 1/(1000 * P2_TICK_RATE)
+		// seconds, and ticks simulated so far
+		uint32_t m_tick_time;
+		uint32_t m_ticks;
+};
+
+#endif
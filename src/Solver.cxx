@@ -0,0 +1,349 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <algorithm>
+
+// System
+
+// Library
+
+// Local
+#include "Solver.hxx"
+
+//
+// Implementation
+//
+
+#define NO_PARENT 0xffffffffu
+
+// Check the clock once every this many node expansions
+#define DEADLINE_CHECK_INTERVAL 64
+
+// Weight of the distance-to-goal estimate against pushes made so far.
+// Above 1, the search favours finding some solution quickly over
+// finding the shortest one, which is what a hint needs.
+#define HEURISTIC_WEIGHT 3
+
+static const Direction all_directions[4] = { Left, Right, Up, Down };
+
+static Direction opposite(Direction d)
+{
+	switch (d)
+	{
+		case Left:
+			return Right;
+		case Right:
+			return Left;
+		case Up:
+			return Down;
+		default:
+			return Up;
+	}
+}
+
+Solver::Solver(const Board &b, size_t max_nodes)
+	: m_board(b), m_max_nodes(max_nodes), m_status(Searching),
+	  m_best(0), m_solution_pos(0), m_stamp(0),
+	  m_reach(b.numSquares(), 0), m_child_reach(b.numSquares(), 0),
+	  m_stack(b.numSquares()), m_grid(b.numSquares()),
+	  m_child_grid(b.numSquares()), m_cross_dist(b.numSquares())
+{
+	// Breadth-first walk outwards from every cross, ignoring objects,
+	// to give each square its distance to the nearest one
+	const int squares = m_board.numSquares();
+	int count = 0;
+	for (int i = 0; i < squares; ++i)
+	{
+		m_cross_dist[i] = 0xffff;
+		if (m_board.isCross(i))
+		{
+			m_cross_dist[i] = 0;
+			m_stack[count++] = i;
+		}
+	}
+	for (int head = 0; head < count; ++head)
+	{
+		int sq = m_stack[head];
+		for (int d = 0; d < 4; ++d)
+		{
+			int n = m_board.neighbour(sq, all_directions[d]);
+			if (n >= 0 && m_board.isFloor(n) && m_cross_dist[n] == 0xffff)
+			{
+				m_cross_dist[n] = m_cross_dist[sq] + 1;
+				m_stack[count++] = n;
+			}
+		}
+	}
+
+	restart(m_board.initialState());
+}
+
+int Solver::reach(const Board::State &s, const uint8_t *grid,
+	uint32_t *marks) const
+{
+	if (++m_stamp == 0)
+	{
+		// Stamp wrapped around - clear out stale marks
+		std::fill(m_reach.begin(), m_reach.end(), 0);
+		std::fill(m_child_reach.begin(), m_child_reach.end(), 0);
+		m_stamp = 1;
+	}
+
+	int lowest = s.player;
+	int count = 0;
+	m_stack[count++] = s.player;
+	marks[s.player] = m_stamp;
+	while (count)
+	{
+		int sq = m_stack[--count];
+		if (sq < lowest)
+			lowest = sq;
+		for (int d = 0; d < 4; ++d)
+		{
+			int n = m_board.neighbour(sq, all_directions[d]);
+			if (n >= 0 && marks[n] != m_stamp && m_board.isFloor(n)
+				&& grid[n] == Board::NoPiece)
+			{
+				marks[n] = m_stamp;
+				m_stack[count++] = n;
+			}
+		}
+	}
+	return lowest;
+}
+
+Board::State Solver::canonical(const Board::State &s) const
+{
+	Board::State c(s);
+	m_board.normalise(c);
+
+	m_board.occupancy(c, &(m_child_grid[0]));
+	c.player = reach(c, &(m_child_grid[0]), &(m_child_reach[0]));
+	return c;
+}
+
+uint16_t Solver::score(const Board::State &s) const
+{
+	uint16_t off = 0;
+	uint32_t dist = 0;
+	for (int i = 0; i < m_board.numObjects(); ++i)
+	{
+		if (!m_board.isCross(s.objects[i]))
+			++off;
+		if (m_cross_dist[s.objects[i]] != 0xffff)
+			dist += m_cross_dist[s.objects[i]];
+	}
+	return (off << 10) + std::min<uint32_t>(dist, 1023);
+}
+
+void Solver::restart(const Board::State &root)
+{
+	// clear() keeps the memory already allocated by earlier searches
+	m_nodes.clear();
+	m_seen.clear();
+	m_open.clear();
+	m_solution.clear();
+	m_solution_states.clear();
+	m_solution_pos = 0;
+	m_best = 0;
+
+	Node n;
+	n.state = canonical(root);
+	n.parent = NO_PARENT;
+	n.push.square = 0;
+	n.push.dir = Left;
+	n.score = score(n.state);
+	n.depth = 0;
+	m_nodes.push_back(n);
+	m_seen[n.state] = 0;
+	open(0);
+
+	if (m_board.solved(n.state))
+	{
+		m_status = Solved;
+		buildSolution(0);
+	}
+	else
+		m_status = Searching;
+}
+
+void Solver::open(uint32_t node)
+{
+	const Node &n(m_nodes[node]);
+	Open o;
+	o.priority = n.depth + (HEURISTIC_WEIGHT * (uint32_t)(n.score));
+	o.node = node;
+	m_open.push_back(o);
+	std::push_heap(m_open.begin(), m_open.end());
+}
+
+void Solver::setRoot(const Board::State &s)
+{
+	Board::State c(canonical(s));
+
+	// Still searching from the same position?  Carry on where we left off.
+	if (!m_nodes.empty() && c == m_nodes[0].state)
+		return;
+
+	// Has the player followed (part of) the solution we already have?
+	if (m_status == Solved)
+	{
+		for (size_t i = m_solution_pos; i < m_solution_states.size(); ++i)
+		{
+			if (m_solution_states[i] == c)
+			{
+				m_solution_pos = i;
+				return;
+			}
+		}
+	}
+
+	restart(c);
+}
+
+void Solver::buildSolution(uint32_t goal)
+{
+	m_solution.clear();
+	m_solution_states.clear();
+	for (uint32_t i = goal; i != NO_PARENT; i = m_nodes[i].parent)
+	{
+		m_solution_states.push_back(m_nodes[i].state);
+		if (m_nodes[i].parent != NO_PARENT)
+			m_solution.push_back(m_nodes[i].push);
+	}
+	std::reverse(m_solution.begin(), m_solution.end());
+	std::reverse(m_solution_states.begin(), m_solution_states.end());
+	m_solution_pos = 0;
+}
+
+Solver::Status Solver::search(Clock::time_point deadline)
+{
+	const uint8_t *grid = &(m_grid[0]);
+	int expanded = 0;
+
+	while (m_status == Searching)
+	{
+		if (m_open.empty())
+		{
+			// Nothing left to try
+			m_status = Unsolvable;
+			break;
+		}
+		if (m_nodes.size() >= m_max_nodes)
+		{
+			// No room left to try it in.  Best-effort hints are
+			// still available from the most promising node.
+			m_status = GaveUp;
+			break;
+		}
+
+		if (++expanded == DEADLINE_CHECK_INTERVAL)
+		{
+			expanded = 0;
+			if (Clock::now() >= deadline)
+				break;
+		}
+
+		std::pop_heap(m_open.begin(), m_open.end());
+		uint32_t parent = m_open.back().node;
+		m_open.pop_back();
+		Board::State s(m_nodes[parent].state);
+		m_board.occupancy(s, &(m_grid[0]));
+		reach(s, grid, &(m_reach[0]));
+		uint32_t stamp = m_stamp;
+
+		for (int i = 0; i < m_board.numObjects() && m_status == Searching; ++i)
+		{
+			int sq = s.objects[i];
+			for (int d = 0; d < 4; ++d)
+			{
+				// Player must be able to walk round to the far side
+				Direction dir = all_directions[d];
+				int from = m_board.neighbour(sq, opposite(dir));
+				if (from < 0 || m_reach[from] != stamp)
+					continue;
+
+				int dest = m_board.pushDestination(grid, sq,
+					m_board.pieceAt(i), dir);
+				if (dest < 0 || m_board.isDead(dest))
+					continue;
+
+				// Player ends up where the object was
+				Node n;
+				n.state = s;
+				n.state.objects[i] = dest;
+				n.state.player = sq;
+				n.state = canonical(n.state);
+				if (m_seen.count(n.state))
+					continue;
+
+				n.parent = parent;
+				n.push.square = sq;
+				n.push.dir = dir;
+				n.score = score(n.state);
+				n.depth = m_nodes[parent].depth + 1;
+
+				uint32_t index = m_nodes.size();
+				m_nodes.push_back(n);
+				m_seen[n.state] = index;
+				open(index);
+				if (n.score < m_nodes[m_best].score)
+					m_best = index;
+
+				if (m_board.solved(n.state))
+				{
+					m_status = Solved;
+					buildSolution(index);
+					break;
+				}
+			}
+		}
+	}
+
+	return m_status;
+}
+
+bool Solver::firstPush(Push &p) const
+{
+	if (m_status == Solved)
+	{
+		if (m_solution_pos >= m_solution.size())
+			return false;
+		p = m_solution[m_solution_pos];
+		return true;
+	}
+
+	// Walk back from the most promising node to the root.
+	// No point if the tree has been exhausted without a solution.
+	uint32_t i = m_best;
+	if (m_status == Unsolvable || i == 0)
+		return false;
+	while (m_nodes[i].parent != 0)
+		i = m_nodes[i].parent;
+	p = m_nodes[i].push;
+	return true;
+}
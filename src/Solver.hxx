@@ -0,0 +1,158 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HXX_SOLVER
+#define HXX_SOLVER
+
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+
+#include "Board.hxx"
+
+// Incremental best-first search over pushes.  The search can be run
+// in slices against a deadline, and the tree built so far is kept
+// between calls, so that asking again from the same position (or from
+// any position along an already-found solution) costs almost nothing.
+class Solver
+{
+	public:
+		typedef std::chrono::steady_clock Clock;
+
+		// A single push: the square of the object being pushed,
+		// and the direction in which to push it
+		struct Push
+		{
+			uint16_t square;
+			Direction dir;
+		};
+
+		enum Status
+		{
+			Searching,
+			Solved,
+			Unsolvable,
+			// Ran out of room for nodes before finding a solution
+			GaveUp
+		};
+
+		Solver(const Board &b, size_t max_nodes = 500000);
+
+		// Set the position to search from.  If it is the current root,
+		// or lies on the current solution, the existing tree is reused;
+		// otherwise the tree is cleared (but its memory kept).
+		void setRoot(const Board::State &s);
+
+		// Expand nodes until the level is solved, the tree is exhausted,
+		// or the deadline passes
+		Status search(Clock::time_point deadline);
+
+		Status status() const
+		{
+			return m_status;
+		};
+
+		// First push towards the solution if one has been found, or
+		// towards the most promising position seen so far otherwise.
+		// Returns false if there is nothing sensible to suggest.
+		bool firstPush(Push &p) const;
+
+		// Number of pushes in the solution found, if any
+		size_t solutionLength() const
+		{
+			return m_solution.size() - m_solution_pos;
+		};
+
+		size_t nodes() const
+		{
+			return m_nodes.size();
+		};
+
+		// Canonical form of a state: objects sorted, and the player
+		// moved to the lowest-numbered square it can walk to
+		Board::State canonical(const Board::State &s) const;
+
+	private:
+		struct Node
+		{
+			Board::State state;
+			uint32_t parent;
+			Push push;
+			uint16_t score;
+			uint16_t depth;
+		};
+
+		// Frontier entry: lower priority values are expanded first
+		struct Open
+		{
+			uint32_t priority;
+			uint32_t node;
+
+			bool operator<(const Open &o) const
+			{
+				// std::push_heap builds a max-heap; invert it
+				return (priority > o.priority)
+					|| (priority == o.priority && node > o.node);
+			};
+		};
+
+		// Flood-fill the squares the player can walk to, marking them
+		// with a new stamp in the given array.  Returns the lowest square.
+		int reach(const Board::State &s, const uint8_t *grid,
+			uint32_t *marks) const;
+
+		// Lower is better: objects off crosses, then total distance
+		// from each object to its nearest cross
+		uint16_t score(const Board::State &s) const;
+
+		void restart(const Board::State &root);
+		void open(uint32_t node);
+		void buildSolution(uint32_t goal);
+
+		const Board &m_board;
+		size_t m_max_nodes;
+		Status m_status;
+
+		std::vector<Node> m_nodes;
+		std::unordered_map<Board::State, uint32_t, Board::StateHash> m_seen;
+		std::vector<Open> m_open;
+		uint32_t m_best;
+
+		// Solution found by the last successful search, as pushes
+		// along with the (canonical) state before each push
+		std::vector<Push> m_solution;
+		std::vector<Board::State> m_solution_states;
+		size_t m_solution_pos;
+
+		// Scratch space for flood fills.  The node being expanded and
+		// the children being canonicalised get separate mark arrays.
+		// All are sized to the level.
+		mutable uint32_t m_stamp;
+		mutable std::vector<uint32_t> m_reach;
+		mutable std::vector<uint32_t> m_child_reach;
+		mutable std::vector<uint16_t> m_stack;
+
+		// Occupancy grids for the node being expanded and for
+		// the children being canonicalised
+		std::vector<uint8_t> m_grid;
+		mutable std::vector<uint8_t> m_child_grid;
+
+		// Distance from each square to the nearest cross
+		std::vector<uint16_t> m_cross_dist;
+};
+
+#endif
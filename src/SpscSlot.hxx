@@ -0,0 +1,59 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HXX_SPSCSLOT
+#define HXX_SPSCSLOT
+
+#include <atomic>
+
+// Lock-free mailbox holding at most one value, for passing data from
+// exactly one producer thread to exactly one consumer thread.
+// Neither side ever waits for the other.
+template <typename T> class SpscSlot
+{
+	public:
+		SpscSlot()
+			: m_full(false)
+		{};
+
+		// Producer side.  Returns false, leaving the slot untouched,
+		// if the previous value has not been taken yet.
+		bool put(const T &value)
+		{
+			if (m_full.load(std::memory_order_acquire))
+				return false;
+			m_value = value;
+			m_full.store(true, std::memory_order_release);
+			return true;
+		};
+
+		// Consumer side.  Returns false if there is nothing to take.
+		bool take(T &value)
+		{
+			if (!m_full.load(std::memory_order_acquire))
+				return false;
+			value = m_value;
+			m_full.store(false, std::memory_order_release);
+			return true;
+		};
+
+	private:
+		T m_value;
+		std::atomic<bool> m_full;
+};
+
+#endif
@@ -0,0 +1,144 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+
+// System
+
+// Library
+
+// Local
+#include "ThreadPool.hxx"
+
+//
+// Implementation
+//
+
+ThreadPool::ThreadPool(unsigned int threads)
+	: m_fn(NULL), m_count(0), m_chunk(1), m_next(0),
+	  m_generation(0), m_running(0), m_quit(false)
+{
+	if (threads == 0)
+		threads = std::thread::hardware_concurrency();
+	for (unsigned int i = 1; i < threads; ++i)
+		m_workers.push_back(std::thread(&ThreadPool::run, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_start.notify_all();
+	for (auto i = m_workers.begin(); i != m_workers.end(); ++i)
+		i->join();
+}
+
+void ThreadPool::parallelFor(size_t count, size_t chunk,
+	const std::function<void(size_t, size_t)> &fn)
+{
+	if (chunk == 0)
+		chunk = 1;
+
+	// Not worth waking anybody for a single chunk
+	if (m_workers.empty() || count <= chunk)
+	{
+		if (count)
+			fn(0, count);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_fn = &fn;
+		m_count = count;
+		m_chunk = chunk;
+		m_next = 0;
+		m_running = m_workers.size();
+		++m_generation;
+	}
+	m_start.notify_all();
+
+	work();
+
+	// Wait for the workers to finish their last chunks
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_running)
+		m_finish.wait(lock);
+	m_fn = NULL;
+
+	std::exception_ptr error;
+	std::swap(error, m_error);
+	lock.unlock();
+	if (error)
+		std::rethrow_exception(error);
+}
+
+void ThreadPool::work()
+{
+	// Take chunks until there are none left
+	size_t begin;
+	while ((begin = m_next.fetch_add(m_chunk)) < m_count)
+	{
+		size_t end = begin + m_chunk;
+		if (end > m_count)
+			end = m_count;
+		try
+		{
+			(*m_fn)(begin, end);
+		}
+		catch (...)
+		{
+			// Keep the first error for the caller, and start no more
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_error)
+				m_error = std::current_exception();
+			m_next = m_count;
+		}
+	}
+}
+
+void ThreadPool::run()
+{
+	unsigned long seen = 0;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;)
+	{
+		while (!m_quit && m_generation == seen)
+			m_start.wait(lock);
+		if (m_quit)
+			return;
+		seen = m_generation;
+
+		lock.unlock();
+		work();
+		lock.lock();
+
+		if (--m_running == 0)
+			m_finish.notify_one();
+	}
+}
@@ -0,0 +1,153 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HXX_THREADPOOL
+#define HXX_THREADPOOL
+
+#include <cstddef>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+// Fixed set of worker threads for splitting loops across all cores.
+// The calling thread joins in, so a pool of one thread has no workers
+// and simply runs everything in place.
+class ThreadPool
+{
+	public:
+		// Zero threads means one per core
+		explicit ThreadPool(unsigned int threads = 0);
+		~ThreadPool();
+
+		unsigned int size() const
+		{
+			return m_workers.size() + 1;
+		};
+
+		// Call fn(begin, end) over consecutive chunks of [0, count),
+		// spread across all threads, returning when every chunk is done.
+		// If fn throws, no more chunks are started, and the first
+		// exception is rethrown here once the running ones are done.
+		// Not re-entrant: only one loop may run on a pool at a time.
+		void parallelFor(size_t count, size_t chunk,
+			const std::function<void(size_t, size_t)> &fn);
+
+		// Call make(i, result) for each i in [0, count), spread across
+		// all threads, then use(i, result) strictly in order of i, as
+		// soon as each result and those before it are made.  use() is
+		// called on one thread at a time, from whichever finished the
+		// result it is waiting for, so results can be written out as
+		// they come without holding up the others.  Only a few results
+		// per thread are held at once; a thread which gets that far
+		// ahead of use() waits for it to catch up.  An exception from
+		// either stops the loop and is rethrown as for parallelFor.
+		template <typename T, typename Make, typename Use>
+		void parallelInOrder(size_t count, Make make, Use use);
+
+	private:
+		void run();
+		void work();
+
+		std::vector<std::thread> m_workers;
+
+		// Current loop
+		const std::function<void(size_t, size_t)> *m_fn;
+		size_t m_count;
+		size_t m_chunk;
+		std::atomic<size_t> m_next;
+
+		// Workers wait for m_generation to change, and the caller
+		// waits for m_running to drop to zero
+		std::mutex m_mutex;
+		std::condition_variable m_start;
+		std::condition_variable m_finish;
+		unsigned long m_generation;
+		unsigned int m_running;
+		bool m_quit;
+
+		// First exception thrown by the current loop
+		std::exception_ptr m_error;
+};
+
+template <typename T, typename Make, typename Use>
+void ThreadPool::parallelInOrder(size_t count, Make make, Use use)
+{
+	// Result i is made in slot i % window, which is free once result
+	// i - window has been used
+	size_t window = 2 * size();
+	std::vector<T> results(window);
+	std::vector<char> done(window, 0);
+	std::mutex mutex;
+	std::condition_variable space;
+	size_t next_use = 0;
+	bool using_results = false;
+	bool failed = false;
+
+	parallelFor(count, 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+		{
+			size_t slot = i % window;
+			try
+			{
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					while (!failed && i >= next_use + window)
+						space.wait(lock);
+					if (failed)
+						return;
+				}
+
+				make(i, results[slot]);
+
+				// Hand on everything now ready, unless another thread
+				// already is; it will see this result before it stops
+				std::unique_lock<std::mutex> lock(mutex);
+				done[slot] = 1;
+				if (using_results)
+					continue;
+				using_results = true;
+				while (!failed && next_use < count
+					&& done[next_use % window])
+				{
+					size_t u = next_use % window;
+					lock.unlock();
+					use(next_use, results[u]);
+					results[u] = T();
+					lock.lock();
+					done[u] = 0;
+					++next_use;
+					space.notify_all();
+				}
+				using_results = false;
+			}
+			catch (...)
+			{
+				// Let any threads waiting for space give up too
+				std::lock_guard<std::mutex> lock(mutex);
+				failed = true;
+				space.notify_all();
+				throw;
+			}
+		}
+	});
+}
+
+#endif
@@ -28,10 +28,12 @@
 #include <fstream>
 #include <stdexcept>
 #include <new>
+#include <memory>
 
 // System
 
 // Library
+#include <SDL.h>
 
 // Local
 #include "TileSet.hxx"
@@ -61,8 +63,11 @@ TileSet::TileSet(const char *filename, int width, int height, bool colorkey)
 		setfile.read(buff, tilesize);
 		unsigned char *ubuff = (unsigned char*)(buff);
 
-		// Allocate a new SDL_Surface to hold the data
-		SDL_Surface *tile = SDL_CreateRGBSurface(SDL_HWSURFACE, width, height, 32,
+		// Allocate a new SDL_Surface to hold the data.  This is always a
+		// plain memory surface, so that sets can be loaded off the main
+		// thread (see AssetWatcher); convertToDisplayFormat moves tiles
+		// into video memory where there is any.
+		SDL_Surface *tile = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, 32,
 			0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000);
 		if (!tile)
 		{
@@ -106,6 +111,83 @@ TileSet::TileSet(const char *filename, int width, int height, bool colorkey)
 		m_tiles.push_back(tile);
 		delete[] buff;
 	}
+
+	if (colorkey)
+		encodeSprites();
+}
+
+void TileSet::encodeSprites()
+{
+	m_sprites.clear();
+	m_sprites.reserve(m_tiles.size());
+	for (std::vector<SDL_Surface*>::iterator i = m_tiles.begin();
+		i < m_tiles.end(); ++i)
+	{
+		m_sprites.emplace_back(*i);
+	}
+}
+
+void TileSet::convertToDisplayFormat()
+{
+	const SDL_PixelFormat *display = SDL_GetVideoSurface()->format;
+	for (std::vector<SDL_Surface*>::iterator i = m_tiles.begin(); i < m_tiles.end(); ++i)
+	{
+		// Colour keys are carried across
+		SDL_Surface *converted = SDL_DisplayFormat(*i);
+		if (!converted)
+		{
+			throw std::runtime_error(
+				std::string("Cannot convert tile to display format: ")
+				.append(SDL_GetError())
+			);
+		}
+		SDL_FreeSurface(*i);
+		*i = converted;
+	}
+
+	// Sprites are re-encoded from the converted tiles, straight
+	// into the display format rather than on first use
+	if (!m_sprites.empty())
+	{
+		encodeSprites();
+		prepareSprites(display);
+	}
+}
+
+TileSet *TileSet::displayCopy(const TileSet &loaded)
+{
+	const SDL_PixelFormat *display = SDL_GetVideoSurface()->format;
+	std::unique_ptr<TileSet> t(new TileSet);
+	t->m_tiles.reserve(loaded.m_tiles.size());
+	for (std::vector<SDL_Surface*>::const_iterator i = loaded.m_tiles.begin();
+		i < loaded.m_tiles.end(); ++i)
+	{
+		SDL_Surface *converted = SDL_DisplayFormat(*i);
+		if (!converted)
+		{
+			throw std::runtime_error(
+				std::string("Cannot convert tile to display format: ")
+				.append(SDL_GetError())
+			);
+		}
+		t->m_tiles.push_back(converted);
+	}
+
+	if (!loaded.m_sprites.empty())
+	{
+		t->encodeSprites();
+		t->prepareSprites(display);
+	}
+	return t.release();
+}
+
+void TileSet::prepareSprites(const SDL_PixelFormat *format) const
+{
+	for (std::vector<RleSprite>::const_iterator i = m_sprites.begin();
+		i < m_sprites.end(); ++i)
+	{
+		i->prepare(format);
+	}
 }
 
 TileSet::~TileSet()
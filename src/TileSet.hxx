@@ -20,10 +20,18 @@
 
 #include <vector>
 
-#include <SDL.h>
+#include "RleSprite.hxx"
+
+struct SDL_PixelFormat;
+
+// Only pointers to surfaces are handled here, so users of
+// tile sets need not pull in SDL unless they draw with them
+struct SDL_Surface;
 
 // A collection of equal-sized, 24 bpp SDL surfaces loaded from a
-// file containing concatenated raw bitmap data
+// file containing concatenated raw bitmap data.  Colour-keyed sets
+// also keep a trimmed, run-length encoded copy of each tile, which is
+// much quicker to draw.
 class TileSet
 {
 	public:
@@ -39,8 +47,45 @@ class TileSet
 		{
 			return m_tiles.size();
 		};
+
+		// Only for colour-keyed sets
+		const RleSprite &sprite(std::vector<RleSprite>::size_type index) const
+		{
+			return m_sprites[index];
+		};
+
+		// Convert every tile to the exact pixel format of the screen,
+		// so that drawing them needs no conversion.  Tiles are loaded
+		// in a fixed format, so this must be done after every change of
+		// video mode.  Invalidates surface pointers from operator[].
+		void convertToDisplayFormat();
+
+		// New set holding copies of another's tiles, converted as by
+		// convertToDisplayFormat, so that a set already loaded from a
+		// file can be put on screen without loading it again.  The
+		// other set is left as it is.
+		static TileSet *displayCopy(const TileSet &loaded);
+
+		// Encode every sprite for drawing in the given format now,
+		// rather than on first use
+		void prepareSprites(const SDL_PixelFormat *format) const;
+
+		// Exchange contents with another set, such as a fresh copy
+		// of this one loaded after its file was edited
+		void swap(TileSet &other)
+		{
+			m_tiles.swap(other.m_tiles);
+			m_sprites.swap(other.m_sprites);
+		};
 	private:
+		TileSet()
+		{
+		};
+
+		void encodeSprites();
+
 		std::vector<SDL_Surface*> m_tiles;
+		std::vector<RleSprite> m_sprites;
 };
 
 #endif
@@ -0,0 +1,99 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+
+// System
+
+// Library
+
+// Local
+#include "Transition.hxx"
+#include "Constants.hxx"
+
+//
+// Implementation
+//
+
+Transition::Transition(SDL_Surface *old_frame, SDL_Surface *new_frame)
+	: m_old_frame(old_frame), m_new_frame(new_frame), m_y(0.0f)
+{}
+
+Transition::~Transition()
+{
+	SDL_FreeSurface(m_old_frame);
+	SDL_FreeSurface(m_new_frame);
+}
+
+bool Transition::update(float elapsed, RenderQueue &queue)
+{
+	if ((m_y - (float)P2_TILE_HEIGHT) >= (float)(P2_TILE_HEIGHT * P2_LEVEL_HEIGHT))
+		return false;
+
+	// Start by rendering the destination
+	queue.blit(RenderQueue::Background, m_new_frame, NULL, 0, 0);
+
+	// Move the bottom of the vertical wipe down
+	// based on time elapsed since last frame
+	m_y += 512.0f * elapsed;
+
+	// Top of the vertical wipe is two tile
+	// heights above the bottom - but not off-screen
+	float i = m_y - (float)(P2_TILE_HEIGHT * 2);
+	if (i < 0.0f)
+		i = 0.0f;
+
+	// Vertical wipe by rendering a series of
+	// single rows each 1 pixel high
+	for (; i <= m_y; ++i)
+	{
+		if ((Sint16)i >= (P2_TILE_HEIGHT * P2_LEVEL_HEIGHT))
+			break;
+
+		SDL_Rect src = {
+			0, (Sint16)i, P2_TILE_WIDTH * P2_LEVEL_WIDTH, 1
+		};
+
+		// Transparency ranges from 0 to 255 over the height
+		// of the wipe (2 tiles)
+		queue.blit(RenderQueue::Overlay, m_old_frame, &src, 0, (int)i,
+			255 - (Uint8)(((m_y - i) / (float)(P2_TILE_HEIGHT * 2)) * 255.0f));
+	}
+
+	// Render the rest of the start surface
+	// opaque below the wipe
+	if (m_y < (float)(P2_TILE_HEIGHT * P2_LEVEL_HEIGHT))
+	{
+		SDL_Rect src = {
+			0, (Sint16)m_y, P2_TILE_WIDTH * P2_LEVEL_WIDTH,
+			(Uint16)(m_old_frame->h - (int)m_y)
+		};
+		queue.blit(RenderQueue::Overlay, m_old_frame, &src, 0, (int)m_y);
+	}
+
+	return true;
+}
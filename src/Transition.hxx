@@ -0,0 +1,50 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HXX_TRANSITION
+#define HXX_TRANSITION
+
+#include <SDL.h>
+
+#include "RenderQueue.hxx"
+
+// Quick & dirty transition between the last frame from one GameLoop
+// and the first frame from the next: a translucent wipe down the screen,
+// revealing the new frame from the top
+class Transition
+{
+	public:
+		// Takes ownership of both frames, which must be the size of
+		// the queues later passed to update()
+		Transition(SDL_Surface *old_frame, SDL_Surface *new_frame);
+		~Transition();
+
+		// Queue up the next frame of the wipe, the given number of
+		// seconds after the last one.  Returns false, having queued
+		// nothing, once the wipe has finished.
+		bool update(float elapsed, RenderQueue &queue);
+
+	private:
+		SDL_Surface *m_old_frame;
+		SDL_Surface *m_new_frame;
+
+		// Bottom of the wipe
+		float m_y;
+};
+
+#endif
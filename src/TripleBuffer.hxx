@@ -0,0 +1,88 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HXX_TRIPLEBUFFER
+#define HXX_TRIPLEBUFFER
+
+#include <atomic>
+
+// Lock-free hand-over of whole buffers from exactly one producer thread
+// to exactly one consumer thread.  The caller owns three buffers, and
+// this keeps track of which one each side is using: the producer fills
+// one while the consumer reads another, and the third holds the most
+// recently published buffer until the consumer takes it.  Publishing
+// again before then replaces it, so the consumer always gets the latest
+// and neither side ever waits for the other.
+class TripleBuffer
+{
+	public:
+		TripleBuffer()
+			: m_back(0), m_middle(1), m_front(2)
+		{};
+
+		// Producer side: index of the buffer to fill next
+		int back() const
+		{
+			return m_back;
+		};
+
+		// Producer side: publish the back buffer, and get another to
+		// fill.  The new back buffer may hold an old frame, published
+		// but never taken, or already used by the consumer.
+		void publish()
+		{
+			m_back = m_middle.exchange(m_back | FRESH,
+				std::memory_order_acq_rel) & INDEX;
+		};
+
+		// Has a buffer been published which the consumer hasn't taken?
+		bool fresh() const
+		{
+			return ((m_middle.load(std::memory_order_acquire) & FRESH) != 0);
+		};
+
+		// Consumer side.  Switch to the latest published buffer,
+		// returning false (and staying put) if there is nothing new.
+		bool fetch()
+		{
+			if (!fresh())
+				return false;
+			m_front = m_middle.exchange(m_front,
+				std::memory_order_acq_rel) & INDEX;
+			return true;
+		};
+
+		// Consumer side: index of the buffer to read
+		int front() const
+		{
+			return m_front;
+		};
+
+	private:
+		enum
+		{
+			INDEX = 3,
+			FRESH = 4
+		};
+
+		int m_back;
+		std::atomic<int> m_middle;
+		int m_front;
+};
+
+#endif
@@ -0,0 +1,575 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+
+// System
+
+// Library
+
+// Local
+#include "Xsb.hxx"
+#include "ThreadPool.hxx"
+
+//
+// Implementation
+//
+
+// Bonus counter start value for imported levels: a base amount,
+// plus a bit more for each box
+#define XSB_BONUS 500
+#define XSB_BONUS_PER_BOX 100
+
+// Levels are converted in chunks of this many, reading this many
+// chunks per thread ahead
+#define XSB_CHUNK_LEVELS 32
+#define XSB_CHUNKS_PER_THREAD 4
+
+namespace
+{
+	// True if the line is (or holds, run-length encoded) rows of a level
+	bool isRow(const std::string &line)
+	{
+		bool wall = false;
+		for (auto i = line.begin(); i != line.end(); ++i)
+		{
+			switch (*i)
+			{
+				case '#':
+					wall = true;
+					break;
+				case ' ': case '-': case '_': case '@': case '+':
+				case '$': case '*': case '.': case '|':
+				case '0': case '1': case '2': case '3': case '4':
+				case '5': case '6': case '7': case '8': case '9':
+					break;
+				default:
+					return false;
+			}
+		}
+		return wall;
+	}
+
+	// Case-insensitive test for a "Title:" line, from the given position
+	bool isTitle(const std::string &line, size_t start)
+	{
+		const char title[] = "title:";
+		for (size_t i = 0; i < sizeof(title) - 1; ++i)
+		{
+			if (start + i >= line.size()
+				|| tolower((unsigned char)(line[start + i])) != title[i])
+				return false;
+		}
+		return true;
+	}
+
+	std::string trim(const std::string &s, size_t start = 0)
+	{
+		size_t first = s.find_first_not_of(" \t", start);
+		if (first == std::string::npos)
+			return std::string();
+		size_t last = s.find_last_not_of(" \t");
+		return s.substr(first, (last - first) + 1);
+	}
+}
+
+Xsb::Tiles Xsb::chooseTiles(const LevelSet &style)
+{
+	uint32_t counts[256];
+	memset(counts, 0, sizeof(counts));
+	for (size_t i = 0; i < style.size(); ++i)
+	{
+		const std::vector<uint8_t> &t = style[i].tilemap;
+		for (auto j = t.begin(); j != t.end(); ++j)
+			++counts[*j];
+	}
+
+	// Walls are below the first floor tile, crosses from there up to
+	// the first cross tile, and plain floor from there on
+	uint8_t first_floor = style.firstFloorTile();
+	uint8_t first_cross = style.firstCrossTile();
+	Tiles tiles = { 0, first_floor, first_cross };
+	for (int i = 0; i < 256; ++i)
+	{
+		if (i < first_floor)
+		{
+			if (counts[i] > counts[tiles.wall])
+				tiles.wall = i;
+		}
+		else if (i < first_cross)
+		{
+			if (counts[i] > counts[tiles.cross])
+				tiles.cross = i;
+		}
+		else if (counts[i] > counts[tiles.floor])
+			tiles.floor = i;
+	}
+	return tiles;
+}
+
+Xsb::Reader::Reader(std::istream &in, const Tiles &tiles)
+	: m_in(in), m_converter(tiles), m_put_back(false), m_num_rows(0),
+	  m_closed(false), m_levels(0), m_skipped(0), m_number(0)
+{
+}
+
+bool Xsb::Reader::readLine()
+{
+	if (m_put_back)
+	{
+		m_put_back = false;
+		return true;
+	}
+	if (!std::getline(m_in, m_line))
+		return false;
+	if (!m_line.empty() && m_line[m_line.size() - 1] == '\r')
+		m_line.resize(m_line.size() - 1);
+	return true;
+}
+
+bool Xsb::Reader::next(Level &l)
+{
+	while (nextText(m_text))
+	{
+		if (m_converter.convert(m_text, l))
+		{
+			++m_levels;
+			return true;
+		}
+		++m_skipped;
+	}
+	return false;
+}
+
+bool Xsb::Reader::nextText(Text &t)
+{
+	for (;;)
+	{
+		if (!readLine())
+		{
+			// End of input: hand over the last level, if any
+			if (!m_num_rows)
+				return false;
+			take(t);
+			return true;
+		}
+
+		if (isRow(m_line))
+		{
+			// Start of the next level: hand over this one first
+			if (m_closed)
+			{
+				m_put_back = true;
+				take(t);
+				return true;
+			}
+
+			// The last comment names the level just starting
+			if (!m_num_rows)
+			{
+				m_name.swap(m_comment);
+				m_comment.clear();
+			}
+			addRows(m_line);
+			continue;
+		}
+
+		// Anything else ends the level being read, but may name it
+		// or the next one
+		if (m_num_rows)
+			m_closed = true;
+		size_t start = m_line.find_first_not_of(" \t");
+		if (start == std::string::npos)
+			continue;
+		if (m_line[start] == ';')
+			m_comment = trim(m_line, start + 1);
+		else if (isTitle(m_line, start))
+		{
+			if (m_num_rows)
+				m_title = trim(m_line, start + 6);
+			else
+				m_comment = trim(m_line, start + 6);
+		}
+	}
+}
+
+void Xsb::Reader::take(Text &t)
+{
+	// Swap the rows rather than copying them, so that both sides
+	// keep reusing their strings
+	t.rows.resize(m_num_rows);
+	for (size_t y = 0; y < m_num_rows; ++y)
+		t.rows[y].swap(m_rows[y]);
+	t.name.swap(m_name);
+	t.title.swap(m_title);
+	t.number = ++m_number;
+
+	m_num_rows = 0;
+	m_closed = false;
+	m_name.clear();
+	m_title.clear();
+}
+
+void Xsb::Reader::addRows(const std::string &line)
+{
+	// Row strings are kept between levels, to save reallocating them.
+	// Levels too big to import stop growing once that is clear.
+	std::string *row = NULL;
+	auto nextRow = [&]() {
+		if (m_num_rows <= P2_MAX_LEVEL_HEIGHT)
+		{
+			if (m_num_rows == m_rows.size())
+				m_rows.push_back(std::string());
+			++m_num_rows;
+		}
+		row = &(m_rows[m_num_rows - 1]);
+		row->clear();
+	};
+	nextRow();
+
+	int count = 0;
+	for (auto i = line.begin(); i != line.end(); ++i)
+	{
+		char c = *i;
+		if (c >= '0' && c <= '9')
+		{
+			count = std::min((count * 10) + (c - '0'), P2_MAX_LEVEL_WIDTH + 1);
+			continue;
+		}
+		if (c == '|')
+			nextRow();
+		else
+		{
+			if (c == '-' || c == '_')
+				c = ' ';
+			if (row->size() <= P2_MAX_LEVEL_WIDTH)
+				row->append(count ? count : 1, c);
+		}
+		count = 0;
+	}
+}
+
+Xsb::Converter::Converter(const Tiles &tiles)
+	: m_tiles(tiles)
+{
+}
+
+bool Xsb::Converter::convert(Text &t, Level &l)
+{
+	int height = t.rows.size();
+	int width = 0;
+	for (int y = 0; y < height; ++y)
+	{
+		std::string &row = t.rows[y];
+		size_t end = row.find_last_not_of(' ');
+		row.resize((end == std::string::npos) ? 0 : end + 1);
+		width = std::max(width, (int)(row.size()));
+	}
+
+	// Square at (x, y) of the text, with short rows padded with spaces
+	auto square = [&](int x, int y) -> char {
+		const std::string &row = t.rows[y];
+		return ((size_t)x < row.size()) ? row[x] : ' ';
+	};
+
+	// The level needs one player, and as many goals as boxes,
+	// of which there can only be so many
+	bool ok = (width > 0 && width <= P2_MAX_LEVEL_WIDTH
+		&& height <= P2_MAX_LEVEL_HEIGHT);
+	int player = -1;
+	int players = 0, boxes = 0, goals = 0;
+	for (int y = 0; ok && y < height; ++y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			switch (square(x, y))
+			{
+				case '+':
+					++goals;
+					// fall through
+				case '@':
+					++players;
+					player = (y * width) + x;
+					break;
+				case '*':
+					++goals;
+					// fall through
+				case '$':
+					++boxes;
+					break;
+				case '.':
+					++goals;
+					break;
+			}
+		}
+	}
+	ok = (ok && players == 1 && boxes > 0 && boxes == goals
+		&& boxes < P2_MAX_SPRITES_PER_LEVEL);
+
+	// Everything the player can reach, ignoring boxes, is inside
+	// the level; spaces outside it are drawn as wall
+	if (ok)
+	{
+		m_inside.assign(width * height, 0);
+		m_stack.clear();
+		m_inside[player] = 1;
+		m_stack.push_back(player);
+		while (!m_stack.empty())
+		{
+			int i = m_stack.back();
+			m_stack.pop_back();
+			int x = i % width;
+			int y = i / width;
+			const int neighbours[4][2] = {
+				{ x - 1, y }, { x + 1, y }, { x, y - 1 }, { x, y + 1 }
+			};
+			for (int n = 0; n < 4; ++n)
+			{
+				int nx = neighbours[n][0];
+				int ny = neighbours[n][1];
+				if (nx < 0 || nx >= width || ny < 0 || ny >= height)
+					continue;
+				int ni = (ny * width) + nx;
+				if (!m_inside[ni] && square(nx, ny) != '#')
+				{
+					m_inside[ni] = 1;
+					m_stack.push_back(ni);
+				}
+			}
+		}
+	}
+
+	if (ok)
+	{
+		l.width = width;
+		l.height = height;
+		l.tilemap.assign(width * height, m_tiles.wall);
+		l.num_sprites = 1;
+		l.spriteinfo[0].x = player % width;
+		l.spriteinfo[0].y = player / width;
+		l.spriteinfo[0].index = 0;
+		for (int y = 0; ok && y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				char c = square(x, y);
+				int i = (y * width) + x;
+				bool goal = (c == '.' || c == '*' || c == '+');
+				bool box = (c == '$' || c == '*');
+				if (m_inside[i])
+					l.tilemap[i] = goal ? m_tiles.cross : m_tiles.floor;
+				else if (goal || box)
+				{
+					// Out of reach, so it can never be solved
+					ok = false;
+					break;
+				}
+				if (box)
+				{
+					SpriteInfo &s = l.spriteinfo[l.num_sprites++];
+					s.x = x;
+					s.y = y;
+					s.index = 1;
+				}
+			}
+		}
+	}
+
+	if (ok)
+	{
+		if (!t.title.empty())
+			l.name = t.title.substr(0, 12);
+		else if (!t.name.empty())
+			l.name = t.name.substr(0, 12);
+		else
+		{
+			std::ostringstream n;
+			n << t.number;
+			l.name = n.str();
+		}
+		l.bonus = XSB_BONUS + (XSB_BONUS_PER_BOX * boxes);
+		l.name_colour[0] = 255;
+		l.name_colour[1] = 255;
+		l.name_colour[2] = 0;
+		l.cells.clear();
+	}
+	return ok;
+}
+
+int Xsb::importFiles(const LevelSet &style,
+	const std::vector<std::string> &files, const std::string &pack,
+	std::ostream &out)
+{
+	std::ofstream p(pack.c_str(), std::ios_base::binary);
+	if (!p.is_open())
+	{
+		out << "Could not open \"" << pack << "\" for writing" << std::endl;
+		return -1;
+	}
+	LevelSet::writeHeader(p, style, 0);
+	Tiles tiles = chooseTiles(style);
+
+	// Levels' text, read on this thread, and which file it came from.
+	// A file's last chunk says what went wrong reading it, if anything.
+	struct Chunk
+	{
+		size_t file;
+		std::vector<Text> texts;
+		size_t count;
+		bool last;
+		std::string error;
+	};
+
+	// A chunk's levels, ready to write into the pack, filled in by
+	// whichever thread converts it
+	struct Converted
+	{
+		std::vector<Level> levels;
+		uint32_t skipped;
+	};
+
+	// Read a batch of chunks at a time, across as many files as it
+	// takes, then convert them on all threads.  Each chunk's levels
+	// are written out as soon as it and those before it are done, so
+	// only a batch of any file is ever held.
+	uint32_t total = 0;
+	uint32_t file_levels = 0;
+	uint32_t file_skipped = 0;
+	int failures = 0;
+	ThreadPool pool;
+	std::vector<Chunk> batch(XSB_CHUNKS_PER_THREAD * pool.size());
+	std::unique_ptr<std::ifstream> s;
+	std::unique_ptr<Reader> r;
+	size_t f = 0;
+	while (f < files.size())
+	{
+		size_t chunks = 0;
+		while (chunks < batch.size() && f < files.size())
+		{
+			Chunk &c = batch[chunks++];
+			c.file = f;
+			c.count = 0;
+			c.last = false;
+			c.error.clear();
+			c.texts.resize(XSB_CHUNK_LEVELS);
+			try
+			{
+				if (!r)
+				{
+					s.reset(new std::ifstream);
+					s->exceptions(std::ios::badbit);
+					s->open(files[f].c_str(), std::ios_base::binary);
+					if (!s->is_open())
+						throw std::runtime_error("cannot open file");
+					r.reset(new Reader(*s, tiles));
+				}
+				while (c.count < XSB_CHUNK_LEVELS
+					&& r->nextText(c.texts[c.count]))
+					++c.count;
+				c.last = (c.count < XSB_CHUNK_LEVELS);
+			}
+			catch (std::exception &e)
+			{
+				c.error = e.what();
+				c.last = true;
+			}
+			if (c.last)
+			{
+				r.reset();
+				s.reset();
+				++f;
+			}
+		}
+
+		pool.parallelInOrder<Converted>(chunks,
+			[&](size_t k, Converted &levels) {
+				Chunk &c = batch[k];
+				Converter converter(tiles);
+				levels.levels.resize(c.count);
+				levels.skipped = 0;
+				size_t n = 0;
+				for (size_t i = 0; i < c.count; ++i)
+				{
+					if (converter.convert(c.texts[i], levels.levels[n]))
+						++n;
+					else
+						++levels.skipped;
+				}
+				levels.levels.resize(n);
+			},
+			[&](size_t k, Converted &levels) {
+				const Chunk &c = batch[k];
+				for (auto l = levels.levels.begin();
+					l != levels.levels.end(); ++l)
+					LevelSet::writeLevel(p, *l);
+				total += levels.levels.size();
+				file_levels += levels.levels.size();
+				file_skipped += levels.skipped;
+				if (!c.last)
+					return;
+
+				// Levels read before an error are kept
+				out << files[c.file] << ": ";
+				if (c.error.empty())
+				{
+					out << file_levels << " levels";
+					if (file_skipped)
+						out << " (" << file_skipped << " skipped)";
+				}
+				else
+				{
+					out << "FAILED: " << c.error;
+					if (file_levels)
+						out << " after " << file_levels << " levels";
+					++failures;
+				}
+				out << std::endl;
+				file_levels = 0;
+				file_skipped = 0;
+			}
+		);
+	}
+
+	// Now the number of levels is known
+	p.seekp(0);
+	LevelSet::writeHeader(p, style, total);
+	p.close();
+	if (!p)
+	{
+		out << "Could not write \"" << pack << "\"" << std::endl;
+		return -1;
+	}
+	out << total << " levels written to " << pack << std::endl;
+	return failures;
+}
@@ -0,0 +1,160 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HXX_XSB
+#define HXX_XSB
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "LevelSet.hxx"
+
+// Importing levels from the text format used by Sokoban collections
+// (.xsb, .sok, .txt):
+//
+//   #  wall       @  player          $  box           .  goal
+//   *  box on a goal                 +  player on a goal
+//   space, - or _  floor, or outside the level
+//
+// Rows may be run-length encoded ("3#" for "###"), with | between rows.
+// Lines of anything else separate levels.  A "Title:" line after a level
+// names it; otherwise a "; name" comment before it does, and failing that
+// it is named after its number in the collection.
+namespace Xsb
+{
+	// Tiles imported levels are drawn with
+	struct Tiles
+	{
+		uint8_t wall;
+		uint8_t cross;
+		uint8_t floor;
+	};
+
+	// The tiles most used for walls, crosses and floor in the given
+	// set's levels, as told apart by its first floor and cross tiles
+	Tiles chooseTiles(const LevelSet &style);
+
+	// A level as read from the text, before it is checked and turned
+	// into a Level: its rows, its name from a comment before it or a
+	// title after it, and its number in the collection
+	struct Text
+	{
+		std::vector<std::string> rows;
+		std::string name;
+		std::string title;
+		uint32_t number;
+	};
+
+	// Turns levels' text into Levels, keeping the space it needs for
+	// that between levels.  Use one per thread.
+	class Converter
+	{
+		public:
+			Converter(const Tiles &tiles);
+
+			// Boxes become Pushy's boxes, and goals crosses; the cells
+			// of the level are not filled in.  Returns false for levels
+			// which can't be played here - too big, too many boxes, or
+			// malformed.  Trailing spaces are trimmed from the rows.
+			bool convert(Text &t, Level &l);
+
+		private:
+			Tiles m_tiles;
+
+			// Squares reached by flood fill from the player
+			std::vector<uint8_t> m_inside;
+			std::vector<int> m_stack;
+	};
+
+	// Reads levels from a stream a line at a time, so that collections
+	// of any size can be read without holding them in memory.
+	class Reader
+	{
+		public:
+			Reader(std::istream &in, const Tiles &tiles);
+
+			// Read and convert the next level, returning false at the
+			// end of the input.  Levels which can't be played here are
+			// skipped.
+			bool next(Level &l);
+
+			// Read the next level's text only, returning false at the
+			// end of the input, so that it can be converted elsewhere.
+			// Levels read this way aren't counted below.
+			bool nextText(Text &t);
+
+			// Levels read and skipped so far
+			uint32_t levels() const
+			{
+				return m_levels;
+			};
+
+			uint32_t skipped() const
+			{
+				return m_skipped;
+			};
+
+		private:
+			// Read a line into m_line, or the line put back, if any
+			bool readLine();
+
+			// Append the rows on a line of level to m_rows
+			void addRows(const std::string &line);
+
+			// Hand over the level read so far, and start the next
+			void take(Text &t);
+
+			std::istream &m_in;
+			Converter m_converter;
+			Text m_text;
+
+			std::string m_line;
+			bool m_put_back;
+
+			// Rows of the level being read; whether anything but level
+			// has been read since they started; its name from a comment
+			// before it or a title after it; and the last comment seen
+			std::vector<std::string> m_rows;
+			size_t m_num_rows;
+			bool m_closed;
+			std::string m_name;
+			std::string m_title;
+			std::string m_comment;
+
+			uint32_t m_levels;
+			uint32_t m_skipped;
+			uint32_t m_number;
+	};
+
+	// Import every level from every given file into an extended level
+	// set in the file pack, drawn with the tiles, sprites and title
+	// screen of the style set.  Files are read a chunk of levels at a
+	// time, converted across all cores, and written in the order given
+	// as soon as they are ready.  Writes one line of results per file;
+	// returns the number of files which couldn't be read, or -1 if the
+	// pack couldn't be written.  Levels read from a file before an
+	// error are kept.
+	int importFiles(const LevelSet &style,
+		const std::vector<std::string> &files, const std::string &pack,
+		std::ostream &out);
+}
+
+#endif
@@ -0,0 +1,480 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <thread>
+
+// System
+#include <unistd.h> // For chdir
+
+// Library
+#include <SDL.h>
+#include <getopt.h>
+
+// Local
+#include "Constants.hxx"
+#include "LevelSet.hxx"
+#include "Scaler.hxx"
+#include "RenderQueue.hxx"
+#include "BandCompositor.hxx"
+#include "ThreadPool.hxx"
+#include "AllocStats.hxx"
+
+//
+// Implementation
+//
+
+// Rendering micro-benchmarks, for checking that changes to the way things
+// are drawn actually make them quicker.  Each test blits tiles or sprites
+// at pseudo-random positions, some partly off screen, for a second.
+
+#define BENCH_MS 1000
+#define BLITS_PER_CHECK 1000
+
+// Positions from a fixed LCG, so every test draws the same thing
+struct Positions
+{
+	uint32_t seed;
+	int w;
+	int h;
+
+	Positions(int sw, int sh): seed(1), w(sw + P2_TILE_WIDTH), h(sh + P2_TILE_HEIGHT)
+	{};
+
+	void next(int &x, int &y)
+	{
+		seed = seed * 1103515245u + 12345u;
+		x = (int)((seed >> 8) % w) - (P2_TILE_WIDTH / 2);
+		seed = seed * 1103515245u + 12345u;
+		y = (int)((seed >> 8) % h) - (P2_TILE_HEIGHT / 2);
+	};
+};
+
+// Run the given function for BENCH_MS, checking the time after every
+// batch of calls, and print calls per second
+template<typename F> static double bench(const char *name, F blit,
+	const char *unit = "blits", int batch = BLITS_PER_CHECK)
+{
+	uint32_t count = 0;
+	AllocCounts allocs = AllocStats::totals();
+	Uint32 start = SDL_GetTicks();
+	Uint32 elapsed;
+	do
+	{
+		for (int i = 0; i < batch; ++i)
+			blit(count++);
+		elapsed = SDL_GetTicks() - start;
+	}
+	while (elapsed < BENCH_MS);
+
+	double rate = (count * 1000.0) / elapsed;
+	std::cout << "  " << name << ": " << (uint32_t)rate << ' ' << unit << "/s";
+	if (AllocStats::enabled())
+	{
+		AllocCounts d = AllocStats::totals() - allocs;
+		std::cout << ", " << ((double)d.news / count) << " allocations and "
+			<< ((double)d.surfaces / count) << " surfaces each";
+	}
+	std::cout << std::endl;
+	return rate;
+}
+
+// Compare run-length encoded sprites with plain colour-keyed blits,
+// including ones clipped at the screen edges
+static bool checkSprites(const std::vector<SDL_Surface*> &keyed,
+	const std::vector<const RleSprite*> &rle)
+{
+	SDL_Surface *a = SDL_DisplayFormat(SDL_GetVideoSurface());
+	SDL_Surface *b = SDL_DisplayFormat(SDL_GetVideoSurface());
+	bool ok = true;
+	Positions p(a->w, a->h);
+	for (size_t i = 0; i < keyed.size() * 8 && ok; ++i)
+	{
+		SDL_FillRect(a, NULL, SDL_MapRGB(a->format, 40, 80, 120));
+		SDL_FillRect(b, NULL, SDL_MapRGB(b->format, 40, 80, 120));
+		int x, y;
+		p.next(x, y);
+		SDL_Rect rect = { (Sint16)x, (Sint16)y, 0, 0 };
+		SDL_BlitSurface(keyed[i % keyed.size()], NULL, a, &rect);
+		rle[i % keyed.size()]->blit(b, x, y);
+		for (int row = 0; row < a->h && ok; ++row)
+		{
+			ok = (memcmp((char*)(a->pixels) + (row * a->pitch),
+				(char*)(b->pixels) + (row * b->pitch),
+				a->w * a->format->BytesPerPixel) == 0);
+		}
+	}
+	SDL_FreeSurface(a);
+	SDL_FreeSurface(b);
+	return ok;
+}
+
+// Blit each of the given surfaces in turn
+static void benchSurfaces(const char *name,
+	const std::vector<SDL_Surface*> &surfaces, SDL_Surface *screen)
+{
+	Positions p(screen->w, screen->h);
+	bench(name, [&](uint32_t n) {
+		int x, y;
+		p.next(x, y);
+		SDL_Rect rect = { (Sint16)x, (Sint16)y, 0, 0 };
+		SDL_BlitSurface(surfaces[n % surfaces.size()], NULL, screen, &rect);
+	});
+}
+
+// Copies of the given colour-keyed surfaces using SDL's own
+// run-length encoding
+static std::vector<SDL_Surface*> rleAccelCopies(
+	const std::vector<SDL_Surface*> &keyed)
+{
+	std::vector<SDL_Surface*> copies;
+	for (size_t i = 0; i < keyed.size(); ++i)
+	{
+		SDL_Surface *copy = SDL_ConvertSurface(keyed[i], keyed[i]->format,
+			SDL_SWSURFACE | SDL_SRCCOLORKEY);
+		SDL_SetColorKey(copy, SDL_SRCCOLORKEY | SDL_RLEACCEL,
+			keyed[i]->format->colorkey);
+		copies.push_back(copy);
+	}
+	return copies;
+}
+
+static void freeSurfaces(std::vector<SDL_Surface*> &surfaces)
+{
+	for (size_t i = 0; i < surfaces.size(); ++i)
+		SDL_FreeSurface(surfaces[i]);
+	surfaces.clear();
+}
+
+// Whole frames - a background and a level's worth of sprites - drawn
+// at native size, then scaled up as Display does
+static void benchScaling(const std::vector<const RleSprite*> &rle,
+	SDL_Surface *frame)
+{
+	SDL_Surface *background = SDL_DisplayFormat(frame);
+	const SDL_PixelFormat *f = frame->format;
+	auto draw = [&]() {
+		SDL_BlitSurface(background, NULL, frame, NULL);
+		Positions p(frame->w, frame->h);
+		for (size_t i = 0; i < P2_MAX_SPRITES_PER_LEVEL; ++i)
+		{
+			int x, y;
+			p.next(x, y);
+			rle[i % rle.size()]->blit(frame, x, y);
+		}
+	};
+
+	double native = bench("frames, native", [&](uint32_t) { draw(); },
+		"frames", 10);
+	for (int filter = 0; filter < 2; ++filter)
+	{
+		for (int factor = 2; factor <= 4; ++factor)
+		{
+			if (!Scaler::supports(factor, (Scaler::Filter)filter))
+				continue;
+
+			SDL_Surface *screen = SDL_CreateRGBSurface(SDL_SWSURFACE,
+				frame->w * factor, frame->h * factor, f->BitsPerPixel,
+				f->Rmask, f->Gmask, f->Bmask, f->Amask);
+			Scaler s(factor, (Scaler::Filter)filter);
+			std::string name = std::string("frames, ")
+				+ (filter ? "Scale2x " : "nearest ") + (char)('0' + factor) + 'x';
+			double rate = bench(name.c_str(), [&](uint32_t) {
+				draw();
+				s.scale(frame, screen);
+			}, "frames", 10);
+			std::cout << "    " << (uint32_t)((native * 100) / rate)
+				<< "% of native frame time" << std::endl;
+			SDL_FreeSurface(screen);
+		}
+	}
+	SDL_FreeSurface(background);
+}
+
+// Queue up a frame like benchScaling's, plus a translucent strip
+// across the middle as menus have
+static void queueFrame(RenderQueue &queue, SDL_Surface *background,
+	const std::vector<const RleSprite*> &rle, bool translucent)
+{
+	queue.blit(RenderQueue::Background, background, NULL, 0, 0);
+	Positions p(queue.width(), queue.height());
+	for (size_t i = 0; i < P2_MAX_SPRITES_PER_LEVEL; ++i)
+	{
+		int x, y;
+		p.next(x, y);
+		queue.sprite(RenderQueue::Objects, *(rle[i % rle.size()]), x, y);
+	}
+	if (translucent)
+	{
+		SDL_Rect strip = {
+			0, (Sint16)(queue.height() / 3),
+			(Uint16)(queue.width()), (Uint16)(queue.height() / 3)
+		};
+		queue.blit(RenderQueue::Overlay, background, &strip, 0, strip.y,
+			127);
+	}
+}
+
+// Check that drawing in bands gives the same pixels as drawing with
+// SDL, leaving out translucency, which is allowed to differ slightly
+static bool checkBands(const std::vector<const RleSprite*> &rle,
+	SDL_Surface *frame)
+{
+	SDL_Surface *background = SDL_DisplayFormat(frame);
+	SDL_Surface *a = SDL_DisplayFormat(frame);
+	SDL_Surface *b = SDL_DisplayFormat(frame);
+	RenderQueue queue(frame->w, frame->h);
+	SurfaceBackend sdl(a);
+	ThreadPool pool(4);
+	BandCompositor bands(b, pool, 7);
+	queueFrame(queue, background, rle, false);
+	queue.draw(sdl);
+	queue.flush(bands);
+
+	bool ok = true;
+	for (int row = 0; row < a->h && ok; ++row)
+	{
+		ok = (memcmp((char*)(a->pixels) + (row * a->pitch),
+			(char*)(b->pixels) + (row * b->pitch),
+			a->w * a->format->BytesPerPixel) == 0);
+	}
+	SDL_FreeSurface(a);
+	SDL_FreeSurface(b);
+	SDL_FreeSurface(background);
+	return ok;
+}
+
+// Whole frames composed in bands and scaled by 4, on more and more
+// threads, up to the given number
+static void benchBands(const std::vector<const RleSprite*> &rle,
+	SDL_Surface *frame, unsigned int cores)
+{
+	SDL_Surface *background = SDL_DisplayFormat(frame);
+	const SDL_PixelFormat *f = frame->format;
+	SDL_Surface *screen = SDL_CreateRGBSurface(SDL_SWSURFACE,
+		frame->w * 4, frame->h * 4, f->BitsPerPixel,
+		f->Rmask, f->Gmask, f->Bmask, f->Amask);
+	RenderQueue queue(frame->w, frame->h);
+
+	double single = 0.0;
+	for (unsigned int threads = 1; threads <= cores;
+		threads = (threads * 2 > cores && threads < cores) ? cores : threads * 2)
+	{
+		ThreadPool pool(threads);
+		BandCompositor bands(frame, pool);
+		Scaler s(4, Scaler::Nearest, &pool);
+		std::string name = std::string("frames in bands, 4x, ")
+			+ std::to_string(threads) + ((threads == 1) ? " thread" : " threads");
+		double rate = bench(name.c_str(), [&](uint32_t) {
+			queueFrame(queue, background, rle, true);
+			queue.flush(bands);
+			s.scale(frame, screen);
+		}, "frames", 10);
+		if (threads == 1)
+			single = rate;
+		else
+		{
+			std::cout << "    " << ((int)((rate * 100) / single) / 100.0)
+				<< " times one thread" << std::endl;
+		}
+	}
+
+	SDL_FreeSurface(screen);
+	SDL_FreeSurface(background);
+}
+
+// Run every test at the given screen depth.  Returns false if the
+// run-length encoded sprites don't draw correctly.
+static bool benchDepth(int bpp, unsigned int cores)
+{
+	if (!SDL_SetVideoMode(P2_LEVEL_WIDTH * P2_TILE_WIDTH,
+		P2_LEVEL_HEIGHT * P2_TILE_HEIGHT, bpp, SDL_SWSURFACE))
+	{
+		std::cerr << "Could not set " << bpp << " bpp video mode: "
+			<< SDL_GetError() << std::endl;
+		return false;
+	}
+
+	// Load afresh, so that graphics start out in the format they are
+	// loaded in, as they did before being converted to display format
+	LevelSet l("LegoLev");
+	SDL_Surface *screen = SDL_DisplayFormat(SDL_GetVideoSurface());
+	bool ok = true;
+
+	std::cout << bpp << " bpp:" << std::endl;
+	for (int converted = 0; converted < 2; ++converted)
+	{
+		if (converted)
+			l.convertToDisplayFormat();
+
+		std::vector<SDL_Surface*> tiles;
+		for (size_t i = 0; i < l.getTiles().size(); ++i)
+			tiles.push_back(l.getTiles()[i]);
+
+		std::vector<SDL_Surface*> keyed;
+		std::vector<const RleSprite*> rle;
+		const TileSet *sets[2] = { &(l.getSprites()), &(l.getPlayerSprites()) };
+		for (int s = 0; s < 2; ++s)
+		{
+			for (size_t i = 0; i < sets[s]->size(); ++i)
+			{
+				keyed.push_back((*sets[s])[i]);
+				rle.push_back(&(sets[s]->sprite(i)));
+			}
+		}
+		std::vector<SDL_Surface*> rleaccel(rleAccelCopies(keyed));
+
+		const char *suffix = converted ? ", display format" : ", as loaded";
+		benchSurfaces((std::string("tiles") + suffix).c_str(), tiles, screen);
+		benchSurfaces((std::string("sprites, colour key") + suffix).c_str(),
+			keyed, screen);
+		benchSurfaces((std::string("sprites, SDL_RLEACCEL") + suffix).c_str(),
+			rleaccel, screen);
+		freeSurfaces(rleaccel);
+
+		if (converted)
+		{
+			Positions p(screen->w, screen->h);
+			bench("sprites, RleSprite", [&](uint32_t n) {
+				int x, y;
+				p.next(x, y);
+				rle[n % rle.size()]->blit(screen, x, y);
+			});
+
+			if (!checkSprites(keyed, rle))
+			{
+				std::cout << "  Run-length encoded sprites do not match "
+					"colour-keyed blits" << std::endl;
+				ok = false;
+			}
+
+			benchScaling(rle, screen);
+
+			if (!checkBands(rle, screen))
+			{
+				std::cout << "  Frames drawn in bands do not match frames "
+					"drawn by SDL" << std::endl;
+				ok = false;
+			}
+			benchBands(rle, screen, cores);
+		}
+	}
+
+	SDL_FreeSurface(screen);
+	return ok;
+}
+
+int main(int argc, char *argv[])
+{
+	std::string data_dir(P2_PKGDATADIR);
+	std::vector<int> depths;
+	unsigned int cores = std::thread::hardware_concurrency();
+
+	struct option long_options[] =
+	{
+		{"help", no_argument, NULL, 'h'},
+		{"data", required_argument, NULL, 'd'},
+		{"bpp", required_argument, NULL, 'b'},
+		{"threads", required_argument, NULL, 't'},
+		{0, 0, 0, 0}
+	};
+
+	int optchar;
+	int optindex;
+	while ((optchar =
+		getopt_long(argc, argv, "hd:b:t:", long_options, &optindex)) > -1)
+	{
+		switch (optchar)
+		{
+			case 'd':
+				data_dir = optarg;
+				break;
+			case 'b':
+				depths.push_back(atoi(optarg));
+				break;
+			case 't':
+				cores = atoi(optarg);
+				break;
+			default:
+				std::cout << "Usage: " << argv[0] << " [OPTION]..." << std::endl
+					<< "Measure drawing speed." << std::endl << std::endl
+					<< "  -d, --data=DIR      load graphics from DIR" << std::endl
+					<< "  -b, --bpp=BITS      screen depth; may be repeated"
+					<< std::endl
+					<< "                      (default 16, 24 and 32)" << std::endl
+					<< "  -t, --threads=N     draw on up to N threads"
+					<< std::endl
+					<< "                      (default one per core)" << std::endl
+					<< "  -h, --help          display this help and exit"
+					<< std::endl << std::endl
+					<< "Set SDL_VIDEODRIVER=dummy to run without a display."
+					<< std::endl;
+				return (optchar == 'h') ? 0 : 1;
+		}
+	}
+	if (cores == 0)
+		cores = 1;
+	if (depths.empty())
+	{
+		depths.push_back(16);
+		depths.push_back(24);
+		depths.push_back(32);
+	}
+
+	if (chdir(data_dir.c_str()) < 0)
+	{
+		std::cerr << "Could not change working directory to \""
+			<< data_dir << "\": " << strerror(errno) << std::endl;
+		return 1;
+	}
+
+	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_NOPARACHUTE) < 0)
+	{
+		std::cerr << "Could not initialise SDL: " << SDL_GetError() << std::endl;
+		return 1;
+	}
+	atexit(SDL_Quit);
+
+	try
+	{
+		bool ok = true;
+		for (size_t i = 0; i < depths.size(); ++i)
+			ok = benchDepth(depths[i], cores) && ok;
+		return ok ? 0 : 1;
+	}
+	catch (std::exception &e)
+	{
+		std::cerr << "Could not load graphics: " << e.what() << std::endl;
+		return 1;
+	}
+}
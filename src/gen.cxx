@@ -0,0 +1,209 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <stdexcept>
+#include <chrono>
+
+// System
+#include <unistd.h> // For chdir, getcwd
+
+// Library
+#include <SDL.h> // For SDL_main, where the platform needs it
+#include <getopt.h>
+
+// Local
+#include "Constants.hxx"
+#include "LevelSet.hxx"
+#include "Generator.hxx"
+
+//
+// Implementation
+//
+
+// Generate new levels into an extended level set, for playing with
+// "pushy2 --levels".  See Generator.hxx for how levels are made.
+
+int main(int argc, char *argv[])
+{
+	std::string data_dir(P2_PKGDATADIR);
+	std::string style("LegoLev");
+	Generator::Options o;
+
+	struct option long_options[] =
+	{
+		{"help", no_argument, NULL, 'h'},
+		{"data", required_argument, NULL, 'd'},
+		{"style", required_argument, NULL, 's'},
+		{"count", required_argument, NULL, 'n'},
+		{"seed", required_argument, NULL, 'S'},
+		{"boxes", required_argument, NULL, 'b'},
+		{"balls", required_argument, NULL, 'B'},
+		{"pushes", required_argument, NULL, 'p'},
+		{"tries", required_argument, NULL, 'T'},
+		{"states", required_argument, NULL, 'm'},
+		{"threads", required_argument, NULL, 't'},
+		{"name", required_argument, NULL, 'N'},
+		{0, 0, 0, 0}
+	};
+
+	bool usage = false;
+	bool help = false;
+	int optchar;
+	int optindex;
+	while ((optchar = getopt_long(argc, argv, "hd:s:n:S:b:B:p:T:m:t:N:",
+		long_options, &optindex)) > -1)
+	{
+		switch (optchar)
+		{
+			case 'd':
+				data_dir = optarg;
+				break;
+			case 's':
+				style = optarg;
+				break;
+			case 'n':
+				o.count = strtoul(optarg, NULL, 10);
+				break;
+			case 'S':
+				o.seed = strtoul(optarg, NULL, 10);
+				break;
+			case 'b':
+				// Either a number of boxes or a range
+				if (sscanf(optarg, "%d-%d", &(o.min_boxes), &(o.max_boxes)) < 2)
+					o.max_boxes = o.min_boxes;
+				break;
+			case 'B':
+				o.max_balls = atoi(optarg);
+				break;
+			case 'p':
+				o.min_pushes = atoi(optarg);
+				break;
+			case 'T':
+				o.tries = atoi(optarg);
+				break;
+			case 'm':
+				o.max_states = strtoul(optarg, NULL, 10);
+				break;
+			case 't':
+				o.threads = atoi(optarg);
+				break;
+			case 'N':
+				o.name = optarg;
+				break;
+			case 'h':
+				help = true;
+				// fall through
+			default:
+				usage = true;
+		}
+	}
+	if (o.min_boxes < 1 || o.max_boxes < o.min_boxes || o.max_balls < 0
+		|| o.max_boxes + o.max_balls >= P2_MAX_SPRITES_PER_LEVEL
+		|| o.tries < 1)
+	{
+		std::cerr << "Levels need at least one box, and at most "
+			<< (P2_MAX_SPRITES_PER_LEVEL - 1) << " boxes and balls" << std::endl;
+		usage = true;
+	}
+	if (usage || optind != argc - 1)
+	{
+		std::cout << "Usage: " << argv[0] << " [OPTION]... PACK" << std::endl
+			<< "Generate solvable levels into the level set PACK." << std::endl
+			<< std::endl
+			<< "  -d, --data=DIR      load the style set from DIR" << std::endl
+			<< "  -s, --style=FILE    take tiles, sprites and title screen"
+			<< std::endl
+			<< "                      from level set FILE (default LegoLev)"
+			<< std::endl
+			<< "  -n, --count=N       generate N levels (default 100)"
+			<< std::endl
+			<< "  -S, --seed=N        random seed (default 1)" << std::endl
+			<< "  -b, --boxes=N[-M]   N boxes, or N to M (default 2-4)"
+			<< std::endl
+			<< "  -B, --balls=N       up to N balls (default 1)" << std::endl
+			<< "  -p, --pushes=N      need at least N pushes (default 10)"
+			<< std::endl
+			<< "  -T, --tries=N       keep the best of N candidates per level"
+			<< std::endl
+			<< "                      (default 8)" << std::endl
+			<< "  -m, --states=N      search at most N positions per candidate"
+			<< std::endl
+			<< "                      (default 200000)" << std::endl
+			<< "  -t, --threads=N     generate on N threads" << std::endl
+			<< "                      (default one per core)" << std::endl
+			<< "  -N, --name=NAME     name levels NAME and their number"
+			<< std::endl
+			<< "                      (default Random)" << std::endl
+			<< "  -h, --help          display this help and exit"
+			<< std::endl;
+		return help ? 0 : 1;
+	}
+
+	// The pack is given relative to where we were started from
+	std::string pack(argv[optind]);
+	char cwd[4096];
+	if (pack[0] != '/')
+	{
+		if (!getcwd(cwd, sizeof(cwd)))
+		{
+			std::cerr << "Could not get working directory: "
+				<< strerror(errno) << std::endl;
+			return 1;
+		}
+		pack = std::string(cwd) + '/' + pack;
+	}
+
+	if (chdir(data_dir.c_str()) < 0)
+	{
+		std::cerr << "Could not change working directory to \""
+			<< data_dir << "\": " << strerror(errno) << std::endl;
+		return 1;
+	}
+
+	try
+	{
+		LevelSet l(style.c_str(), false);
+		auto start = std::chrono::steady_clock::now();
+		int result = Generator::generate(l, o, pack, std::cout);
+		auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - start).count();
+		std::cerr << "Generated in " << ms << "ms" << std::endl;
+		return (result == 0) ? 0 : 1;
+	}
+	catch (std::exception &e)
+	{
+		std::cerr << "Could not load level set: " << e.what() << std::endl;
+		return 1;
+	}
+}
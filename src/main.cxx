@@ -29,6 +29,11 @@
 #include <cerrno>
 #include <cstring>
 #include <cstdlib>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
 
 // System
 #ifndef WIN32
@@ -44,6 +49,20 @@
 
 // Local
 #include "MainMenu.hxx"
+#include "Replay.hxx"
+#include "Simulation.hxx"
+#include "Display.hxx"
+#include "Transition.hxx"
+#include "Headless.hxx"
+#include "RenderPipeline.hxx"
+#include "BandCompositor.hxx"
+#include "ThreadPool.hxx"
+#include "FrameCapture.hxx"
+#include "AssetWatcher.hxx"
+#include "LevelView.hxx"
+#include "Xsb.hxx"
+#include "Analyser.hxx"
+#include "AllocStats.hxx"
 #ifdef WIN32
 #include "resource.h"
 #endif
@@ -53,15 +72,106 @@
 // Implementation
 //
 
+// Keyboard events are let through only so that waitForInput() wakes
+// up for them; their effect is read from SDL_GetKeyState
 int event_filter(const SDL_Event *event)
 {
-	if (event->type == SDL_QUIT)
-		return 1;
+	switch (event->type)
+	{
+		case SDL_QUIT:
+		case SDL_KEYDOWN:
+		case SDL_KEYUP:
+		case SDL_ACTIVEEVENT:
+		case SDL_VIDEOEXPOSE:
+			return 1;
+	}
 	return 0;
 }
 
+// Sleep until an event arrives, or for at most the given time if it
+// isn't P2_IDLE_FOREVER.  SDL 1.2 has no SDL_WaitEventTimeout, so
+// timed waits check for events in the same way SDL_WaitEvent does.
+static void waitForInput(Uint32 timeout)
+{
+	if (timeout == P2_IDLE_FOREVER)
+	{
+		SDL_WaitEvent(NULL);
+		return;
+	}
+
+	Uint32 start = SDL_GetTicks();
+	for (;;)
+	{
+		SDL_PumpEvents();
+		if (SDL_PeepEvents(NULL, 1, SDL_PEEKEVENT, SDL_ALLEVENTS) > 0)
+			return;
+		Uint32 waited = SDL_GetTicks() - start;
+		if (waited >= timeout)
+			return;
+		SDL_Delay(std::min<Uint32>(10, timeout - waited));
+	}
+}
+
+// With --render-stats and allocation counting, say how much each
+// GameLoop allocated while it ran, including its construction
+static void reportLoopAllocations(int loop, uint32_t frames,
+	const AllocCounts &start)
+{
+	AllocCounts d = AllocStats::totals() - start;
+	std::cout << "Game loop " << loop << ": " << frames << " frames, "
+		<< d.news << " allocations, " << d.surfaces << " surfaces";
+	if (frames)
+	{
+		std::cout << " (" << ((double)d.news / frames) << " and "
+			<< ((double)d.surfaces / frames) << " per frame)";
+	}
+	std::cout << std::endl;
+}
+
+// Wait as need be before starting the next frame.  When frames are drawn
+// on a thread of their own, the main loop runs once per simulation tick,
+// so that input is picked up as soon as the simulation can act on it.
+// Otherwise it waits for the flip, or if that doesn't wait for vsync
+// (delay is true), sleeps a while.
+static void pace(const RenderPipeline &pipeline, bool delay,
+	Uint32 frame_start)
+{
+	if (pipeline.threaded())
+	{
+		Uint32 spent = SDL_GetTicks() - frame_start;
+		if (spent < (1000 / P2_TICK_RATE))
+			SDL_Delay((1000 / P2_TICK_RATE) - spent);
+	}
+	else if (delay)
+		SDL_Delay(10);
+}
+
 int main(int argc, char *argv[])
 {
+	// Window size, as a multiple of the native size
+	int scale = 1;
+	Scaler::Filter filter = Scaler::Nearest;
+
+	// Report drawing done per frame on exit
+	int render_stats = 0;
+
+	// Draw frames on a thread of their own, where SDL allows it
+	int no_render_thread = 0;
+
+	// Threads to compose and scale each frame with.  By default, one
+	// per core when scaled up, where frames are big enough to be worth
+	// splitting, and just the one otherwise.
+	int draw_threads = 0;
+
+	// File to record every frame drawn in, if any
+	std::string capture_file;
+
+	// Reload data files when they are edited
+	int watch = 0;
+
+	// Level set to play, if not the standard one
+	std::string levels_file;
+
 #ifndef WIN32
 	//
 	// Command-line option parsing.
@@ -73,14 +183,51 @@ int main(int argc, char *argv[])
 	// Flags for argument-less option presence
 	int help = 0;
 	int version = 0;
+	int selftest = 0;
+	int scale2x = 0;
+	int golden = 0;
+	int alloc_check = 0;
+
+	// Replay recording & verification
+	std::string record_file;
+	std::vector<std::string> replay_files;
+	float replay_speed = 0.0f;
+
+	// Directory to save level thumbnails in
+	std::string thumbnail_dir;
+
+	// Level set to import Sokoban collections into, and the collections
+	std::string import_pack;
+	std::vector<std::string> import_files;
+
+	// File to write level difficulty measures to
+	std::string analyse_file;
 
 	// Supported command-line options
 	struct option long_options[] =
 	{
 		{"help", no_argument, &help, 'h'},
-		{"version", no_argument, &version, 'v'}
+		{"version", no_argument, &version, 'v'},
+		{"record", required_argument, NULL, 'r'},
+		{"replay", required_argument, NULL, 'p'},
+		{"speed", required_argument, NULL, 's'},
+		{"selftest", no_argument, &selftest, 't'},
+		{"scale", required_argument, NULL, 'S'},
+		{"scale2x", no_argument, &scale2x, 1},
+		{"draw-threads", required_argument, NULL, 'j'},
+		{"render-stats", no_argument, &render_stats, 1},
+		{"no-render-thread", no_argument, &no_render_thread, 1},
+		{"golden", no_argument, &golden, 1},
+		{"alloc-check", no_argument, &alloc_check, 1},
+		{"thumbnails", required_argument, NULL, 'T'},
+		{"capture", required_argument, NULL, 'c'},
+		{"watch", no_argument, &watch, 1},
+		{"levels", required_argument, NULL, 'l'},
+		{"import", required_argument, NULL, 'i'},
+		{"analyse", required_argument, NULL, 'a'},
+		{0, 0, 0, 0}
 	};
-	const char optstring[] = "hv";
+	const char optstring[] = "hvr:p:s:tS:T:j:c:l:i:a:";
 
 	// Option parsing loop
 	char optchar;
@@ -103,6 +250,60 @@ int main(int argc, char *argv[])
 			case 'v':
 				version = 1;
 				break;
+			case 't':
+				selftest = 1;
+				break;
+			case 'r':
+				record_file = optarg;
+				break;
+			case 'p':
+				replay_files.push_back(optarg);
+				break;
+			case 'T':
+				thumbnail_dir = optarg;
+				break;
+			case 'c':
+				capture_file = optarg;
+				break;
+			case 'l':
+				levels_file = optarg;
+				break;
+			case 'i':
+				import_pack = optarg;
+				break;
+			case 'a':
+				analyse_file = optarg;
+				break;
+			case 'S':
+				scale = atoi(optarg);
+				if (scale < 1 || scale > 4)
+				{
+					std::cerr << "Scale must be 1, 2, 3 or 4" << std::endl;
+					return -1;
+				}
+				break;
+			case 'j':
+				draw_threads = atoi(optarg);
+				if (draw_threads < 1)
+				{
+					std::cerr << "Draw threads must be at least 1" << std::endl;
+					return -1;
+				}
+				break;
+			case 's':
+				if (strcmp(optarg, "max") == 0)
+					replay_speed = 0.0f;
+				else
+				{
+					replay_speed = atof(optarg);
+					if (replay_speed <= 0.0f)
+					{
+						std::cerr << "Speed must be \"max\" or a positive number"
+							<< std::endl;
+						return -1;
+					}
+				}
+				break;
 			default:
 				std::cerr << "Unrecognised option" << std::endl;
 				return -1;
@@ -117,6 +318,54 @@ int main(int argc, char *argv[])
 		std::cout << "\tPrint this message" << std::endl;
 		std::cout << "-v, --version" << std::endl;
 		std::cout << "\tDisplay program version and build options" << std::endl;
+		std::cout << "-r, --record FILE" << std::endl;
+		std::cout << "\tRecord every attempt at every level to FILE" << std::endl;
+		std::cout << "-p, --replay FILE [FILE...]" << std::endl;
+		std::cout << "\tVerify recordings without a display, then exit" << std::endl;
+		std::cout << "-s, --speed max|N" << std::endl;
+		std::cout << "\tPace verification at N times real time (default: max)"
+			<< std::endl;
+		std::cout << "-t, --selftest" << std::endl;
+		std::cout << "\tCheck the simulation gives identical results at"
+			" different frame rates" << std::endl;
+		std::cout << "-S, --scale N" << std::endl;
+		std::cout << "\tMake the window N times bigger (1 to 4)" << std::endl;
+		std::cout << "--scale2x" << std::endl;
+		std::cout << "\tSmooth edges when scaling by 2 or 4" << std::endl;
+		std::cout << "-j, --draw-threads N" << std::endl;
+		std::cout << "\tDraw each frame in bands on N threads (default: one"
+			" per core when scaled, otherwise 1)" << std::endl;
+		std::cout << "--render-stats" << std::endl;
+		std::cout << "\tPrint average draws and overdraw per frame on exit"
+			<< std::endl;
+		std::cout << "--no-render-thread" << std::endl;
+		std::cout << "\tDraw frames on the main thread" << std::endl;
+		std::cout << "--golden" << std::endl;
+		std::cout << "\tRender scripted frames without a display and print"
+			" their hashes, then exit" << std::endl;
+		std::cout << "--alloc-check" << std::endl;
+		std::cout << "\tPlay every level without a display, failing if"
+			" gameplay allocates memory (needs --enable-alloc-stats)"
+			<< std::endl;
+		std::cout << "-T, --thumbnails DIR" << std::endl;
+		std::cout << "\tSave a thumbnail of every level in DIR, then exit"
+			<< std::endl;
+		std::cout << "-c, --capture FILE" << std::endl;
+		std::cout << "\tRecord every frame drawn, as FILE.y4m video, or PPM"
+			" images (one file each if FILE holds %d)" << std::endl;
+		std::cout << "-l, --levels FILE" << std::endl;
+		std::cout << "\tPlay the levels in FILE instead of the standard set"
+			<< std::endl;
+		std::cout << "-i, --import FILE XSB [XSB...]" << std::endl;
+		std::cout << "\tImport Sokoban collections into a level set in FILE,"
+			" then exit" << std::endl;
+		std::cout << "-a, --analyse FILE" << std::endl;
+		std::cout << "\tWrite difficulty measures for every level to FILE,"
+			" as JSON if it ends in .json or CSV otherwise, then exit"
+			<< std::endl;
+		std::cout << "--watch" << std::endl;
+		std::cout << "\tReload levels, tiles, sprites and glyphs when their"
+			" files are edited" << std::endl;
 		return 0;
 	}
 	else if (version)
@@ -125,13 +374,152 @@ int main(int argc, char *argv[])
 		std::cout << "Built with: " << P2_CONFIGURE_OPTS << std::endl;
 		return 0;
 	}
+
+	if (scale2x)
+		filter = Scaler::Scale2x;
+	if (scale > 1 && !Scaler::supports(scale, filter))
+	{
+		std::cerr << "Scale2x can only scale by 2 or 4" << std::endl;
+		return -1;
+	}
+
+	// Any further arguments are collections to import,
+	// or otherwise more replays to verify
+	for (int i = optind; i < argc; ++i)
+	{
+		if (import_pack.empty())
+			replay_files.push_back(argv[i]);
+		else
+			import_files.push_back(argv[i]);
+	}
+
+	// Relative paths given on the command line must be resolved before
+	// changing to the data directory, below
+	char cwd[4096];
+	if (!getcwd(cwd, sizeof(cwd)))
+	{
+		std::cerr << "Could not get working directory: "
+			<< strerror(errno) << std::endl;
+		return 1;
+	}
+	for (auto i = replay_files.begin(); i != replay_files.end(); ++i)
+	{
+		if ((*i)[0] != '/')
+			*i = std::string(cwd) + '/' + *i;
+	}
+	for (auto i = import_files.begin(); i != import_files.end(); ++i)
+	{
+		if ((*i)[0] != '/')
+			*i = std::string(cwd) + '/' + *i;
+	}
+	if (!import_pack.empty() && import_pack[0] != '/')
+		import_pack = std::string(cwd) + '/' + import_pack;
+	if (!analyse_file.empty() && analyse_file[0] != '/')
+		analyse_file = std::string(cwd) + '/' + analyse_file;
+	if (!levels_file.empty() && levels_file[0] != '/')
+		levels_file = std::string(cwd) + '/' + levels_file;
+	if (!thumbnail_dir.empty() && thumbnail_dir[0] != '/')
+		thumbnail_dir = std::string(cwd) + '/' + thumbnail_dir;
+	if (!capture_file.empty() && capture_file[0] != '/')
+		capture_file = std::string(cwd) + '/' + capture_file;
+
+	std::ofstream record;
+	if (!record_file.empty())
+	{
+		record.open(record_file.c_str(), std::ios_base::binary);
+		if (!record.is_open())
+		{
+			std::cerr << "Could not open \"" << record_file
+				<< "\" for recording" << std::endl;
+			return 1;
+		}
+		Replay::writeHeader(record);
+		Replay::output = &record;
+	}
+
+	// Replays are verified, and golden frames and thumbnails are
+	// rendered, headless - no need to touch the display
+	bool render_headless = (golden || alloc_check || !thumbnail_dir.empty());
+	if (!replay_files.empty() || selftest || render_headless
+		|| !import_pack.empty() || !analyse_file.empty())
+	{
+		if (chdir(P2_PKGDATADIR) < 0)
+		{
+			std::cerr << "Could not change working directory to \""
+				<< P2_PKGDATADIR << "\": " << strerror(errno) << std::endl;
+			return 1;
+		}
+		LevelSet l(levels_file.empty() ? "LegoLev" : levels_file.c_str(),
+			render_headless);
+		int failures = 0;
+		if (!import_pack.empty())
+		{
+			auto start = std::chrono::steady_clock::now();
+			int result = Xsb::importFiles(l, import_files, import_pack,
+				std::cout);
+			auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now() - start).count();
+			std::cerr << "Imported in " << ms << "ms" << std::endl;
+			if (result < 0)
+				return 1;
+			failures += result;
+		}
+		if (!analyse_file.empty())
+		{
+			auto start = std::chrono::steady_clock::now();
+			int result = Analyser::analyseAll(l, analyse_file, std::cout);
+			auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now() - start).count();
+			std::cerr << "Analysed in " << ms << "ms" << std::endl;
+			if (result < 0)
+				return 1;
+			failures += result;
+		}
+		if (selftest)
+			failures += Simulation::selfTest(l, std::cout);
+		if (!replay_files.empty())
+			failures += Replay::verifyFiles(l, replay_files, replay_speed,
+				std::cout);
+		if (render_headless)
+		{
+			Alphabet a("Alphabet");
+			Display::setHeadless(P2_TILE_WIDTH * P2_LEVEL_WIDTH,
+				P2_TILE_HEIGHT * P2_LEVEL_HEIGHT);
+			if (golden)
+			{
+				auto start = std::chrono::steady_clock::now();
+				int frames = Headless::renderGolden(a, l, std::cout);
+				auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+					std::chrono::steady_clock::now() - start).count();
+				std::cerr << frames << " frames in " << ms << "ms" << std::endl;
+			}
+			if (!thumbnail_dir.empty())
+				failures += Headless::writeThumbnails(l, thumbnail_dir,
+					std::cerr);
+			if (alloc_check)
+				failures += Headless::checkAllocations(a, l, std::cout);
+		}
+		return (failures ? 1 : 0);
+	}
 #endif
 
 	//
 	// Initialise SDL
 	//
 
-	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) < 0)
+	// Drawing and flipping on one thread while events are pumped on
+	// another is only safe if SDL pumps them on a thread of its own,
+	// which SDL 1.2 only supports on some platforms (X11, for one).
+	// Failing that, everything happens on the main thread.
+	bool render_thread = false;
+#ifndef WIN32
+	if (!no_render_thread && SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER
+		| SDL_INIT_EVENTTHREAD) == 0)
+	{
+		render_thread = true;
+	}
+#endif
+	if (!render_thread && SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) < 0)
 	{
 		std::cerr << "Could not initialise SDL: " << SDL_GetError() << std::endl;
 		return 1;
@@ -169,18 +557,30 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 #endif
+	const char *levels =
+		levels_file.empty() ? "LegoLev" : levels_file.c_str();
 	Alphabet a("Alphabet");
-	LevelSet l("LegoLev");
+	LevelSet l(levels);
 
 	Uint32 flags = SDL_HWSURFACE | SDL_DOUBLEBUF;
 	SDL_WM_SetCaption("Pushy II", "Pushy II");
 	SDL_ShowCursor(SDL_DISABLE);
 	SDL_SetEventFilter(event_filter);
-	SDL_Surface *screen = SDL_SetVideoMode(
+	if (draw_threads == 0 && scale == 1)
+		draw_threads = 1;
+	ThreadPool draw_pool(draw_threads);
+	// Scaling is quickest with 32-bit pixels
+	SDL_Surface *screen = Display::setVideoMode(l,
 		P2_TILE_WIDTH * P2_LEVEL_WIDTH,
 		P2_TILE_HEIGHT * P2_LEVEL_HEIGHT,
-		24, flags
+		(scale > 1) ? 32 : 24, flags, scale, filter,
+		(draw_pool.size() > 1) ? &draw_pool : NULL
 	);
+	if (!screen)
+	{
+		std::cerr << "Could not set video mode: " << SDL_GetError() << std::endl;
+		return 1;
+	}
 
 #ifndef WIN32
 	SDL_WM_SetIcon(l.getPlayerSprites()[2], NULL);
@@ -189,28 +589,101 @@ int main(int argc, char *argv[])
 	// Did we actually get a hardware, double-buffered surface?
 	// If not, it probably isn't vsynced, and we should include
 	// a sleep in the main loop
-	bool delay = ((screen->flags & flags) != flags);
+	bool delay = ((Display::screen()->flags & flags) != flags);
 
 	// Create main menu loop
 	std::shared_ptr<GameLoop> g(new MainMenu(a, l));
 
+	std::unique_ptr<AssetWatcher> watcher;
+	if (watch)
+	{
+		try
+		{
+			watcher.reset(new AssetWatcher(l, levels, "Alphabet"));
+		}
+		catch (std::exception &e)
+		{
+			std::cerr << "Could not watch data files: " << e.what()
+				<< std::endl;
+			return 1;
+		}
+	}
+
+	// Frames are captured by the pipeline, so this must outlive it
+	std::unique_ptr<FrameCapture> capture;
+	if (!capture_file.empty())
+	{
+		try
+		{
+			capture.reset(new FrameCapture(capture_file, screen));
+		}
+		catch (std::exception &e)
+		{
+			std::cerr << "Could not capture to \"" << capture_file
+				<< "\": " << e.what() << std::endl;
+			return 1;
+		}
+	}
+
+	// Each frame is queued up by the current loop, then drawn in one go
+	std::unique_ptr<RenderBackend> frame_backend;
+	if (draw_pool.size() > 1)
+		frame_backend.reset(new BandCompositor(screen, draw_pool));
+	else
+		frame_backend.reset(new SurfaceBackend(screen));
+	RenderPipeline pipeline(*frame_backend, screen->w, screen->h,
+		render_thread);
+	pipeline.capture(capture.get());
+
 	bool quit = false;
 	Uint32 frametime = SDL_GetTicks();
 	Uint32 old_frametime = frametime;
 
+	bool alloc_stats = (render_stats && AllocStats::enabled());
+	AllocCounts start_allocs = AllocStats::totals();
+	AllocCounts loop_allocs = start_allocs;
+	uint32_t loop_frames = 0;
+	int loop = 0;
+
 	while (!quit)
 	{
-		// Process events
+		// Process events.  The window must be redrawn if it was
+		// uncovered, even if its contents haven't changed.
+		bool redraw = false;
 		SDL_Event e;
 		while (SDL_PollEvent(&e))
 		{
-			// Only quit events are allowed on the queue
-			quit = true;
+			if (e.type == SDL_QUIT)
+				quit = true;
+			else if (e.type == SDL_VIDEOEXPOSE)
+				redraw = true;
+		}
+
+		// Swap in data files reloaded since the last frame, once the
+		// render thread is done with the old data, and have the loop
+		// rebuild whatever it made from them
+		if (watcher && watcher->ready())
+		{
+			pipeline.finish();
+			unsigned changed = watcher->apply(l, a);
+			if (changed)
+			{
+				LevelView::reloaded(changed);
+				g = g->reload(changed);
+				redraw = true;
+			}
 		}
 
-		// Update state & render current frame
+		// Update state & render current frame, unless it is the same
+		// as the last one
 		bool keep = g->update((float)(frametime - old_frametime) / 1000.0f,
-			SDL_GetKeyState(NULL), screen);
+			SDL_GetKeyState(NULL), pipeline.queue());
+		++loop_frames;
+		Uint32 idle = keep ? g->idle() : 0;
+		if (idle && !redraw)
+			pipeline.discard();
+		else
+			pipeline.submit();
 
 		// If the current GameLoop should not be kept,
 		// construct the next one, or exit
@@ -218,99 +691,92 @@ int main(int argc, char *argv[])
 		{
 			std::unique_ptr<GameLoopFactory> f(g->nextLoop());
 			g.reset();
+			if (alloc_stats)
+				reportLoopAllocations(loop, loop_frames, loop_allocs);
+			loop_allocs = AllocStats::totals();
+			loop_frames = 0;
+			++loop;
 
 			if (f.get() == 0)
 				break;
 			else
 			{
+				// Let the render thread finish with the old GameLoop's
+				// last frame before the new one sets up its graphics
+				pipeline.finish();
 				g = (*f)();
 
-				// Quick & dirty transition between the last
-				// frame from the old GameLoop & the first frame
-				// from the new one
+				// Wipe from the last frame from the old GameLoop
+				// to the first frame from the new one
 				SDL_Surface *old_sf = SDL_DisplayFormat(screen);
 				SDL_Surface *new_sf = SDL_DisplayFormat(screen);
-				g->update(0.0f, SDL_GetKeyState(NULL), new_sf);
-				float y = 0.0f;
+				SurfaceBackend new_backend(new_sf);
+				g->update(0.0f, SDL_GetKeyState(NULL), pipeline.queue());
+				pipeline.queue().flush(new_backend);
+
+				Transition t(old_sf, new_sf);
 				frametime = SDL_GetTicks();
 				old_frametime = frametime;
-				while ((y - (float)P2_TILE_HEIGHT)
-					< (float)(P2_TILE_HEIGHT * P2_LEVEL_HEIGHT))
+				while (t.update((float)(frametime - old_frametime) / 1000.0f,
+					pipeline.queue()))
 				{
-					// Start by rendering the destination
-					SDL_BlitSurface(new_sf, NULL, screen, NULL);
-
-					// Move the bottom of the vertical wipe down
-					// based on time elapsed since last frame
-					y += 512.0f * ((float)(frametime - old_frametime) / 1000.0f);
-
-					// Top of the vertical wipe is two tile
-					// heights above the bottom - but not off-screen
-					float i = y - (float)(P2_TILE_HEIGHT * 2);
-					if (i < 0.0f)
-						i = 0.0f;
-
-					// Vertical wipe by rendering a series of
-					// single rows each 1 pixel high
-					for (; i <= y; ++i)
-					{
-						if ((Sint16)i >= (P2_TILE_HEIGHT * P2_LEVEL_HEIGHT))
-							break;
-
-						SDL_Rect src = {
-							0, (Sint16)i, P2_TILE_WIDTH * P2_LEVEL_WIDTH, 1
-						};
-						SDL_Rect dst = {
-							0, (Sint16)i, 0, 0
-						};
-
-						// Transparency ranges from 0 to 255 over the height
-						// of the wipe (2 tiles)
-						SDL_SetAlpha(old_sf, SDL_SRCALPHA,
-							255 - (Uint8)(((y - i) / (float)(P2_TILE_HEIGHT * 2)) * 255.0f));
-
-						SDL_BlitSurface(old_sf, &src, screen, &dst);
-					}
-
-					// Render the rest of the start surface
-					// opaque below the wipe
-					if (y < (float)(P2_TILE_HEIGHT * P2_LEVEL_HEIGHT))
-					{
-						SDL_SetAlpha(old_sf, 0, 0);
-						SDL_Rect src = {
-							0, (Sint16)y, P2_TILE_WIDTH * P2_LEVEL_WIDTH,
-							(Uint16)(old_sf->h - (int)y)
-						};
-						SDL_Rect dst = {
-							0, (Sint16)y, 0, 0
-						};
-						SDL_BlitSurface(old_sf, &src, screen, &dst);
-					}
-
-					SDL_Flip(screen);
-					if (delay)
-						SDL_Delay(10);
+					pipeline.submit();
+					pace(pipeline, delay, frametime);
 
 					old_frametime = frametime;
 					frametime = SDL_GetTicks();
 				}
 
-				SDL_FreeSurface(old_sf);
-				SDL_FreeSurface(new_sf);
-
 				// Don't jump game state ahead by the time taken
 				// to perform the transition
 				frametime = SDL_GetTicks();
 			}
 		}
 
-		SDL_Flip(screen);
-		if (delay)
-			SDL_Delay(10);
+		// Static screens sleep until there is input to react to
+		if (idle && !quit)
+			waitForInput(idle);
+		else
+			pace(pipeline, delay, frametime);
 
 		old_frametime = frametime;
 		frametime = SDL_GetTicks();
 	}
 
-	return 0;
+	pipeline.finish();
+	int result = 0;
+	if (capture)
+	{
+		bool written = capture->finish();
+		std::cerr << "Captured " << capture->captured() << " frames ("
+			<< capture->dropped() << " dropped)" << std::endl;
+		if (!written)
+		{
+			std::cerr << "Capture failed: " << capture->error() << std::endl;
+			result = 1;
+		}
+	}
+	if (alloc_stats && g)
+		reportLoopAllocations(loop, loop_frames, loop_allocs);
+	RenderStats t = pipeline.totals();
+	if (render_stats && t.frames)
+	{
+		std::cout << "Frames: " << t.frames << std::endl;
+		std::cout << "Draws per frame: " << (t.draws / t.frames) << std::endl;
+		std::cout << "Batches per frame: " << (t.batches / t.frames)
+			<< std::endl;
+		std::cout << "Overdraw: " << ((double)t.pixels
+			/ ((double)t.frames * screen->w * screen->h))
+			<< std::endl;
+		if (alloc_stats)
+		{
+			AllocCounts d = AllocStats::totals() - start_allocs;
+			std::cout << "Allocations per frame: "
+				<< ((double)d.news / t.frames) << std::endl;
+			std::cout << "Surfaces per frame: "
+				<< ((double)d.surfaces / t.frames) << std::endl;
+		}
+	}
+
+	return result;
 }
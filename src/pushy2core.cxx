@@ -0,0 +1,358 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <string>
+#include <vector>
+#include <cstring>
+#include <exception>
+
+// System
+
+// Library
+
+// Local
+#include "pushy2core.h"
+#include "LevelSet.hxx"
+#include "Board.hxx"
+#include "Simulation.hxx"
+#include "BatchEnv.hxx"
+#include "Analyser.hxx"
+
+//
+// Implementation
+//
+
+// The C interface mirrors these, so they had better agree
+static_assert(P2_LEFT == Left && P2_RIGHT == Right && P2_UP == Up
+	&& P2_DOWN == Down, "Direction mismatch");
+static_assert(P2_BLOCKED == Board::Blocked && P2_WALKED == Board::Walked
+	&& P2_PUSHED == Board::Pushed, "Move result mismatch");
+
+struct p2_levelset
+{
+	LevelSet levels;
+
+	p2_levelset(const char *filename)
+		: levels(filename, false)
+	{}
+};
+
+struct p2_game
+{
+	Board board;
+	Board::State state;
+
+	p2_game(const LevelSet &l, int level)
+		: board(l[level], l.firstFloorTile(), l.firstCrossTile()),
+		  state(board.initialState())
+	{}
+};
+
+struct p2_sim
+{
+	Simulation sim;
+
+	p2_sim(const LevelSet &l, int level)
+		: sim(l, level)
+	{}
+};
+
+struct p2_batch
+{
+	ThreadPool pool;
+	BatchEnv env;
+
+	p2_batch(const LevelSet &l, size_t count, uint8_t *observations,
+		unsigned int threads)
+		: pool(threads), env(l, count, observations, pool)
+	{}
+};
+
+static thread_local std::string last_error;
+
+static bool checkLevel(const p2_levelset *l, int level)
+{
+	if (level < 0 || (size_t)level >= l->levels.size())
+	{
+		last_error = "No such level";
+		return false;
+	}
+	return true;
+}
+
+int p2_core_abi_version(void)
+{
+	return P2_CORE_ABI_VERSION;
+}
+
+const char *p2_last_error(void)
+{
+	return last_error.c_str();
+}
+
+p2_levelset *p2_levelset_load(const char *filename)
+{
+	try
+	{
+		return new p2_levelset(filename);
+	}
+	catch (std::exception &e)
+	{
+		last_error = std::string("Could not load level set: ") + e.what();
+		return NULL;
+	}
+	catch (...)
+	{
+		last_error = "Could not load level set";
+		return NULL;
+	}
+}
+
+void p2_levelset_free(p2_levelset *l)
+{
+	delete l;
+}
+
+int p2_levelset_size(const p2_levelset *l)
+{
+	return l->levels.size();
+}
+
+uint32_t p2_levelset_hash(const p2_levelset *l)
+{
+	return l->levels.hash();
+}
+
+const char *p2_level_name(const p2_levelset *l, int level)
+{
+	if (!checkLevel(l, level))
+		return NULL;
+	return l->levels[level].name.c_str();
+}
+
+int p2_level_width(const p2_levelset *l, int level)
+{
+	if (!checkLevel(l, level))
+		return -1;
+	return l->levels[level].width;
+}
+
+int p2_level_height(const p2_levelset *l, int level)
+{
+	if (!checkLevel(l, level))
+		return -1;
+	return l->levels[level].height;
+}
+
+int p2_level_solve(const p2_levelset *l, int level, int8_t *directions,
+	size_t max)
+{
+	if (!checkLevel(l, level))
+		return -1;
+	try
+	{
+		std::vector<Direction> steps;
+		if (!Analyser::analyse(l->levels, level, &steps).solved)
+		{
+			last_error = "No solution found";
+			return -1;
+		}
+		for (size_t i = 0; i < steps.size() && i < max; ++i)
+			directions[i] = steps[i];
+		return steps.size();
+	}
+	catch (std::exception &e)
+	{
+		last_error = std::string("Could not solve level: ") + e.what();
+		return -1;
+	}
+	catch (...)
+	{
+		last_error = "Could not solve level";
+		return -1;
+	}
+}
+
+p2_game *p2_game_new(const p2_levelset *l, int level)
+{
+	if (!checkLevel(l, level))
+		return NULL;
+	try
+	{
+		return new p2_game(l->levels, level);
+	}
+	catch (std::exception &e)
+	{
+		last_error = std::string("Could not create game: ") + e.what();
+		return NULL;
+	}
+	catch (...)
+	{
+		last_error = "Could not create game";
+		return NULL;
+	}
+}
+
+void p2_game_free(p2_game *g)
+{
+	delete g;
+}
+
+void p2_game_reset(p2_game *g)
+{
+	g->state = g->board.initialState();
+}
+
+int p2_game_step(p2_game *g, int direction)
+{
+	if (direction < P2_LEFT || direction > P2_DOWN)
+		return P2_BLOCKED;
+	return g->board.move(g->state, (Direction)direction);
+}
+
+int p2_game_solved(const p2_game *g)
+{
+	return g->board.solved(g->state);
+}
+
+void p2_game_observe(const p2_game *g, uint8_t *observation)
+{
+	// Same layout as BatchEnv
+	const Board &b = g->board;
+	uint8_t *tiles = observation;
+	uint8_t *objects = observation + b.numSquares();
+	for (int i = 0; i < b.numSquares(); ++i)
+	{
+		if (b.isCross(i))
+			tiles[i] = BatchEnv::CrossTile;
+		else if (b.isFloor(i))
+			tiles[i] = BatchEnv::FloorTile;
+		else
+			tiles[i] = BatchEnv::WallTile;
+	}
+	b.occupancy(g->state, objects);
+	objects[g->state.player] = BatchEnv::PlayerObject;
+}
+
+int p2_sim_tick_rate(void)
+{
+	return P2_TICK_RATE;
+}
+
+p2_sim *p2_sim_new(const p2_levelset *l, int level)
+{
+	if (!checkLevel(l, level))
+		return NULL;
+	try
+	{
+		return new p2_sim(l->levels, level);
+	}
+	catch (std::exception &e)
+	{
+		last_error = std::string("Could not create simulation: ")
+			+ e.what();
+		return NULL;
+	}
+	catch (...)
+	{
+		last_error = "Could not create simulation";
+		return NULL;
+	}
+}
+
+void p2_sim_free(p2_sim *s)
+{
+	delete s;
+}
+
+void p2_sim_tick(p2_sim *s, int direction)
+{
+	if (direction < P2_LEFT || direction > P2_DOWN)
+		direction = P2_NONE;
+	s->sim.tick(direction);
+}
+
+int p2_sim_complete(const p2_sim *s)
+{
+	return s->sim.complete();
+}
+
+int p2_sim_bonus(const p2_sim *s)
+{
+	return s->sim.bonus();
+}
+
+uint32_t p2_sim_ticks(const p2_sim *s)
+{
+	return s->sim.ticks();
+}
+
+uint32_t p2_sim_digest(const p2_sim *s)
+{
+	return s->sim.digest();
+}
+
+size_t p2_batch_observation_size(const p2_levelset *l)
+{
+	return BatchEnv::observationSize(l->levels);
+}
+
+p2_batch *p2_batch_new(const p2_levelset *l, size_t count,
+	uint8_t *observations, unsigned int threads)
+{
+	try
+	{
+		return new p2_batch(l->levels, count, observations, threads);
+	}
+	catch (std::exception &e)
+	{
+		last_error = std::string("Could not create batch: ") + e.what();
+		return NULL;
+	}
+	catch (...)
+	{
+		last_error = "Could not create batch";
+		return NULL;
+	}
+}
+
+void p2_batch_free(p2_batch *b)
+{
+	delete b;
+}
+
+void p2_batch_reset(p2_batch *b, const uint32_t *ids, size_t count,
+	const uint32_t *levels)
+{
+	b->env.reset(ids, count, levels);
+}
+
+void p2_batch_step(p2_batch *b, const int8_t *actions, int8_t *rewards,
+	uint8_t *done)
+{
+	b->env.step(actions, rewards, done);
+}
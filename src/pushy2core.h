@@ -0,0 +1,173 @@
+/* Copyright 2011 Philip Allison */
+
+/*    This file is part of Pushy 2.
+ *
+ *    Pushy 2 is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    Pushy 2 is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * C interface to libpushy2core: level set loading and the game rules,
+ * for tools which want to embed them rather than run the game.
+ * Nothing here needs a display, and level sets are loaded without
+ * their graphics.
+ *
+ * Functions which can fail return NULL or a negative number, after
+ * which p2_last_error() describes what went wrong; no C++ exception
+ * ever leaves the library.  Handles are not thread safe, but separate
+ * handles can be used on separate threads.
+ *
+ * Level sets' tiles are SDL surfaces, so programs using the library
+ * link against SDL as well, and against the C++ runtime.
+ */
+
+#ifndef H_PUSHY2CORE
+#define H_PUSHY2CORE
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped whenever anything below changes incompatibly */
+#define P2_CORE_ABI_VERSION 2
+
+/* Directions, as used by every step function.  P2_NONE stands still. */
+#define P2_NONE -1
+#define P2_LEFT 0
+#define P2_RIGHT 1
+#define P2_UP 2
+#define P2_DOWN 3
+
+/* Results of p2_game_step */
+#define P2_BLOCKED 0
+#define P2_WALKED 1
+#define P2_PUSHED 2
+
+/*
+ * Observations are two planes, each with one byte per square of a level,
+ * row by row: tiles (0 wall, 1 floor, 2 cross), then objects (0 none,
+ * 1 box, 2 ball, 3 player).  Levels vary in size; see p2_level_width()
+ * and p2_level_height().
+ */
+
+typedef struct p2_levelset p2_levelset;
+typedef struct p2_game p2_game;
+typedef struct p2_sim p2_sim;
+typedef struct p2_batch p2_batch;
+
+/* Version the library was built with - compare to P2_CORE_ABI_VERSION */
+int p2_core_abi_version(void);
+
+/* Description of the last failure on the calling thread */
+const char *p2_last_error(void);
+
+/*
+ * Level sets
+ */
+
+p2_levelset *p2_levelset_load(const char *filename);
+void p2_levelset_free(p2_levelset *l);
+
+int p2_levelset_size(const p2_levelset *l);
+
+/* Hash of the file's contents, as recorded in replays */
+uint32_t p2_levelset_hash(const p2_levelset *l);
+
+/* Return NULL or -1 if the level does not exist */
+const char *p2_level_name(const p2_levelset *l, int level);
+int p2_level_width(const p2_levelset *l, int level);
+int p2_level_height(const p2_levelset *l, int level);
+
+/*
+ * Find a way to solve the level, as the directions to give
+ * p2_game_step from its start, writing up to max of them.  Returns
+ * the number of steps in the solution, which may be more than max,
+ * or -1 if none was found.
+ */
+int p2_level_solve(const p2_levelset *l, int level, int8_t *directions,
+	size_t max);
+
+/*
+ * Games stepped a square at a time, with pushes completing instantly.
+ * The level set must outlive any games made from it.
+ */
+
+p2_game *p2_game_new(const p2_levelset *l, int level);
+void p2_game_free(p2_game *g);
+
+void p2_game_reset(p2_game *g);
+
+/* Returns P2_BLOCKED, P2_WALKED or P2_PUSHED */
+int p2_game_step(p2_game *g, int direction);
+
+/* Non-zero once every object is on a cross */
+int p2_game_solved(const p2_game *g);
+
+/* Writes two planes of the level's width * height bytes */
+void p2_game_observe(const p2_game *g, uint8_t *observation);
+
+/*
+ * Games simulated in real time, exactly as when playing, in fixed
+ * ticks of 1/p2_sim_tick_rate() seconds.
+ */
+
+int p2_sim_tick_rate(void);
+
+p2_sim *p2_sim_new(const p2_levelset *l, int level);
+void p2_sim_free(p2_sim *s);
+
+/* Advance one tick with the given direction held */
+void p2_sim_tick(p2_sim *s, int direction);
+
+int p2_sim_complete(const p2_sim *s);
+int p2_sim_bonus(const p2_sim *s);
+uint32_t p2_sim_ticks(const p2_sim *s);
+
+/* Hash of all simulation state, for comparing runs */
+uint32_t p2_sim_digest(const p2_sim *s);
+
+/*
+ * Many step-at-a-time games at once, spread across threads (zero for
+ * one per core).  Observations for game i are written at
+ * observations + i * p2_batch_observation_size(l); the buffer must
+ * outlive the batch.  Each plane is big enough for the set's biggest
+ * level, and is zero after the current level's squares.
+ * Game i starts on level i modulo the number of levels.
+ */
+
+size_t p2_batch_observation_size(const p2_levelset *l);
+
+p2_batch *p2_batch_new(const p2_levelset *l, size_t count,
+	uint8_t *observations, unsigned int threads);
+void p2_batch_free(p2_batch *b);
+
+/* Restart the given games, on the given levels if levels is not NULL */
+void p2_batch_reset(p2_batch *b, const uint32_t *ids, size_t count,
+	const uint32_t *levels);
+
+/*
+ * One action per game.  Rewards are the change in the number of
+ * objects on crosses; done is set once a game's level is solved,
+ * after which it ignores its actions until reset.
+ */
+void p2_batch_step(p2_batch *b, const int8_t *actions, int8_t *rewards,
+	uint8_t *done);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,90 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+
+// System
+
+// Library
+
+// Local
+#include "LevelSet.hxx"
+#include "Analyser.hxx"
+
+//
+// Implementation
+//
+
+// Longest any one level of the standard set may take to analyse
+#define ANALYSE_LEVEL_SECONDS 15
+
+// Analyses every level of the standard set in $P2_DATA, one at a time,
+// checking that each takes seconds rather than minutes - the search is
+// capped, so a level which doesn't has made it run away - and that
+// every solution found finishes its level when played in the game.
+int main()
+{
+	const char *data = getenv("P2_DATA");
+	std::string filename(data ? data : ".");
+	filename += "/LegoLev";
+	LevelSet l(filename.c_str(), false);
+
+	int failures = 0;
+	double longest = 0.0;
+	for (size_t i = 0; i < l.size(); ++i)
+	{
+		auto start = std::chrono::steady_clock::now();
+		Analyser::Result r = Analyser::analyse(l, i);
+		double seconds = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - start).count();
+		longest = std::max(longest, seconds);
+
+		if (seconds > ANALYSE_LEVEL_SECONDS)
+		{
+			std::cerr << "FAILED: level " << i << " took " << seconds
+				<< "s to analyse" << std::endl;
+			++failures;
+		}
+		if (r.solved && !r.played)
+		{
+			std::cerr << "FAILED: level " << i << "'s solution doesn't"
+				" finish it in the game" << std::endl;
+			++failures;
+		}
+	}
+
+	if (!failures)
+		std::cout << "Analyser: " << l.size() << " levels, longest "
+			<< longest << "s: OK" << std::endl;
+	return failures ? 1 : 0;
+}
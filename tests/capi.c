@@ -0,0 +1,91 @@
+/* Copyright 2011 Philip Allison */
+
+/*    This file is part of Pushy 2.
+ *
+ *    Pushy 2 is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    Pushy 2 is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Uses libpushy2core from C alone, to check that the interface in
+ * pushy2core.h really is usable from C: loads the standard level set
+ * from $P2_DATA, solves its first level and plays the solution.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pushy2core.h"
+
+static int failures = 0;
+
+static void check(int ok, const char *what)
+{
+	if (!ok)
+	{
+		fprintf(stderr, "FAILED: %s (%s)\n", what, p2_last_error());
+		++failures;
+	}
+}
+
+int main(void)
+{
+	const char *data = getenv("P2_DATA");
+	char filename[4096];
+	p2_levelset *l;
+	p2_game *g;
+	int8_t *steps;
+	int n, i;
+
+	check(p2_core_abi_version() == P2_CORE_ABI_VERSION, "ABI version");
+
+	/* Failures come back as NULL, not as exceptions */
+	check(p2_levelset_load("no such file") == NULL, "missing file");
+	check(strlen(p2_last_error()) > 0, "error message");
+
+	snprintf(filename, sizeof(filename), "%s/LegoLev", data ? data : ".");
+	l = p2_levelset_load(filename);
+	if (!l)
+	{
+		fprintf(stderr, "Cannot load %s: %s\n", filename, p2_last_error());
+		return 1;
+	}
+	check(p2_levelset_size(l) > 0, "levels loaded");
+	check(p2_level_name(l, -1) == NULL, "bad level name");
+	check(p2_game_new(l, p2_levelset_size(l)) == NULL, "bad level game");
+
+	n = p2_level_solve(l, 0, NULL, 0);
+	check(n > 0, "solution found");
+	if (n > 0)
+	{
+		steps = malloc(n);
+		check(p2_level_solve(l, 0, steps, n) == n, "same solution again");
+
+		g = p2_game_new(l, 0);
+		check(g != NULL, "game created");
+		for (i = 0; g && i < n; ++i)
+		{
+			check(!p2_game_solved(g), "not solved before the end");
+			check(p2_game_step(g, steps[i]) != P2_BLOCKED, "step taken");
+		}
+		check(g && p2_game_solved(g), "solved at the end");
+		p2_game_free(g);
+		free(steps);
+	}
+
+	p2_levelset_free(l);
+	if (!failures)
+		printf("C interface: %d steps to solve level 0: OK\n", n);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,132 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <cstdlib>
+
+// System
+
+// Library
+
+// Local
+#include "LevelSet.hxx"
+#include "Board.hxx"
+
+//
+// Implementation
+//
+
+// Loads level packs with one thing wrong with their sprites, checking
+// that the loader rejects each of them rather than handing the game a
+// level it can't play.  The packs are written with LevelSet's own
+// writer, taking their style from the standard set in $P2_DATA.
+
+static int failures = 0;
+
+// A small walled level with a player, a box and a cross
+static Level goodLevel(const LevelSet &style)
+{
+	Level l(style[0]);
+	l.name = "Test";
+	l.width = 5;
+	l.height = 3;
+	l.tilemap.assign(l.width * l.height, style.firstFloorTile());
+	l.tilemap[7] = style.firstCrossTile();
+	l.num_sprites = 2;
+	l.spriteinfo[0].x = 1;
+	l.spriteinfo[0].y = 1;
+	l.spriteinfo[0].index = Board::NoPiece;
+	l.spriteinfo[1].x = 2;
+	l.spriteinfo[1].y = 1;
+	l.spriteinfo[1].index = Board::BoxPiece;
+	return l;
+}
+
+// Write a pack holding the one level and try to load it, expecting
+// an error containing the given text, or none if it is empty
+static void check(const LevelSet &style, const Level &l,
+	const std::string &error, const char *what)
+{
+	std::stringstream pack;
+	LevelSet::writeHeader(pack, style, 1);
+	LevelSet::writeLevel(pack, l);
+
+	std::string got;
+	try
+	{
+		LevelSet loaded(pack, false);
+	}
+	catch (const std::exception &e)
+	{
+		got = e.what();
+	}
+
+	bool ok = error.empty() ? got.empty()
+		: (got.find(error) != std::string::npos);
+	if (!ok)
+	{
+		std::cerr << "FAILED: " << what << " (got \""
+			<< got << "\")" << std::endl;
+		++failures;
+	}
+}
+
+int main()
+{
+	const char *data = getenv("P2_DATA");
+	std::string filename(data ? data : ".");
+	filename += "/LegoLev";
+	LevelSet style(filename.c_str(), false);
+
+	Level l = goodLevel(style);
+	check(style, l, "", "good level");
+
+	l = goodLevel(style);
+	l.spriteinfo[1].index = Board::BallPiece + 1;
+	check(style, l, "Unknown sprite", "unknown sprite index");
+
+	l = goodLevel(style);
+	l.spriteinfo[0].index = Board::BoxPiece;
+	check(style, l, "exactly one player", "no player");
+
+	l = goodLevel(style);
+	l.spriteinfo[1].index = Board::NoPiece;
+	check(style, l, "exactly one player", "two players");
+
+	l = goodLevel(style);
+	l.spriteinfo[1].y = 3;
+	check(style, l, "Sprite outside level", "sprite outside level");
+
+	if (!failures)
+		std::cout << "Level loader: bad sprites rejected: OK" << std::endl;
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,131 @@
+// Copyright 2011 Philip Allison
+
+//    This file is part of Pushy 2.
+//
+//    Pushy 2 is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    Pushy 2 is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with Pushy 2.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+//
+// Includes
+//
+
+// Standard
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif
+
+// Language
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <atomic>
+
+// System
+
+// Library
+
+// Local
+#include "ThreadPool.hxx"
+
+//
+// Implementation
+//
+
+// Runs ThreadPool's loops on pools of a few sizes, checking that
+// parallelInOrder uses results in order while only holding a few at
+// once, and that exceptions thrown on any thread reach the caller.
+
+static int failures = 0;
+
+static void check(bool ok, unsigned int threads, const char *what)
+{
+	if (!ok)
+	{
+		std::cerr << "FAILED: " << what << " with " << threads
+			<< " threads" << std::endl;
+		++failures;
+	}
+}
+
+int main()
+{
+	const unsigned int sizes[] = {1, 2, 4, 8};
+	const size_t count = 1000;
+
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+	{
+		ThreadPool pool(sizes[s]);
+
+		// Results come out in order, and no more are made than can be
+		// held: make() is never more than a window ahead of use()
+		std::vector<size_t> used;
+		std::atomic<size_t> held(0);
+		std::atomic<size_t> most(0);
+		pool.parallelInOrder<size_t>(count, [&](size_t i, size_t &r) {
+			size_t h = ++held;
+			size_t seen = most.load();
+			while (h > seen && !most.compare_exchange_weak(seen, h))
+				;
+			r = i * 3;
+		}, [&](size_t i, size_t &r) {
+			check(r == i * 3, sizes[s], "result for its index");
+			used.push_back(i);
+			--held;
+		});
+		bool in_order = (used.size() == count);
+		for (size_t i = 0; in_order && i < count; ++i)
+			in_order = (used[i] == i);
+		check(in_order, sizes[s], "results used in order");
+		check(most.load() <= 2 * pool.size(), sizes[s],
+			"results held at once");
+
+		// Exceptions from make() and use() come back to this thread,
+		// after which the pool can still be used
+		const char *where[] = {"make", "use"};
+		for (int w = 0; w < 2; ++w)
+		{
+			std::string caught;
+			try
+			{
+				pool.parallelInOrder<int>(count, [&](size_t i, int &r) {
+					if (w == 0 && i == count / 2)
+						throw std::runtime_error("make");
+				}, [&](size_t i, int &r) {
+					if (w == 1 && i == count / 2)
+						throw std::runtime_error("use");
+				});
+			}
+			catch (const std::exception &e)
+			{
+				caught = e.what();
+			}
+			check(caught == where[w], sizes[s], "exception rethrown");
+		}
+
+		std::atomic<size_t> sum(0);
+		pool.parallelFor(count, 7, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i)
+				sum += i;
+		});
+		check(sum.load() == (count * (count - 1)) / 2, sizes[s],
+			"loop after an exception");
+	}
+
+	if (!failures)
+		std::cout << "Thread pool: ordered results and exceptions: OK"
+			<< std::endl;
+	return failures ? 1 : 0;
+}